@@ -0,0 +1,483 @@
+#include <new>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+#include "map.hpp"
+#include "pool.hpp"
+#include "engine.hpp"
+#include "workers.hpp"
+#include "protocol.hpp"
+#include "snapshot.hpp"
+
+// every heap allocation made by the process goes through here, so allocations per tick can be reported
+//
+static std::atomic<uint64_t> allocations { 0 };
+
+void* operator new( std::size_t size )
+{
+	allocations.fetch_add( 1, std::memory_order_relaxed );
+
+	if ( auto ptr = std::malloc( size ? size : 1 ) )
+		return ptr;
+
+	throw std::bad_alloc( );
+}
+
+void operator delete( void* ptr ) noexcept
+{
+	std::free( ptr );
+}
+
+void operator delete( void* ptr, std::size_t ) noexcept
+{
+	std::free( ptr );
+}
+
+typedef struct
+{
+	std::string name;
+	GameSettings settings;
+	int rock_percent;		// percentage of the road cells to fill with rocks
+	int num_players;
+} BENCH_CASE;
+
+typedef struct
+{
+	double ns_per_tick;
+	double allocs_per_tick;
+	double bytes_per_tick;
+	double p50, p99, p999;
+} BENCH_RESULT;
+
+typedef struct
+{
+	int ticks = 20000;
+	int warmup = 1000;
+	uint32_t seed = 1234;
+	const char* filter = nullptr;
+	int threads = 1;			// > 1 steps the roads on a pool and checks every tick against a serial twin
+	int parallel_roads = 1;
+	int levels = 1000;			// level transitions timed per case
+} BENCH_OPTIONS;
+
+typedef struct
+{
+	std::vector<double> samples;
+	uint64_t total_ns, total_allocs, total_bytes;
+} BENCH_STAGE;
+
+static double percentile( std::vector<double>& samples, double quantile )
+{
+	if ( samples.empty( ) )
+		return 0;
+
+	const auto index = std::min( samples.size( ) - 1, static_cast<size_t>( quantile * samples.size( ) ) );
+	std::nth_element( samples.begin( ), samples.begin( ) + index, samples.end( ) );
+
+	return samples[ index ];
+}
+
+// times one call of fn, which returns the number of bytes it produced (if any)
+//
+template <typename Fn>
+static void sample( BENCH_STAGE& stage, Fn&& fn )
+{
+	const auto allocs_before = allocations.load( std::memory_order_relaxed );
+	const auto start = std::chrono::steady_clock::now( );
+
+	const size_t bytes = fn( );
+
+	const auto end = std::chrono::steady_clock::now( );
+	stage.total_allocs += allocations.load( std::memory_order_relaxed ) - allocs_before;
+
+	const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count( );
+	stage.total_ns += elapsed;
+	stage.total_bytes += bytes;
+	stage.samples.push_back( static_cast<double>( elapsed ) );
+}
+
+static BENCH_RESULT summarize( BENCH_STAGE& stage )
+{
+	const double count = std::max<size_t>( 1, stage.samples.size( ) );
+
+	BENCH_RESULT result;
+	result.ns_per_tick = stage.total_ns / count;
+	result.allocs_per_tick = stage.total_allocs / count;
+	result.bytes_per_tick = stage.total_bytes / count;
+	result.p50 = percentile( stage.samples, 0.5 );
+	result.p99 = percentile( stage.samples, 0.99 );
+	result.p999 = percentile( stage.samples, 0.999 );
+
+	return result;
+}
+
+static void populate( GameEngine& engine, const BENCH_CASE& bench_case )
+{
+	const auto [columns, lines] = engine.getMapSize( );
+	auto& random = engine.getRandom( );
+
+	// rocks only go on the roads, the first and last lines belong to the frogs
+	//
+	const int num_rocks = columns * ( lines - 2 ) * bench_case.rock_percent / 100;
+	for ( int placed = 0, attempts = 0; placed < num_rocks && attempts < num_rocks * 100; attempts++ )
+		if ( engine.placeRock( random.generateInt( 0, columns - 1 ), random.generateInt( 1, lines - 2 ) ) )
+			placed++;
+
+	for ( int pid = 1; pid <= bench_case.num_players; pid++ )
+		engine.addPlayer( pid );
+}
+
+// players hop forward most of the time and sideways every few ticks, so collisions and level ups get exercised
+//
+static void drivePlayers( GameEngine& engine, int num_players, int tick )
+{
+	static constexpr FACING pattern[ ] = { UP, UP, LEFT, UP, RIGHT, UP, DOWN, UP };
+
+	for ( int pid = 1; pid <= num_players; pid++ )
+		engine.movePlayer( pid, pattern[ ( tick + pid ) % std::size( pattern ) ] );
+}
+
+static void printHeader( )
+{
+	std::printf( "%-36s %-9s %10s %10s %10s %10s %11s %10s %8s\n", "case", "stage", "ns/tick", "p50", "p99", "p999", "allocs/tick", "bytes/tick", "failed" );
+}
+
+static void printResult( const std::string& name, const char* stage, const BENCH_RESULT& result, int failed )
+{
+	std::printf( "%-36s %-9s %10.0f %10.0f %10.0f %10.0f %11.2f %10.0f %8d\n", name.c_str( ), stage,
+		result.ns_per_tick, result.p50, result.p99, result.p999, result.allocs_per_tick, result.bytes_per_tick, failed );
+}
+
+// what Client::update does with the result of every tick, serialize it and publish it to the io thread
+// returns the bytes of entities published, failed counts the ticks that couldn't be serialized
+//
+static size_t publishSnapshot( SnapshotBuffer<SNAPSHOT>& snapshots, GameEngine& engine, uint32_t seq, int& failed )
+{
+	const auto size = engine.getMapSize( );
+
+	auto& snapshot = snapshots.begin( );
+	if ( !serializeSnapshot( snapshot.data, engine.getEntityList( ), GAME_STATE_READY, 0, 0, size.first, size.second ) )
+	{
+		snapshots.cancel( );
+		failed++;
+		return 0;
+	}
+
+	serializeAcks( snapshot, engine.getPlayerAcks( ) );
+	snapshot.seq = seq;
+
+	const auto bytes = snapshot.data.entities.size( ) * sizeof( ENTITY );
+	snapshots.publish( );
+
+	return bytes;
+}
+
+// the parallel tick has to end up exactly where the serial one does
+//
+static bool sameState( GameEngine& engine, GameEngine& twin )
+{
+	if ( engine.getMapSize( ) != twin.getMapSize( ) )
+		return false;
+
+	const auto entities = engine.getEntityList( );
+	const auto twin_entities = twin.getEntityList( );
+	if ( entities.size( ) != twin_entities.size( ) )
+		return false;
+
+	for ( size_t i = 0; i < entities.size( ); i++ )
+	{
+		const auto& entity = entities[ i ];
+		const auto& twin_entity = twin_entities[ i ];
+
+		if ( entity.getType( ) != twin_entity.getType( ) || entity.getFacingDirection( ) != twin_entity.getFacingDirection( ) ||
+			entity.getPosition( ) != twin_entity.getPosition( ) )
+			return false;
+	}
+
+	return true;
+}
+
+// level = a frog reaching the last line, the roads go back to the pool and are refilled with the cars of the next level
+// failed counts the transitions that didn't level up
+//
+static BENCH_RESULT runLevels( const BENCH_CASE& bench_case, const BENCH_OPTIONS& options, int& failed )
+{
+	Random random( options.seed );
+	Pool<Road> road_pool;
+	Map map( bench_case.settings, random, road_pool );
+
+	const auto lines = map.getSize( ).second;
+	map.addFrog( 1, 0, 0 );
+
+	BENCH_STAGE stage { };
+	stage.samples.reserve( options.levels );
+
+	for ( int i = 0; i < options.levels; i++ )
+	{
+		const auto level = map.getLevel( );
+		map.getFrogs( ).setPosition( 0, 0, lines - 1 );
+
+		sample( stage, [ & ] ( )
+			{
+				map.processTick( );
+				return size_t( 0 );
+			} );
+
+		failed += map.getLevel( ) != level + 1;
+	}
+
+	return summarize( stage );
+}
+
+// returns the allocations made by the ticks and snapshots after the warmup, a steady game shouldn't make any
+//
+static uint64_t run( const BENCH_CASE& bench_case, const BENCH_OPTIONS& options, WorkerPool* ppool )
+{
+	auto settings = bench_case.settings;
+	if ( ppool )
+		settings.parallel_roads = options.parallel_roads;
+
+	GameEngine* pengine = nullptr;
+	GameEngine* ptwin = nullptr;
+	try
+	{
+		pengine = new GameEngine( settings, Random( options.seed ) );
+
+		if ( ppool )
+			ptwin = new GameEngine( settings, Random( options.seed ) );
+	}
+	catch ( const std::exception& e )
+	{
+		std::printf( "%-36s skipped: %s\n", bench_case.name.c_str( ), e.what( ) );
+
+		delete pengine;
+		return 0;
+	}
+
+	pengine->setWorkerPool( ppool );
+
+	populate( *pengine, bench_case );
+	if ( ptwin )
+		populate( *ptwin, bench_case );
+
+	static SnapshotBuffer<SNAPSHOT> snapshots;
+	int snapshot_failed = 0;
+
+	// the warmup goes through the snapshots as well, every slot and list has grown to the size of the board after it
+	//
+	int diverged = 0;
+	for ( int i = 0; i < options.warmup; i++ )
+	{
+		drivePlayers( *pengine, bench_case.num_players, i );
+		const bool processed = pengine->processTick( );
+
+		publishSnapshot( snapshots, *pengine, 0, snapshot_failed );
+
+		if ( ptwin )
+		{
+			drivePlayers( *ptwin, bench_case.num_players, i );
+			diverged += ptwin->processTick( ) != processed || !sameState( *pengine, *ptwin );
+		}
+	}
+
+	BENCH_STAGE tick_stage { }, snapshot_stage { }, full_stage { }, delta_stage { };
+	for ( auto stage : { &tick_stage, &snapshot_stage, &full_stage, &delta_stage } )
+		stage->samples.reserve( options.ticks );
+
+	static DATA current, previous, replica;
+	static SNAPSHOT published;
+	uint32_t replica_seq = 0;
+
+	FRAME_HEADER header;
+	std::vector<char> records;
+
+	int delta_failed = 0;
+	for ( int i = 0; i < options.ticks; i++ )
+	{
+		const auto seq = static_cast<uint32_t>( i + 1 );
+
+		// tick = input + simulation step, the way the server drives it
+		//
+		bool processed = false;
+		sample( tick_stage, [ & ] ( )
+			{
+				drivePlayers( *pengine, bench_case.num_players, i );
+				processed = pengine->processTick( );
+				return size_t( 0 );
+			} );
+
+		if ( ptwin )
+		{
+			drivePlayers( *ptwin, bench_case.num_players, i );
+			diverged += ptwin->processTick( ) != processed || !sameState( *pengine, *ptwin );
+		}
+
+		sample( snapshot_stage, [ & ] ( )
+			{
+				return publishSnapshot( snapshots, *pengine, seq, snapshot_failed );
+			} );
+
+		if ( snapshots.read( published ) )
+			current = published.data;
+
+		// what a client pipe costs per tick: a keyframe every time against a delta from the previous tick
+		//
+		sample( full_stage, [ & ] ( )
+			{
+				encodeKeyframe( current, seq, header, records );
+				return sizeof( header ) + records.size( );
+			} );
+
+		sample( delta_stage, [ & ] ( )
+			{
+				if ( i == 0 )
+					encodeKeyframe( current, seq, header, records );
+				else if ( !encodeDelta( previous, seq - 1, current, seq, header, records ) )
+					return size_t( 0 );
+
+				return sizeof( header ) + records.size( );
+			} );
+
+		// the replica must end up identical to what was serialized (an empty delta applies as a no-op)
+		//
+		if ( !applyFrame( replica, replica_seq, header, records.data( ) ) || replica.num_entities != current.num_entities ||
+			memcmp( replica.entities.data( ), current.entities.data( ), current.num_entities * sizeof( ENTITY ) ) )
+			delta_failed++;
+
+		previous = current;
+	}
+
+	printResult( bench_case.name, "tick", summarize( tick_stage ), diverged );
+	printResult( bench_case.name, "snapshot", summarize( snapshot_stage ), snapshot_failed );
+	printResult( bench_case.name, "keyframe", summarize( full_stage ), 0 );
+	printResult( bench_case.name, "delta", summarize( delta_stage ), delta_failed );
+
+	int level_failed = 0;
+	const auto level_result = runLevels( bench_case, options, level_failed );
+	printResult( bench_case.name, "level", level_result, level_failed );
+
+	delete pengine;
+	delete ptwin;
+
+	return tick_stage.total_allocs + snapshot_stage.total_allocs;
+}
+
+static std::vector<BENCH_CASE> buildCases( )
+{
+	std::vector<BENCH_CASE> cases;
+
+	auto add = [ &cases ] ( int num_roads, int num_cars, int rock_percent, int num_players, int num_columns = 20 )
+		{
+			BENCH_CASE bench_case;
+			bench_case.name = "roads=" + std::to_string( num_roads ) + ( num_columns != 20 ? " cols=" + std::to_string( num_columns ) : "" ) +
+				" cars=" + std::to_string( num_cars ) + " rocks=" + std::to_string( rock_percent ) + "% p=" + std::to_string( num_players );
+			bench_case.settings.num_roads = num_roads;
+			bench_case.settings.num_columns = num_columns;
+			bench_case.settings.init_car_number = num_cars;
+			bench_case.rock_percent = rock_percent;
+			bench_case.num_players = num_players;
+
+			cases.push_back( bench_case );
+		};
+
+	// board size, default density
+	//
+	for ( const auto num_roads : { 1, 2, 4, 8, 16, 32, 64, 128 } )
+		add( num_roads, 2, 0, 0 );
+
+	for ( const auto num_columns : { 40, 80, 160 } )
+		add( 8, 2, 0, 0, num_columns );
+
+	// car density
+	//
+	for ( const auto num_cars : { 1, 5, 10, 15 } )
+		add( 8, num_cars, 0, 0 );
+
+	// rock density
+	//
+	for ( const auto rock_percent : { 10, 25, 50 } )
+		add( 8, 2, rock_percent, 0 );
+
+	// players
+	//
+	for ( const auto num_players : { 1, 2, 8 } )
+		add( 5, 2, 0, num_players );
+
+	// everything at once, 10x the default entity count
+	//
+	add( 8, 15, 25, 8 );
+
+	return cases;
+}
+
+static void usage( const char* name )
+{
+	std::printf( "usage: %s [--ticks N] [--warmup N] [--seed N] [--filter TEXT] [--threads N] [--parallel-roads N] [--levels N]\n", name );
+}
+
+int main( int argc, char** argv )
+{
+	BENCH_OPTIONS options;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool has_value = i + 1 < argc;
+
+		if ( !std::strcmp( argv[ i ], "--ticks" ) && has_value )
+			options.ticks = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--warmup" ) && has_value )
+			options.warmup = std::max( 0, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--seed" ) && has_value )
+			options.seed = static_cast<uint32_t>( std::strtoul( argv[ ++i ], nullptr, 10 ) );
+		else if ( !std::strcmp( argv[ i ], "--filter" ) && has_value )
+			options.filter = argv[ ++i ];
+		else if ( !std::strcmp( argv[ i ], "--threads" ) && has_value )
+			options.threads = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--parallel-roads" ) && has_value )
+			options.parallel_roads = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--levels" ) && has_value )
+			options.levels = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else
+		{
+			usage( argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	// the roads of a board are stepped on the pool from parallel_roads on, failed on a tick row counts the ticks
+	// that came out different from the serial twin
+	//
+	std::unique_ptr<WorkerPool> pool;
+	if ( options.threads > 1 )
+		pool = std::make_unique<WorkerPool>( options.threads );
+
+	std::printf( "ticks=%d warmup=%d seed=%u threads=%d (times in ns)\n\n", options.ticks, options.warmup, options.seed, options.threads );
+	printHeader( );
+
+	uint64_t steady_allocs = 0;
+	for ( const auto& bench_case : buildCases( ) )
+	{
+		if ( options.filter && bench_case.name.find( options.filter ) == std::string::npos )
+			continue;
+
+		steady_allocs += run( bench_case, options, pool.get( ) );
+	}
+
+	if ( pool )
+		std::printf( "\nranges stolen %llu\n", static_cast<unsigned long long>( pool->getSteals( ) ) );
+
+	// the exit code fails the run if a tick or a snapshot still allocates once the game is warm
+	//
+	std::printf( "\nallocations in steady state ticks and snapshots: %llu\n", static_cast<unsigned long long>( steady_allocs ) );
+
+	return steady_allocs ? 2 : 0;
+}
\ No newline at end of file
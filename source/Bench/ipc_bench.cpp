@@ -0,0 +1,281 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "smem.hpp"
+
+// latency of the operator channel: the server publishes frames to the readers and every reader sends commands back,
+// each process on its own like the real thing, timestamps come from the monotonic clock shared by all of them
+//
+typedef struct
+{
+	int readers = 4;
+	int frames = 20000;
+	int commands = 2000;
+	int interval_us = 50;		// between two frames / commands, 0 = back to back
+	int entities = 160;			// per frame, past FRAME_ENTITIES the frames move to a larger section
+} BENCH_OPTIONS;
+
+// what a reader reports back to the server through a pipe
+//
+typedef struct
+{
+	int received;
+	int commands_failed;
+	double p50, p99, p999, max;
+} READER_RESULT;
+
+static int64_t now( )
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ).time_since_epoch( ) ).count( );
+}
+
+static double percentile( std::vector<double>& samples, double quantile )
+{
+	if ( samples.empty( ) )
+		return 0;
+
+	const auto index = std::min( samples.size( ) - 1, static_cast<size_t>( quantile * samples.size( ) ) );
+	std::nth_element( samples.begin( ), samples.begin( ) + index, samples.end( ) );
+
+	return samples[ index ];
+}
+
+static void pace( const BENCH_OPTIONS& options )
+{
+	if ( options.interval_us )
+		std::this_thread::sleep_for( std::chrono::microseconds( options.interval_us ) );
+}
+
+// the send time travels in the first entity of a frame and in the position of a command
+//
+static void stamp( DATA& data, int64_t time )
+{
+	memcpy( &data.entities[ 0 ], &time, sizeof( time ) );
+}
+
+static int64_t stampOf( const DATA& data )
+{
+	int64_t time;
+	memcpy( &time, &data.entities[ 0 ], sizeof( time ) );
+	return time;
+}
+
+static void runReader( const char* name, int fd_start, int fd_ready, int fd_result, const BENCH_OPTIONS& options )
+{
+	char byte;
+	if ( read( fd_start, &byte, 1 ) != 1 )
+		_exit( 1 );
+
+	std::vector<double> samples;
+	samples.reserve( options.frames );
+
+	std::atomic<bool> done { false };
+
+	SMem mem( name );
+	mem.registerHandler( [ & ] ( DATA data )
+		{
+			if ( data.state == GAME_STATE_DRAW )
+			{
+				done.store( true, std::memory_order_release );
+				return;
+			}
+
+			samples.push_back( static_cast<double>( now( ) - stampOf( data ) ) );
+		} );
+
+	if ( write( fd_ready, &byte, 1 ) != 1 )
+		_exit( 1 );
+
+	while ( !done.load( std::memory_order_acquire ) )
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+
+	READER_RESULT result { };
+	result.received = static_cast<int>( samples.size( ) );
+	result.p50 = percentile( samples, 0.5 );
+	result.p99 = percentile( samples, 0.99 );
+	result.p999 = percentile( samples, 0.999 );
+	result.max = samples.empty( ) ? 0 : *std::max_element( samples.begin( ), samples.end( ) );
+
+	for ( int i = 0; i < options.commands; i++ )
+	{
+		COMMAND command { };
+		command.sender_pid = static_cast<int>( getpid( ) );
+		command.target_pid = 0;
+		command.type = INFO;
+		command.info.action = ROCK;
+
+		const auto time = now( );
+		memcpy( &command.info.pos, &time, sizeof( time ) );
+
+		if ( !mem.writeCommand( &command ) )
+			result.commands_failed++;
+
+		pace( options );
+	}
+
+	if ( write( fd_result, &result, sizeof( result ) ) != sizeof( result ) )
+		_exit( 1 );
+}
+
+static void usage( const char* name )
+{
+	std::printf( "usage: %s [--readers N] [--frames N] [--commands N] [--interval US] [--entities N]\n", name );
+}
+
+int main( int argc, char** argv )
+{
+	BENCH_OPTIONS options;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool has_value = i + 1 < argc;
+
+		if ( !std::strcmp( argv[ i ], "--readers" ) && has_value )
+			options.readers = std::clamp( std::atoi( argv[ ++i ] ), 1, MAX_INSTANCES - 1 );
+		else if ( !std::strcmp( argv[ i ], "--frames" ) && has_value )
+			options.frames = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--commands" ) && has_value )
+			options.commands = std::max( 0, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--interval" ) && has_value )
+			options.interval_us = std::max( 0, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--entities" ) && has_value )
+			options.entities = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else
+		{
+			usage( argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	// a channel of our own, so a running server isn't disturbed
+	//
+	char name[ 64 ];
+	std::snprintf( name, sizeof( name ), "CRR_BENCH_%d", static_cast<int>( getpid( ) ) );
+
+	int fd_start[ 2 ], fd_ready[ 2 ], fd_result[ 2 ];
+	if ( pipe( fd_start ) || pipe( fd_ready ) || pipe( fd_result ) )
+		return 1;
+
+	// readers are forked before the server maps the section, a fork only carries the calling thread
+	//
+	std::vector<pid_t> readers;
+	for ( int i = 0; i < options.readers; i++ )
+	{
+		const auto pid = fork( );
+		if ( pid == -1 )
+			return 1;
+
+		if ( !pid )
+		{
+			runReader( name, fd_start[ 0 ], fd_ready[ 1 ], fd_result[ 1 ], options );
+			_exit( 0 );
+		}
+
+		readers.push_back( pid );
+	}
+
+	std::vector<double> command_samples;
+	command_samples.reserve( static_cast<size_t>( options.readers ) * options.commands );
+	std::atomic<int> commands_received { 0 };
+
+	{
+		SMem mem( name );
+		mem.registerCmdHandler( [ & ] ( COMMAND command )
+			{
+				int64_t time;
+				memcpy( &time, &command.info.pos, sizeof( time ) );
+
+				command_samples.push_back( static_cast<double>( now( ) - time ) );
+				commands_received.fetch_add( 1, std::memory_order_release );
+			} );
+
+		char byte = 0;
+		for ( int i = 0; i < options.readers; i++ )
+			if ( write( fd_start[ 1 ], &byte, 1 ) != 1 || read( fd_ready[ 0 ], &byte, 1 ) != 1 )
+				return 1;
+
+		std::vector<ENTITY> entities( options.entities );
+
+		DATA data { };
+		data.state = GAME_STATE_RUNNING;
+		data.num_entities = options.entities;
+		data.entities = entities.data( );
+
+		std::vector<double> write_samples;
+		write_samples.reserve( options.frames );
+
+		for ( int i = 0; i < options.frames; i++ )
+		{
+			data.time = i;
+
+			const auto start = now( );
+			stamp( data, start );
+			mem.writeData( &data );
+			write_samples.push_back( static_cast<double>( now( ) - start ) );
+
+			pace( options );
+		}
+
+		data.state = GAME_STATE_DRAW;
+		mem.writeData( &data );
+
+		std::vector<READER_RESULT> results( options.readers );
+		for ( auto& result : results )
+			if ( read( fd_result[ 0 ], &result, sizeof( result ) ) != sizeof( result ) )
+				return 1;
+
+		// whatever is still in the server queue
+		//
+		int commands_failed = 0;
+		for ( const auto& result : results )
+			commands_failed += result.commands_failed;
+
+		const auto expected = options.readers * options.commands - commands_failed;
+		for ( int i = 0; i < 100 && commands_received.load( std::memory_order_acquire ) < expected; i++ )
+			std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+
+		std::printf( "readers=%d frames=%d commands=%d interval=%dus entities=%d (times in ns)\n\n", options.readers, options.frames, options.commands,
+			options.interval_us, options.entities );
+		std::printf( "%-16s %10s %10s %10s %10s %10s\n", "stage", "count", "p50", "p99", "p999", "max" );
+
+		auto print = [ ] ( const char* stage, int count, double p50, double p99, double p999, double max )
+			{
+				std::printf( "%-16s %10d %10.0f %10.0f %10.0f %10.0f\n", stage, count, p50, p99, p999, max );
+			};
+
+		const auto write_max = *std::max_element( write_samples.begin( ), write_samples.end( ) );
+		print( "writeData", options.frames, percentile( write_samples, 0.5 ), percentile( write_samples, 0.99 ), percentile( write_samples, 0.999 ), write_max );
+
+		for ( int i = 0; i < options.readers; i++ )
+		{
+			char stage[ 32 ];
+			std::snprintf( stage, sizeof( stage ), "frame reader %d", i );
+			print( stage, results[ i ].received, results[ i ].p50, results[ i ].p99, results[ i ].p999, results[ i ].max );
+		}
+
+		mem.registerCmdHandler( nullptr );
+
+		const auto command_count = commands_received.load( std::memory_order_acquire );
+		command_samples.resize( command_count );
+		const auto command_max = command_samples.empty( ) ? 0 : *std::max_element( command_samples.begin( ), command_samples.end( ) );
+		print( "command", command_count, percentile( command_samples, 0.5 ), percentile( command_samples, 0.99 ), percentile( command_samples, 0.999 ), command_max );
+
+		if ( commands_failed )
+			std::printf( "\n%d commands didn't fit in the queue\n", commands_failed );
+	}
+
+	for ( const auto pid : readers )
+		waitpid( pid, nullptr, 0 );
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "match.hpp"
+#include "metrics.hpp"
+#include "scheduler.hpp"
+
+// many matches in one process, ticked by the match manager on its pool
+// reports how long a round over all matches takes and whether the rounds keep up with the tick rate
+//
+typedef struct
+{
+	int matches = 200;
+	int players = 2;			// per match
+	int threads = 0;			// 0 = one per core
+	int seconds = 5;
+	int tick_ms = 15;
+	int moves_per_second = 5;
+	uint32_t seed = 1234;
+	const char* record = nullptr;	// directory the matches are recorded to, for crr_replay
+} MATCH_BENCH_OPTIONS;
+
+static void usage( const char* name )
+{
+	std::printf( "usage: %s [--matches N] [--players N] [--threads N] [--seconds N] [--tick-ms N] [--moves N] [--seed N] [--record DIR]\n", name );
+}
+
+int main( int argc, char** argv )
+{
+	MATCH_BENCH_OPTIONS options;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool has_value = i + 1 < argc;
+
+		if ( !std::strcmp( argv[ i ], "--matches" ) && has_value )
+			options.matches = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--players" ) && has_value )
+			options.players = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--threads" ) && has_value )
+			options.threads = std::max( 0, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--seconds" ) && has_value )
+			options.seconds = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--tick-ms" ) && has_value )
+			options.tick_ms = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--moves" ) && has_value )
+			options.moves_per_second = std::max( 0, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--seed" ) && has_value )
+			options.seed = static_cast<uint32_t>( std::strtoul( argv[ ++i ], nullptr, 10 ) );
+		else if ( !std::strcmp( argv[ i ], "--record" ) && has_value )
+			options.record = argv[ ++i ];
+		else
+		{
+			usage( argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	GameSettings settings;
+	settings.tick_ms = options.tick_ms;
+
+	MatchManager manager( settings, options.matches, options.players, options.threads, Random( options.seed ) );
+	if ( options.record )
+		manager.setReplayDirectory( options.record );
+
+	std::atomic<uint64_t> frames = 0;
+	manager.setOnTick( [ &frames ] ( int match, GameEngine& engine, bool processed )
+		{
+			frames.fetch_add( processed, std::memory_order_relaxed );
+		} );
+
+	const auto num_players = options.matches * options.players;
+	for ( int pid = 1; pid <= num_players; pid++ )
+	{
+		if ( manager.join( pid, options.players > 1 ? MULTIPLAYER : SINGLEPLAYER ) == -1 )
+		{
+			std::printf( "player %d could not join\n", pid );
+			return 1;
+		}
+	}
+
+	TickScheduler scheduler( options.tick_ms );
+	std::thread tick_thread( [ & ] ( )
+		{
+			scheduler.run( [ & ] ( )
+				{
+					manager.processTick( );
+				} );
+		} );
+
+	// the inputs of every player, as the transport threads would queue them
+	//
+	const auto start = std::chrono::steady_clock::now( );
+	const auto deadline = start + std::chrono::seconds( options.seconds );
+
+	static constexpr FACING pattern[ ] = { UP, LEFT, UP, RIGHT, DOWN, UP };
+	uint32_t seq = 0;
+	uint64_t moves = 0;
+
+	while ( std::chrono::steady_clock::now( ) < deadline )
+	{
+		if ( options.moves_per_second )
+		{
+			seq++;
+			for ( int pid = 1; pid <= num_players; pid++ )
+				moves += manager.move( pid, pattern[ ( seq + pid ) % std::size( pattern ) ], seq );
+		}
+
+		std::this_thread::sleep_for( std::chrono::milliseconds( options.moves_per_second ? 1000 / options.moves_per_second : 100 ) );
+	}
+
+	scheduler.stop( );
+	tick_thread.join( );
+
+	const auto elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+	const auto match_stats = manager.getStats( );
+	const auto tick_stats = scheduler.getStats( );
+
+	std::printf( "matches=%d players=%d threads=%d tick=%dms seconds=%d\n\n", match_stats.matches, match_stats.players, match_stats.threads,
+		options.tick_ms, options.seconds );
+	std::printf( "rounds %llu (%.1f/s), round avg %.3f ms, max %.3f ms, per match %.2f us\n", static_cast<unsigned long long>( tick_stats.ticks ),
+		tick_stats.ticks / elapsed, tick_stats.avg_tick_ms, tick_stats.max_tick_ms, tick_stats.avg_tick_ms * 1000.0 / std::max( 1, match_stats.matches ) );
+	std::printf( "overruns %llu, catch up steps %llu, dropped steps %llu\n", static_cast<unsigned long long>( tick_stats.overruns ),
+		static_cast<unsigned long long>( tick_stats.catch_up_steps ), static_cast<unsigned long long>( tick_stats.dropped_steps ) );
+	std::printf( "moves queued %llu, frames with changes %llu\n", static_cast<unsigned long long>( moves ), static_cast<unsigned long long>( frames.load( ) ) );
+
+	// the same per phase timers the server's stats command shows
+	//
+	std::printf( "\n%s", Metrics::format( Metrics::instance( ).read( ) ).c_str( ) );
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,303 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+
+#include "engine.hpp"
+#include "scheduler.hpp"
+#include "tcp_server.hpp"
+#include "tcp_client.hpp"
+
+// many simulated players against an in process tcp server on loopback
+// reports how long a tick takes to reach the clients, how long an input takes to reach the server and to come back acked,
+// how long inputs wait for their tick, how often the client prediction had to be corrected, and the bandwidth per client
+//
+typedef struct
+{
+	int clients = 64;
+	int threads = 4;
+	int players = 8;			// clients that get a frog, the rest only watch (a frog takes a cell of the starting line)
+	int spectators = 0;			// clients that join as spectators, read-only and never moving
+	int seconds = 5;
+	int tick_ms = 15;
+	int moves_per_second = 5;
+	uint32_t seed = 1234;
+} LOADGEN_OPTIONS;
+
+// send time of the last ticks, indexed by seq
+//
+#define TICK_HISTORY    4096
+
+static std::atomic<int64_t> tick_sent_at[ TICK_HISTORY ];
+
+static int64_t now( )
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ).time_since_epoch( ) ).count( );
+}
+
+static double percentile( std::vector<double>& samples, double quantile )
+{
+	if ( samples.empty( ) )
+		return 0;
+
+	const auto index = std::min( samples.size( ) - 1, static_cast<size_t>( quantile * samples.size( ) ) );
+	std::nth_element( samples.begin( ), samples.begin( ) + index, samples.end( ) );
+
+	return samples[ index ];
+}
+
+static void printLatency( const char* name, std::vector<double>& samples )
+{
+	std::printf( "%-16s %10zu %10.1f %10.1f %10.1f\n", name, samples.size( ),
+		percentile( samples, 0.5 ) / 1000.0, percentile( samples, 0.99 ) / 1000.0, percentile( samples, 0.999 ) / 1000.0 );
+}
+
+typedef struct
+{
+	TcpConnection connection;
+	int64_t next_move_at;
+	std::atomic<int64_t> move_sent_at;	// read by the io thread when the move comes out the other side
+	uint64_t frames;
+	uint32_t input_ack;
+	bool spectator;
+} SIMULATED_CLIENT;
+
+static void usage( const char* name )
+{
+	std::printf( "usage: %s [--clients N] [--threads N] [--players N] [--spectators N] [--seconds N] [--tick-ms N] [--moves N] [--seed N]\n", name );
+}
+
+int main( int argc, char** argv )
+{
+	LOADGEN_OPTIONS options;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool has_value = i + 1 < argc;
+
+		if ( !std::strcmp( argv[ i ], "--clients" ) && has_value )
+			options.clients = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--threads" ) && has_value )
+			options.threads = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--players" ) && has_value )
+			options.players = std::max( 0, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--spectators" ) && has_value )
+			options.spectators = std::max( 0, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--seconds" ) && has_value )
+			options.seconds = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--tick-ms" ) && has_value )
+			options.tick_ms = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--moves" ) && has_value )
+			options.moves_per_second = std::max( 0, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--seed" ) && has_value )
+			options.seed = static_cast<uint32_t>( std::strtoul( argv[ ++i ], nullptr, 10 ) );
+		else
+		{
+			usage( argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	options.threads = std::min( options.threads, options.clients );
+
+	GameSettings settings;
+	settings.tick_ms = options.tick_ms;
+
+	GameEngine engine( settings, Random( options.seed ) );
+
+	// the callbacks come from the io thread and only queue the inputs, the ticks from the scheduler thread apply them
+	//
+	int num_players = 0;
+
+	// server side of the input latency, filled once every client joined
+	//
+	std::unordered_map<uint32_t, SIMULATED_CLIENT*> clients_by_pid;
+	std::vector<double> input_samples;
+	std::atomic<bool> measuring = false;
+
+	TcpServer server( options.clients );
+	server.registerCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_JOIN, [ & ] ( uint32_t pid, FACING direction, uint32_t seq )
+		{
+			if ( num_players++ < options.players )
+				engine.queueInput( PLAYER_INPUT_JOIN, pid );
+		} );
+	server.registerCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_MOVE, [ & ] ( uint32_t pid, FACING direction, uint32_t seq )
+		{
+			if ( measuring )
+			{
+				const auto client = clients_by_pid.find( pid );
+				if ( client != clients_by_pid.end( ) )
+					input_samples.push_back( static_cast<double>( now( ) - client->second->move_sent_at.load( std::memory_order_acquire ) ) );
+			}
+
+			engine.queueInput( PLAYER_INPUT_MOVE, pid, direction, seq );
+		} );
+	server.registerCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_LEAVE, [ & ] ( uint32_t pid, FACING direction, uint32_t seq )
+		{
+			engine.queueInput( PLAYER_INPUT_LEAVE, pid );
+		} );
+
+	if ( !server.start( "127.0.0.1", 0 ) )
+		return 1;
+
+	std::vector<SIMULATED_CLIENT> clients( options.clients );
+	for ( auto& client : clients )
+	{
+		client.spectator = &client - clients.data( ) >= options.clients - options.spectators;
+
+		if ( !client.connection.connect( "127.0.0.1", server.getPort( ) ) || !client.connection.joinMatch( 0, client.spectator ? SPECTATOR : MULTIPLAYER, 2000 ) )
+		{
+			std::printf( "client %zu could not join\n", static_cast<size_t>( &client - clients.data( ) ) );
+			return 1;
+		}
+
+		client.frames = 0;
+		client.input_ack = 0;
+		clients_by_pid[ client.connection.getPid( ) ] = &client;
+	}
+
+	// the players start moving at random offsets, so the inputs don't all land on the same tick
+	//
+	const int64_t move_period = options.moves_per_second ? 1000000000LL / options.moves_per_second : 0;
+	const auto start = now( );
+	for ( auto& client : clients )
+		client.next_move_at = start + ( move_period ? engine.getRandom( ).generateInt( 0, static_cast<int>( move_period / 1000 ) ) * 1000LL : 0 );
+
+	TickScheduler scheduler( options.tick_ms );
+	std::thread tick_thread( [ & ] ( )
+		{
+			scheduler.run( [ & ] ( )
+				{
+					engine.processTick( );
+
+					const auto size = engine.getMapSize( );
+					const auto tick = static_cast<uint32_t>( engine.getTick( ) );
+
+					tick_sent_at[ tick % TICK_HISTORY ].store( now( ), std::memory_order_relaxed );
+					server.update( tick, engine.getEntityList( ), engine.getPlayerAcks( ), GAME_STATE_RUNNING, 0, 0, size.first, size.second );
+				} );
+		} );
+
+	measuring = true;
+
+	const auto deadline = start + options.seconds * 1000000000LL;
+	std::vector<std::vector<double>> frame_samples( options.threads ), ack_samples( options.threads );
+	std::vector<std::thread> workers;
+
+	for ( int t = 0; t < options.threads; t++ )
+	{
+		workers.emplace_back( [ &, t ] ( )
+			{
+				std::vector<TcpConnection*> connections;
+				std::vector<SIMULATED_CLIENT*> owned;
+				for ( size_t i = t; i < clients.size( ); i += options.threads )
+				{
+					connections.push_back( &clients[ i ].connection );
+					owned.push_back( &clients[ i ] );
+				}
+
+				auto& samples = frame_samples[ t ];
+				auto& acks = ack_samples[ t ];
+				SIMULATED_CLIENT* current = nullptr;
+
+				for ( const auto client : owned )
+					client->connection.setOnUpdateCallback( [ &samples, &acks, &current ] ( const DATA& data, uint32_t seq )
+						{
+							const auto time = now( );
+							samples.push_back( static_cast<double>( time - tick_sent_at[ seq % TICK_HISTORY ].load( std::memory_order_relaxed ) ) );
+							current->frames++;
+
+							// the round trip the prediction hides
+							//
+							const auto input_ack = current->connection.getInputAck( );
+							if ( input_ack != current->input_ack )
+							{
+								acks.push_back( static_cast<double>( time - current->move_sent_at.load( std::memory_order_relaxed ) ) );
+								current->input_ack = input_ack;
+							}
+						} );
+
+				static constexpr FACING pattern[ ] = { UP, LEFT, UP, RIGHT, DOWN, UP };
+
+				std::vector<size_t> ready;
+				while ( now( ) < deadline )
+				{
+					TcpConnection::waitAny( connections.data( ), connections.size( ), 1, ready );
+
+					for ( const auto index : ready )
+					{
+						current = owned[ index ];
+						current->connection.pump( 0 );
+					}
+
+					if ( !move_period )
+						continue;
+
+					const auto time = now( );
+					for ( const auto client : owned )
+					{
+						if ( client->spectator || time < client->next_move_at )
+							continue;
+
+						client->move_sent_at.store( time, std::memory_order_release );
+						client->connection.sendMove( pattern[ client->frames % std::size( pattern ) ] );
+						client->next_move_at = time + move_period;
+					}
+				}
+			} );
+	}
+
+	for ( auto& worker : workers )
+		worker.join( );
+
+	measuring = false;
+
+	scheduler.stop( );
+	tick_thread.join( );
+
+	for ( auto& client : clients )
+		client.connection.leaveMatch( );
+
+	server.stop( );
+
+	std::vector<double> all_frames, all_acks;
+	uint64_t total_frames = 0, total_bytes = 0, predicted = 0, corrected = 0;
+	for ( auto& samples : frame_samples )
+		all_frames.insert( all_frames.end( ), samples.begin( ), samples.end( ) );
+
+	for ( auto& samples : ack_samples )
+		all_acks.insert( all_acks.end( ), samples.begin( ), samples.end( ) );
+
+	for ( auto& client : clients )
+	{
+		total_frames += client.frames;
+		total_bytes += client.connection.getBytesReceived( );
+		predicted += client.connection.getPredictor( ).getPredicted( );
+		corrected += client.connection.getPredictor( ).getCorrected( );
+	}
+
+	const double elapsed = ( now( ) - start ) / 1e9;
+
+	std::printf( "clients=%d players=%d spectators=%d threads=%d tick=%dms moves=%d/s seconds=%d\n\n", options.clients, std::min( options.players, options.clients ),
+		std::min( options.spectators, options.clients ), options.threads, options.tick_ms, options.moves_per_second, options.seconds );
+	std::printf( "frames/s per client %.1f, bytes/frame %.0f, KB/s per client %.1f\n\n", total_frames / elapsed / options.clients,
+		total_frames ? static_cast<double>( total_bytes ) / total_frames : 0.0, total_bytes / elapsed / options.clients / 1024.0 );
+
+	std::printf( "%-16s %10s %10s %10s %10s\n", "latency (us)", "count", "p50", "p99", "p999" );
+	printLatency( "tick -> client", all_frames );
+	printLatency( "input -> server", input_samples );
+	printLatency( "input -> ack", all_acks );
+
+	const auto inputs = engine.getInputStats( );
+	std::printf( "\ninputs applied %llu, folded %llu, dropped %llu, average wait for the tick %.1f us\n", static_cast<unsigned long long>( inputs.applied ),
+		static_cast<unsigned long long>( inputs.coalesced ), static_cast<unsigned long long>( inputs.dropped ), inputs.applied ? inputs.wait_ns / 1000.0 / inputs.applied : 0.0 );
+	std::printf( "predicted moves %llu, corrected by the server %llu\n", static_cast<unsigned long long>( predicted ), static_cast<unsigned long long>( corrected ) );
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include "replay.hpp"
+#include "workers.hpp"
+
+// runs recorded games again as fast as they go, checking every tick hash the recording logged
+// a regression oracle for the simulation (exits with 1 on a desync) and a workload taken from real games for profiling
+//
+typedef struct
+{
+	std::vector<const char*> files;
+	int threads = 1;			// > 1 steps large boards on a pool, the replay has to come out the same
+	int repeat = 1;				// runs of every file, for a longer profile
+} REPLAY_OPTIONS;
+
+static void usage( const char* name )
+{
+	std::printf( "usage: %s FILE... [--threads N] [--repeat N]\n", name );
+}
+
+int main( int argc, char** argv )
+{
+	REPLAY_OPTIONS options;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		const bool has_value = i + 1 < argc;
+
+		if ( !std::strcmp( argv[ i ], "--threads" ) && has_value )
+			options.threads = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( !std::strcmp( argv[ i ], "--repeat" ) && has_value )
+			options.repeat = std::max( 1, std::atoi( argv[ ++i ] ) );
+		else if ( argv[ i ][ 0 ] != '-' )
+			options.files.push_back( argv[ i ] );
+		else
+		{
+			usage( argv[ 0 ] );
+			return 1;
+		}
+	}
+
+	if ( options.files.empty( ) )
+	{
+		usage( argv[ 0 ] );
+		return 1;
+	}
+
+	std::unique_ptr<WorkerPool> pool;
+	if ( options.threads > 1 )
+		pool = std::make_unique<WorkerPool>( options.threads );
+
+	int failed = 0;
+	for ( const auto file : options.files )
+	{
+		REPLAY_LOG log;
+		if ( !loadReplay( file, log ) )
+		{
+			std::printf( "%s: not a replay\n", file );
+			failed++;
+			continue;
+		}
+
+		std::printf( "%s: seed %u, %d roads x %d columns, %zu records%s\n", file, log.seed, log.settings.num_roads, log.settings.num_columns,
+			log.records.size( ), log.complete ? "" : " (cut short)" );
+
+		for ( int run = 0; run < options.repeat; run++ )
+		{
+			const auto start = std::chrono::steady_clock::now( );
+
+			REPLAY_RESULT result;
+			try
+			{
+				result = runReplay( log, pool.get( ) );
+			}
+			catch ( const std::exception& e )
+			{
+				std::printf( "  invalid settings: %s\n", e.what( ) );
+				failed++;
+				break;
+			}
+
+			const auto elapsed = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+
+			std::printf( "  ticks %llu, events %llu, checks %llu, %.3f s (%.0f ticks/s)", static_cast<unsigned long long>( result.ticks ),
+				static_cast<unsigned long long>( result.events ), static_cast<unsigned long long>( result.checks ), elapsed,
+				result.ticks / std::max( elapsed, 1e-9 ) );
+
+			if ( result.desync_tick != -1 )
+			{
+				std::printf( ", desync at tick %lld\n", static_cast<long long>( result.desync_tick ) );
+				failed++;
+				break;
+			}
+
+			std::printf( "\n" );
+		}
+	}
+
+	return failed ? 1 : 0;
+}
\ No newline at end of file
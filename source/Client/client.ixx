@@ -6,6 +6,8 @@ module;
 #include <Windows.h>
 #endif
 
+#include "protocol.hpp"
+
 export module client;
 
 #ifndef __INTELLISENSE__
@@ -27,7 +29,9 @@ private:
     inline static constexpr auto client_instance_sp = TEXT( "Local\\CRR_CLIENT_INSTANCE_SPH" );
 
 public:
-    Client( )
+    // a spectator doesn't take one of the player instances
+    //
+    Client( bool spectator = false )
     {
         console::log( TEXT( "Client Constructor" ) );
 
@@ -93,12 +97,17 @@ public:
         // initialize Server
         //
         ptr_server = new Server( );
-        ptr_server->setOnUpdateCallback( [ & ] ( const DATA& data )
+        ptr_server->setOnUpdateCallback( [ & ] ( const DATA& data, UINT32 seq )
+            {
+                onUpdate( data, seq );
+            } );
+        ptr_server->setOnMatchEndCallback( [ & ] ( )
             {
-                onUpdate( data );
+                MessageBox( nullptr, TEXT( "The match ended" ), TEXT( "Spectator" ), MB_OK );
+                ptr_ui->close( );
             } );
 
-        if ( checkMaxInstances( ) )
+        if ( !spectator && checkMaxInstances( ) )
         {
             MessageBox( nullptr, TEXT( "Max instances reached" ), TEXT( "Error" ), MB_OK | MB_ICONERROR);
             exit( 0 );
@@ -135,6 +144,17 @@ public:
         return ptr_server->isConnected( );
     }
 
+    // a read-only view of the first match running, the arrow keys do nothing
+    //
+    bool spectate( )
+    {
+        if ( !ptr_server->joinMatch( SPECTATOR ) )
+            return false;
+
+        ptr_ui->drawGame( );
+        return true;
+    }
+
     bool checkMaxInstances( )
     {
         instance_semaphore = CreateSemaphoreEx( nullptr, 0, 2, client_instance_sp, 0, SEMAPHORE_ALL_ACCESS );
@@ -153,9 +173,9 @@ public:
     }
 
 private:
-    void onUpdate( const DATA& data )
+    void onUpdate( const DATA& data, UINT32 seq )
     {
-        ptr_ui->updateGameData( data );
+        ptr_ui->updateGameData( data, seq );
 
         // todo: logica do jogo
     }
@@ -8,6 +8,7 @@ module;
 
 #include <map>
 #include "resource.h"
+#include "protocol.hpp"
 
 export module image;
 
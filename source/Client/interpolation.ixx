@@ -0,0 +1,193 @@
+module;
+
+// workaround to intellisense that might be not as smart as we thought
+//
+#if __INTELLISENSE__
+#include <vector>
+#include <chrono>
+#include <Windows.h>
+#endif
+
+#include "protocol.hpp"
+
+export module interpolation;
+
+#ifndef __INTELLISENSE__
+import <vector>;
+import <chrono>;
+import <Windows.h>;
+#endif
+
+import server;
+
+// an entity as it is drawn, in cells (a car driving from one cell to the next is somewhere in between)
+//
+export typedef struct
+{
+	ENTITY_TYPE type;
+	FACING direction;
+	double pos_x, pos_y;
+} RENDER_ENTITY;
+
+// what the client learned about the car in a slot from the frames it got
+//
+typedef struct
+{
+	int seen;				// 0 new, 1 seen entering a cell, 2 interval is known
+	std::chrono::steady_clock::time_point moved_at;		// when it entered its current cell
+	double interval_ms;		// time it takes per cell
+} MOTION;
+
+// keeps the last frames and turns them into positions for any point in time, so the board is drawn at the display rate
+// instead of whenever a frame arrives. the server moves a car one whole cell at a time, a car is drawn driving towards
+// its next cell at the pace it was seen moving, frogs and obstacles are drawn where the last frame has them
+//
+export class Interpolator
+{
+private:
+	// the frames may skip cells if they are sent less often than the cars move, more than this is a new car or level
+	//
+	inline static constexpr int max_cells = 4;
+
+	// weight of the newest measure in the interval, hides the jitter of the arrivals
+	//
+	inline static constexpr double smoothing = 0.25;
+
+	// a car this late for its next cell was stopped (frozen, or waiting on a blocked cell), it goes back to its own
+	//
+	inline static constexpr double overdue = 1.5;
+
+	inline static constexpr int step_x[ ] = { 0, 0, -1, 1 };	// UP, DOWN, LEFT, RIGHT
+	inline static constexpr int step_y[ ] = { 1, -1, 0, 0 };
+
+	// [ latest ], [ latest ^ 1 ] is the one before
+	//
+	DATA frames[ 2 ] { };
+	UINT32 seqs[ 2 ] { };
+	int latest = 0, count = 0;
+
+	// one per slot, grows with the board
+	//
+	std::vector<MOTION> motion;
+
+	std::vector<RENDER_ENTITY> entities;
+
+public:
+	void reset( )
+	{
+		count = 0;
+		entities.clear( );
+	}
+
+	void push( const DATA& data, UINT32 seq, std::chrono::steady_clock::time_point now )
+	{
+		// same tick again (the own frog was predicted), nothing drove
+		//
+		if ( count && seq == seqs[ latest ] )
+		{
+			frames[ latest ] = data;
+			return;
+		}
+
+		latest ^= 1;
+		frames[ latest ] = data;
+		seqs[ latest ] = seq;
+		count = count < 2 ? count + 1 : 2;
+
+		const auto& previous = frames[ latest ^ 1 ];
+
+		if ( motion.size( ) < data.num_entities )
+			motion.resize( data.num_entities, MOTION { 0, now, 0 } );
+
+		for ( int i = 0; i < data.num_entities; i++ )
+		{
+			const auto& entity = data.entities[ i ];
+			auto& car = motion[ i ];
+
+			if ( count < 2 || entity.type != ENTITY_TYPE_CAR || i >= previous.num_entities || previous.entities[ i ].type != ENTITY_TYPE_CAR )
+			{
+				car = { 0, now, 0 };
+				continue;
+			}
+
+			const auto cells = cellsDriven( previous.entities[ i ], entity, data.width );
+			if ( !cells )
+				continue;
+
+			if ( cells < 0 )
+			{
+				car = { 0, now, 0 };
+				continue;
+			}
+
+			// the first move only tells when the car entered the cell, the time per cell needs a second one
+			//
+			const auto elapsed = std::chrono::duration<double, std::milli>( now - car.moved_at ).count( ) / cells;
+			if ( car.seen == 1 )
+				car.interval_ms = elapsed;
+			else if ( car.seen == 2 )
+				car.interval_ms += smoothing * ( elapsed - car.interval_ms );
+
+			car.seen = car.seen < 2 ? car.seen + 1 : 2;
+			car.moved_at = now;
+		}
+	}
+
+	// the latest frame (board size, state) or nullptr before the first one
+	//
+	const DATA* getData( )
+	{
+		return count ? &frames[ latest ] : nullptr;
+	}
+
+	// the entities as they look at now, the vector is reused by the next call
+	//
+	const std::vector<RENDER_ENTITY>& sample( std::chrono::steady_clock::time_point now )
+	{
+		entities.clear( );
+		if ( !count )
+			return entities;
+
+		const auto& data = frames[ latest ];
+		for ( int i = 0; i < data.num_entities; i++ )
+		{
+			const auto& entity = data.entities[ i ];
+
+			RENDER_ENTITY render { entity.type, entity.direction, static_cast<double>( entity.pos_x ), static_cast<double>( entity.pos_y ) };
+
+			const auto& car = motion[ i ];
+			if ( entity.type == ENTITY_TYPE_CAR && car.seen == 2 && car.interval_ms > 0 && entity.direction >= UP && entity.direction <= RIGHT )
+			{
+				auto progress = std::chrono::duration<double, std::milli>( now - car.moved_at ).count( ) / car.interval_ms;
+				if ( progress > overdue )
+					progress = 0;
+
+				progress = progress < 0 ? 0 : ( progress > 1 ? 1 : progress );
+
+				render.pos_x += step_x[ entity.direction ] * progress;
+				render.pos_y += step_y[ entity.direction ] * progress;
+			}
+
+			entities.push_back( render );
+		}
+
+		return entities;
+	}
+
+private:
+	// cells a car drove between two frames (wrapping around the board), 0 if it stayed and -1 if it can't have driven there
+	//
+	static int cellsDriven( const ENTITY& from, const ENTITY& to, int width )
+	{
+		if ( from.pos_x == to.pos_x && from.pos_y == to.pos_y )
+			return 0;
+
+		if ( from.pos_y != to.pos_y || width <= 0 || ( to.direction != LEFT && to.direction != RIGHT ) )
+			return -1;
+
+		auto cells = ( to.pos_x - from.pos_x ) * step_x[ to.direction ];
+		cells = ( ( cells % width ) + width ) % width;
+
+		return cells > 0 && cells <= max_cells ? cells : -1;
+	}
+};
\ No newline at end of file
@@ -16,9 +16,13 @@ void exitHandler( )
     client = nullptr;
 }
 
-int main( )
+int main( int argc, char* argv[ ] )
 {
-    client = new Client( );
+    // --spectate watches a match instead of playing one
+    //
+    const bool spectator = argc > 1 && !lstrcmpA( argv[ 1 ], "--spectate" );
+
+    client = new Client( spectator );
 
     atexit( exitHandler );
 
@@ -28,6 +32,12 @@ int main( )
         exit( 1 );
     }
 
+    if ( spectator && !client->spectate( ) )
+    {
+        MessageBox( nullptr, TEXT( "No match to watch" ), TEXT( "Spectate" ), MB_OK | MB_ICONERROR );
+        exit( 1 );
+    }
+
     MSG msg;
     while ( GetMessage( &msg, nullptr, 0, 0 ) )
     {
@@ -3,14 +3,21 @@
 // workaround to intellisense that might be not as smart as we thought
 //
 #if __INTELLISENSE__
+#include <deque>
+#include <vector>
 #include <utility>
 #include <Windows.h>
 #include <functional>
 #endif
 
+#include "protocol.hpp"
+#include "prediction.hpp"
+
 export module server;
 
 #ifndef __INTELLISENSE__
+import <deque>;
+import <vector>;
 import <utility>;
 import <Windows.h>;
 import <functional>;
@@ -19,56 +26,15 @@ import <functional>;
 import console;
 import settings;
 
-#define MAX_ENTITIES    160  // 10 - 2 = 8, 8 * 20 = 160
-
-export typedef enum
-{
-	UP,
-	DOWN,
-	LEFT,
-	RIGHT
-} FACING;
-
-export typedef enum
-{
-	ENTITY_TYPE_OBSTACLE,
-	ENTITY_TYPE_CAR,
-	ENTITY_TYPE_FROG,
-	ENTITY_TYPE_MAX
-} ENTITY_TYPE;
-
-export typedef struct
-{
-	ENTITY_TYPE type;
-	FACING direction;
-	int pos_x, pos_y;
-} ENTITY;
-
-export typedef enum
-{
-	SINGLEPLAYER,
-	MULTIPLAYER
-} GAME_TYPE;
-
 export typedef enum
 {
 	MOVE,
 	JOIN,
 	LEAVE,
-	UPDATE
+	UPDATE,
+	SYNC
 } GAME_INFO_TYPE;
 
-export enum GAME_STATE
-{
-	GAME_STATE_READY,
-	GAME_STATE_RUNNING,
-	GAME_STATE_PLAYER1_WINS,
-	GAME_STATE_PLAYER2_WINS,
-	GAME_STATE_DRAW,
-	GAME_STATE_LOSS,
-	GAME_STATE_MAX
-};
-
 export typedef struct
 {
 	DWORD pid;
@@ -79,6 +45,7 @@ export typedef struct
 		struct
 		{
 			FACING direction;
+			UINT32 seq;		// handed back in the frames as input_ack
 		} move;
 
 		struct
@@ -88,22 +55,13 @@ export typedef struct
 	};
 } GAME_PIPE_IN;
 
-export typedef struct
-{
-	GAME_STATE state;
-	int time, level;
-	int width, height;
-	int num_entities;
-	ENTITY entities[ MAX_ENTITIES ];
-} DATA;
-
 export typedef struct
 {
 	GAME_INFO_TYPE type;
 
 	union
 	{
-		DATA data;
+		FRAME_HEADER frame;		// UPDATE, followed by frame.num_records records
 		bool status;
 	};
 } GAME_PIPE_OUT;
@@ -118,21 +76,43 @@ private:
 	HANDLE h_event = nullptr;
 
 	bool is_playing = false;
+	bool is_spectating = false;		// joined as SPECTATOR, moves aren't sent
 
 	HANDLE h_pipe = nullptr, h_thread = nullptr;
 
 	HANDLE h_exit_thread = nullptr;
 
-	bool send_keys = false;
-	FACING send_dir = UP;
-
-	std::function<void( const DATA& data )> on_update_callback = nullptr;
+	// the pipe is opened for overlapped io, reads and writes each wait on their own event
+	// h_wake_event gets the game thread out of its wait to send a move or to leave
+	//
+	HANDLE h_read_event = nullptr, h_write_event = nullptr, h_wake_event = nullptr;
+
+	std::function<void( const DATA& data, UINT32 seq )> on_update_callback = nullptr;
+	std::function<void( )> on_end_callback = nullptr;
+
+	// local copy of the game state, rebuilt from the keyframe and deltas the server sends
+	//
+	DATA replica { };
+	UINT32 replica_seq = 0;
+	bool awaiting_keyframe = false;
+
+	// client side prediction of the own frog
+	// a key press moves it right away, every frame replaces it and replays the inputs the server hasn't taken yet
+	// the ui thread predicts and queues the moves, the game thread sends them and reconciles, both under prediction_lock
+	//
+	CRITICAL_SECTION prediction_lock;
+	std::deque<GAME_PIPE_IN> moves;
+	Predictor predictor;
+	DATA view { };			// the replica with the own frog where we predict it
+	UINT32 view_seq = 0;
 
 public:
 	Server( )
 	{
 		console::log( TEXT( "Server Constructor" ) );
 
+		InitializeCriticalSection( &prediction_lock );
+
 		h_event = OpenEvent( SYNCHRONIZE, false, close_event );
 		if ( !h_event )
 		{
@@ -140,11 +120,25 @@ public:
 			return;
 		}
 
+		h_read_event = CreateEvent( nullptr, true, false, nullptr );
+		h_write_event = CreateEvent( nullptr, true, false, nullptr );
+		h_wake_event = CreateEvent( nullptr, false, false, nullptr );
+		if ( !h_read_event || !h_write_event || !h_wake_event )
+		{
+			console::log( TEXT( "CreateEvent failed: " ), GetLastError( ) );
+
+			closeEvents( );
+			CloseHandle( h_event );
+			h_event = nullptr;
+			return;
+		}
+
 		h_exit_thread = CreateThread( nullptr, NULL, reinterpret_cast<LPTHREAD_START_ROUTINE>( exitRoutine ), this, NULL, nullptr );
 		if ( !h_exit_thread )
 		{
 			console::log( TEXT( "CreateThread failed: " ), GetLastError( ) );
 
+			closeEvents( );
 			CloseHandle( h_event );
 			h_event = nullptr;
 			return;
@@ -161,6 +155,8 @@ public:
 
 		leaveMatch( );
 
+		closeEvents( );
+
 		if ( h_event )
 		{
 			CloseHandle( h_event );
@@ -168,6 +164,8 @@ public:
 			h_event = nullptr;
 		}
 
+		DeleteCriticalSection( &prediction_lock );
+
 		console::log( TEXT( "Server Destructor" ) );
 	}
 
@@ -186,7 +184,7 @@ public:
 		if ( !isConnected( ) || isPlaying( ) )
 			return false;
 
-		h_pipe = CreateFile( game_pipe, GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, NULL, nullptr );
+		h_pipe = CreateFile( game_pipe, GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr );
 		if ( h_pipe == INVALID_HANDLE_VALUE )
 		{
 			h_pipe = nullptr;
@@ -197,7 +195,7 @@ public:
 		in.pid = GetCurrentProcessId( );
 		in.type = JOIN;
 		in.join.type = type;
-		if ( !WriteFile( h_pipe, &in, sizeof( in ), nullptr, nullptr ) )
+		if ( !transfer( true, &in, sizeof( in ), h_write_event ) )
 		{
 			console::log( TEXT( "WriteFile failed: " ), GetLastError( ) );
 
@@ -207,7 +205,7 @@ public:
 		}
 
 		GAME_PIPE_OUT out;
-		if ( !ReadFile( h_pipe, &out, sizeof( out ), nullptr, nullptr ) )
+		if ( !transfer( false, &out, sizeof( out ), h_read_event ) )
 		{
 			console::log( TEXT( "ReadFile failed: " ), GetLastError( ) );
 
@@ -226,6 +224,19 @@ public:
 		}
 
 		is_playing = true;
+		is_spectating = type == SPECTATOR;
+
+		// the server starts the stream with a keyframe
+		//
+		replica = { };
+		replica_seq = 0;
+		awaiting_keyframe = false;
+
+		EnterCriticalSection( &prediction_lock );
+		moves.clear( );
+		predictor.reset( );
+		view = { };
+		LeaveCriticalSection( &prediction_lock );
 
 		h_thread = CreateThread( nullptr, NULL, reinterpret_cast<LPTHREAD_START_ROUTINE>( gameRoutine ), this, NULL, nullptr );
 		if ( !h_thread )
@@ -233,7 +244,7 @@ public:
 			is_playing = false;
 
 			in.type = LEAVE;
-			if ( !WriteFile( h_pipe, &in, sizeof( in ), nullptr, nullptr ) )
+			if ( !transfer( true, &in, sizeof( in ), h_write_event ) )
 				console::log( TEXT( "WriteFile failed: " ), GetLastError( ) );
 
 			CloseHandle( h_pipe );
@@ -250,6 +261,7 @@ public:
 			return;
 
 		is_playing = false;
+		SetEvent( h_wake_event );
 
 		if ( getStatus( h_thread ) == -1 )
 			WaitForSingleObjectEx( h_thread, INFINITE, false );
@@ -260,29 +272,60 @@ public:
 		GAME_PIPE_IN in { };
 		in.pid = GetCurrentProcessId( );
 		in.type = LEAVE;
-		if ( !WriteFile( h_pipe, &in, sizeof( in ), nullptr, nullptr ) )
+		if ( !transfer( true, &in, sizeof( in ), h_write_event ) )
 			console::log( TEXT( "WriteFile failed: " ), GetLastError( ) );
 
 		CloseHandle( h_pipe );
 		h_pipe = nullptr;
 	}
 
+	// the frog is redrawn where we predict it before the move even left
+	//
 	bool sendMove( FACING direction )
 	{
-		if ( !isPlaying( ) || !isConnected( ) )
+		if ( !isPlaying( ) || is_spectating || !isConnected( ) )
 			return false;
 
-		send_dir = direction;
-		send_keys = true;
+		EnterCriticalSection( &prediction_lock );
+
+		GAME_PIPE_IN in { };
+		in.pid = GetCurrentProcessId( );
+		in.type = MOVE;
+		in.move.direction = direction;
+
+		// the view is only redrawn if the frog moved locally, predict( ) counts those moves
+		//
+		const auto predicted = predictor.getPredicted( );
+		in.move.seq = predictor.predict( direction );
+		moves.push_back( in );
+
+		if ( predictor.getPredicted( ) != predicted && on_update_callback )
+		{
+			predictor.apply( view );
+			on_update_callback( view, view_seq );
+		}
+
+		LeaveCriticalSection( &prediction_lock );
+
+		SetEvent( h_wake_event );
 
 		return true;
 	}
 
-	void setOnUpdateCallback( std::function<void( const DATA& data )> callback )
+	// called with the view and the tick it shows, from the game thread (or the caller of sendMove for a predicted move)
+	//
+	void setOnUpdateCallback( std::function<void( const DATA& data, UINT32 seq )> callback )
 	{
 		on_update_callback = callback;
 	}
 
+	// called from the game thread once the match we watched is over, no frames follow
+	//
+	void setOnMatchEndCallback( std::function<void( )> callback )
+	{
+		on_end_callback = callback;
+	}
+
 private:
 	static DWORD WINAPI exitRoutine( Server* _this )
 	{
@@ -303,51 +346,198 @@ private:
 		std::exit( ret_cause != WAIT_OBJECT_0 );
 	}
 
+	// waits for the next frame or for a move to send, without spinning on the pipe
+	//
 	static DWORD WINAPI gameRoutine( Server* _this )
 	{
 		GAME_PIPE_OUT out { };
+		DWORD out_bytes = 0;
+		std::vector<char> records;
+		std::deque<GAME_PIPE_IN> moves;		// taken from the ui thread in one go
+
+		OVERLAPPED overlapped { };
+		bool reading = false;
+
 		while ( _this->is_playing )
 		{
-			if ( _this->send_keys )
+			if ( !reading )
 			{
-				GAME_PIPE_IN in;
-				in.pid = GetCurrentProcessId( );
-				in.type = MOVE;
-				in.move.direction = _this->send_dir;
-				if ( !WriteFile( _this->h_pipe, &in, sizeof( in ), nullptr, nullptr ) )
-					console::log( TEXT( "WriteFile failed: " ), GetLastError( ) );
-
-				_this->send_keys = false;
+				memset( &overlapped, 0, sizeof( overlapped ) );
+				overlapped.hEvent = _this->h_read_event;
+				if ( !ReadFile( _this->h_pipe, reinterpret_cast<char*>( &out ) + out_bytes, sizeof( out ) - out_bytes, nullptr, &overlapped ) &&
+					GetLastError( ) != ERROR_IO_PENDING )
+				{
+					console::log( TEXT( "ReadFile failed: " ), GetLastError( ) );
+					break;
+				}
+
+				reading = true;
 			}
-			
-			DWORD available;
-			if ( !PeekNamedPipe( _this->h_pipe, nullptr, NULL, nullptr, &available, nullptr ) )
+
+			const HANDLE events[ ] = { _this->h_read_event, _this->h_wake_event };
+			const auto result = WaitForMultipleObjects( 2, events, false, INFINITE );
+			if ( !_this->is_playing )
+				break;
+
+			if ( result == WAIT_OBJECT_0 + 1 )
 			{
-				console::log( TEXT( "PeekNamedPipe failed: " ), GetLastError( ) );
+				EnterCriticalSection( &_this->prediction_lock );
+				moves.swap( _this->moves );
+				LeaveCriticalSection( &_this->prediction_lock );
+
+				for ( auto& in : moves )
+					if ( !_this->transfer( true, &in, sizeof( in ), _this->h_write_event ) )
+						console::log( TEXT( "WriteFile failed: " ), GetLastError( ) );
+
+				moves.clear( );
 				continue;
 			}
 
-			if ( available < sizeof( out ) )
-				continue;
+			if ( result != WAIT_OBJECT_0 )
+			{
+				console::log( TEXT( "WaitForMultipleObjects failed: " ), GetLastError( ) );
+				break;
+			}
 
-			if ( !ReadFile( _this->h_pipe, &out, sizeof( out ), nullptr, nullptr ) )
+			DWORD bytes = 0;
+			reading = false;
+			if ( !GetOverlappedResult( _this->h_pipe, &overlapped, &bytes, false ) )
 			{
 				console::log( TEXT( "ReadFile failed: " ), GetLastError( ) );
+				break;
+			}
+
+			out_bytes += bytes;
+			if ( out_bytes < sizeof( out ) )
 				continue;
+
+			out_bytes = 0;
+
+			// the server drops the pipe right after it
+			//
+			if ( out.type == LEAVE )
+			{
+				if ( _this->on_end_callback )
+					_this->on_end_callback( );
+
+				break;
 			}
 
 			if ( out.type != UPDATE )
 				continue;
 
-			if ( !_this->on_update_callback )
+			const auto record_size = out.frame.type == FRAME_KEYFRAME ? sizeof( ENTITY ) : sizeof( ENTITY_DELTA );
+			if ( out.frame.num_records < 0 || out.frame.num_records > MAX_BOARD_CELLS )
+			{
+				_this->requestKeyframe( );
+				continue;
+			}
+
+			// the records are written together with the header, so they are already on their way
+			//
+			records.resize( out.frame.num_records * record_size );
+			if ( !records.empty( ) && !_this->transfer( false, records.data( ), static_cast<DWORD>( records.size( ) ), _this->h_read_event ) )
+			{
+				console::log( TEXT( "ReadFile failed: " ), GetLastError( ) );
+				break;
+			}
+
+			if ( !_this->applyFrame( out.frame, records.data( ) ) )
+			{
+				_this->requestKeyframe( );
 				continue;
+			}
+
+			EnterCriticalSection( &_this->prediction_lock );
+
+			_this->predictor.reconcile( _this->replica, out.frame.input_ack, out.frame.player_slot );
+
+			_this->view = _this->replica;
+			_this->view_seq = _this->replica_seq;
+			_this->predictor.apply( _this->view );
+
+			if ( _this->on_update_callback )
+				_this->on_update_callback( _this->view, _this->view_seq );
+
+			LeaveCriticalSection( &_this->prediction_lock );
+		}
 
-			_this->on_update_callback( out.data );
+		// the read still in flight points into this stack frame
+		//
+		if ( reading )
+		{
+			DWORD bytes = 0;
+			CancelIoEx( _this->h_pipe, &overlapped );
+			GetOverlappedResult( _this->h_pipe, &overlapped, &bytes, true );
 		}
 
 		return 0;
 	}
 
+	// blocking transfer on the overlapped pipe
+	//
+	bool transfer( bool write, void* buffer, DWORD size, HANDLE h_io_event )
+	{
+		DWORD total = 0;
+		while ( total < size )
+		{
+			OVERLAPPED overlapped { };
+			overlapped.hEvent = h_io_event;
+
+			const auto ptr = static_cast<char*>( buffer ) + total;
+			const auto started = write ? WriteFile( h_pipe, ptr, size - total, nullptr, &overlapped ) : ReadFile( h_pipe, ptr, size - total, nullptr, &overlapped );
+			if ( !started && GetLastError( ) != ERROR_IO_PENDING )
+				return false;
+
+			DWORD bytes = 0;
+			if ( !GetOverlappedResult( h_pipe, &overlapped, &bytes, true ) || !bytes )
+				return false;
+
+			total += bytes;
+		}
+
+		return true;
+	}
+
+	void closeEvents( )
+	{
+		for ( auto h : { &h_read_event, &h_write_event, &h_wake_event } )
+		{
+			if ( !*h )
+				continue;
+
+			CloseHandle( *h );
+			*h = nullptr;
+		}
+	}
+
+	void requestKeyframe( )
+	{
+		if ( awaiting_keyframe )
+			return;
+
+		awaiting_keyframe = true;
+
+		GAME_PIPE_IN in { };
+		in.pid = GetCurrentProcessId( );
+		in.type = SYNC;
+		if ( !transfer( true, &in, sizeof( in ), h_write_event ) )
+			console::log( TEXT( "WriteFile failed: " ), GetLastError( ) );
+	}
+
+	// fails if the frame doesn't apply on top of the replica, the server then has to send a keyframe
+	//
+	bool applyFrame( const FRAME_HEADER& header, const char* records )
+	{
+		if ( !::applyFrame( replica, replica_seq, header, records ) )
+			return false;
+
+		if ( header.type == FRAME_KEYFRAME )
+			awaiting_keyframe = false;
+
+		return true;
+	}
+
 	DWORD getStatus( HANDLE h_thread )
 	{
 		DWORD status = NULL;
@@ -3,6 +3,7 @@ module;
 // workaround to intellisense that might be not as smart as we thought.
 //
 #if __INTELLISENSE__
+#include <chrono>
 #include <Windows.h>
 #include <windowsx.h>
 #include <functional>
@@ -10,6 +11,8 @@ module;
 
 #include "resource.h"
 
+#include "protocol.hpp"
+
 #include "window.hpp"
 
 #include "DraculaTheme.hpp"
@@ -17,6 +20,7 @@ module;
 export module ui;
 
 #ifndef __INTELLISENSE__
+import <chrono>;
 import <Windows.h>;
 import <windowsx.h>;
 import <functional>;
@@ -24,6 +28,7 @@ import <functional>;
 
 import image;
 import server;
+import interpolation;
 import console;
 import settings;
 
@@ -56,7 +61,9 @@ export typedef enum
 export class UI
 {
 private:
-    DATA game_data { };
+    // frames go in as they arrive, the board is drawn from it at the display rate
+    //
+    Interpolator interpolator;
     HDC mem_hdc = nullptr;
 
     Window* ptr_wnd = nullptr;
@@ -76,6 +83,8 @@ private:
 
     static constexpr auto square_size = std::make_pair( 40, 40 );
 
+    static constexpr UINT_PTR render_timer = 1;
+
 public:
     UI( )
     {
@@ -288,8 +297,20 @@ public:
             {
                 return paintGame( );
             } );
+        ptr_game_board->registerCallback( WM_TIMER, [ & ] ( WPARAM wParam, LPARAM )
+            {
+                if ( wParam != render_timer )
+                    return std::make_pair( false, 0 );
+
+                // the back buffer covers the whole board, erasing it first would only flicker
+                //
+                InvalidateRect( ptr_game_board->getHandle( ), nullptr, false );
+                return std::make_pair( true, 0 );
+            } );
         ptr_game_board->registerCallback( WM_DESTROY, [ & ] ( WPARAM wParam, LPARAM lParam )
             {
+                KillTimer( ptr_game_board->getHandle( ), render_timer );
+
                 if ( mem_hdc )
                 {
                     DeleteDC( mem_hdc );
@@ -301,6 +322,18 @@ public:
             } );
 
         SetWindowPos( ptr_game_board->getHandle( ), HWND_BOTTOM, 0, 0, 0, 0, SWP_NOMOVE | SWP_NOSIZE | SWP_NOACTIVATE );
+
+        EnterCriticalSection( &critical_section );
+        interpolator.reset( );
+        LeaveCriticalSection( &critical_section );
+
+        // one frame per refresh of the monitor, however often the server sends them
+        //
+        const auto hdc = GetDC( ptr_game_board->getHandle( ) );
+        const auto refresh_rate = GetDeviceCaps( hdc, VREFRESH );
+        ReleaseDC( ptr_game_board->getHandle( ), hdc );
+
+        SetTimer( ptr_game_board->getHandle( ), render_timer, 1000 / ( refresh_rate > 1 ? refresh_rate : 60 ), nullptr );
     }
 
     void drawPreGame( )
@@ -373,15 +406,22 @@ public:
             } );
     }
 
-    void updateGameData( const DATA& data )
+    // safe from any thread, the window is destroyed by its own
+    //
+    void close( )
+    {
+        PostMessage( ptr_wnd->getHandle( ), WM_CLOSE, 0, 0 );
+    }
+
+    // the board isn't redrawn here, the render timer picks the frame up
+    //
+    void updateGameData( const DATA& data, UINT32 seq )
     {
         EnterCriticalSection( &critical_section );
 
-        memcpy( &game_data, &data, sizeof( data ) );
+        interpolator.push( data, seq, std::chrono::steady_clock::now( ) );
 
         LeaveCriticalSection( &critical_section );
-
-        ptr_game_board->redraw( );
     }
 
 private:
@@ -526,17 +566,29 @@ private:
 
         FillRect( mem_hdc, &rect, reinterpret_cast<HBRUSH>( GetClassLongPtr( ptr_wnd->getHandle( ), GCLP_HBRBACKGROUND ) ) );
 
-        if ( game_data.height && game_data.width )
+        const auto game_data = interpolator.getData( );
+        if ( game_data && game_data->height && game_data->width )
         {
-            const auto measures = std::make_pair( square_size.first * game_data.width, square_size.second * game_data.height );
+            // a board wider or taller than the window is drawn with smaller squares
+            //
+            auto square = square_size;
+            if ( square.first * game_data->width > this->measures.first )
+                square.first = this->measures.first > game_data->width ? this->measures.first / game_data->width : 1;
+            if ( square.second * game_data->height > this->measures.second )
+                square.second = this->measures.second > game_data->height ? this->measures.second / game_data->height : 1;
+
+            const auto measures = std::make_pair( square.first * game_data->width, square.second * game_data->height );
             const auto pos = std::make_pair( ( this->measures.first - measures.first ) / 2, ( this->measures.second - measures.second ) / 2 );
 
-            for ( int i = 0; i < game_data.num_entities; i++ )
-            {
-                const auto& entity = game_data.entities[ i ];
+            // a car leaving one side of the board shows up on the other, keep what hangs over the edge off the screen
+            //
+            const auto saved_dc = SaveDC( mem_hdc );
+            IntersectClipRect( mem_hdc, pos.first, pos.second, pos.first + measures.first, pos.second + measures.second );
 
-                if ( entity.pos_x >= game_data.width || entity.pos_x < 0 ||
-                    entity.pos_y >= game_data.height || entity.pos_y < 0 )
+            for ( const auto& entity : interpolator.sample( std::chrono::steady_clock::now( ) ) )
+            {
+                if ( entity.pos_x >= game_data->width || entity.pos_x <= -1 ||
+                    entity.pos_y >= game_data->height || entity.pos_y < 0 )
                 {
                     console::log( TEXT( "Invalid Entity found at (" ), entity.pos_x, TEXT( ", " ), entity.pos_y, TEXT( "): 0x" ), &entity );
                     continue;
@@ -552,14 +604,21 @@ private:
                 auto image_hdc = CreateCompatibleDC( hdc );
                 auto old_bm = SelectObject( image_hdc, h_image );
 
-                const auto x = pos.first + entity.pos_x * square_size.first;
-                const auto y = ( pos.second + measures.second ) - ( entity.pos_y + 1 ) * square_size.second;
+                const auto x = pos.first + static_cast<int>( entity.pos_x * square.first );
+                const auto y = ( pos.second + measures.second ) - static_cast<int>( ( entity.pos_y + 1 ) * square.second );
 
-                StretchBlt( mem_hdc, x, y, square_size.first, square_size.second, image_hdc, 0, 0, bm.bmWidth, bm.bmHeight, SRCCOPY );
+                StretchBlt( mem_hdc, x, y, square.first, square.second, image_hdc, 0, 0, bm.bmWidth, bm.bmHeight, SRCCOPY );
+
+                if ( entity.pos_x > game_data->width - 1 )
+                    StretchBlt( mem_hdc, x - measures.first, y, square.first, square.second, image_hdc, 0, 0, bm.bmWidth, bm.bmHeight, SRCCOPY );
+                else if ( entity.pos_x < 0 )
+                    StretchBlt( mem_hdc, x + measures.first, y, square.first, square.second, image_hdc, 0, 0, bm.bmWidth, bm.bmHeight, SRCCOPY );
 
                 SelectObject( image_hdc, old_bm );
                 DeleteDC( image_hdc );
             }
+
+            RestoreDC( mem_hdc, saved_dc );
         }
 
         LeaveCriticalSection( &critical_section );
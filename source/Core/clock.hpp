@@ -0,0 +1,31 @@
+#pragma once
+
+#include <chrono>
+
+// monotonic time source, injectable so the tick loop can be driven by something other than the OS clock
+//
+class Clock
+{
+public:
+	virtual ~Clock( )
+	{
+
+	}
+
+	virtual std::chrono::nanoseconds now( ) = 0;
+};
+
+class SteadyClock : public Clock
+{
+public:
+	std::chrono::nanoseconds now( ) override
+	{
+		return std::chrono::steady_clock::now( ).time_since_epoch( );
+	}
+
+	static SteadyClock& instance( )
+	{
+		static SteadyClock clock;
+		return clock;
+	}
+};
@@ -0,0 +1,393 @@
+#include "engine.hpp"
+
+#include <chrono>
+
+#include "metrics.hpp"
+
+static int64_t steadyNow( )
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ).time_since_epoch( ) ).count( );
+}
+
+GameEngine::GameEngine( const GameSettings& settings, const Random& random ) : settings( settings ), random( random )
+{
+	pmap = new Map( this->settings, this->random, road_pool );
+}
+
+GameEngine::~GameEngine( )
+{
+	stopRecording( );
+
+	if ( pmap )
+		delete pmap;
+}
+
+void GameEngine::restart( )
+{
+	record( { REPLAY_RESTART, tick } );
+
+	pmap->reset( );
+	tick = 0;
+}
+
+void GameEngine::setWorkerPool( WorkerPool* ppool )
+{
+	this->ppool = ppool;
+	pmap->setWorkerPool( ppool );
+}
+
+bool GameEngine::processTick( )
+{
+	MetricTimer timer( METRIC_TICK );
+
+	applyInputs( );
+
+	bool processed = pmap->processTick( );
+
+	auto& frogs = pmap->getFrogs( );
+	for ( int i = 0; i < frogs.size( ); i++ )
+	{
+		if ( frogs.getAfkTimer( i ) < settings.max_afk_timer )
+			continue;
+
+		frogs.setAfkTimer( i, 0 );
+		frogs.setPosition( i, random.generateInt( 0, pmap->getSize( ).first - 1 ), 0 );
+
+		processed = true;
+	}
+
+	tick++;
+
+	if ( precorder && precorder->isCheckDue( tick ) )
+	{
+		REPLAY_RECORD check { REPLAY_CHECK, tick };
+		check.hash = getStateHash( );
+
+		precorder->record( check );
+	}
+
+	return processed;
+}
+
+uint64_t GameEngine::getTick( )
+{
+	return tick;
+}
+
+uint64_t GameEngine::getTime( )
+{
+	return tick * settings.tick_ms;
+}
+
+std::pair<int, int> GameEngine::getMapSize( )
+{
+	return pmap->getSize( );
+}
+
+std::span<const Entity> GameEngine::getEntityList( )
+{
+	entity_list.clear( );
+	entity_list.reserve( pmap->getEntityCount( ) );
+
+	pmap->forEachEntity( [ this ] ( const Entity& entity ) { entity_list.push_back( entity ); } );
+
+	return entity_list;
+}
+
+bool GameEngine::placeRock( int x, int y )
+{
+	REPLAY_RECORD rock { REPLAY_PLACE_ROCK, tick };
+	rock.x = x;
+	rock.y = y;
+	record( rock );
+
+	return pmap->placeRock( x, y );
+}
+
+void GameEngine::setFrozen( bool frozen )
+{
+	REPLAY_RECORD freeze { REPLAY_FREEZE, tick };
+	freeze.road = -1;
+	freeze.frozen = frozen;
+	record( freeze );
+
+	for ( auto& road : pmap->getRoads( ) )
+		road->setFrozen( frozen );
+}
+
+bool GameEngine::setFrozen( bool frozen, int index )
+{
+	if ( index < 0 || index >= pmap->getRoads( ).size( ) )
+		return false;
+
+	REPLAY_RECORD freeze { REPLAY_FREEZE, tick };
+	freeze.road = index;
+	freeze.frozen = frozen;
+	record( freeze );
+
+	pmap->getRoads( ).at( index )->setFrozen( frozen );
+	return true;
+}
+
+void GameEngine::invert( )
+{
+	REPLAY_RECORD invert { REPLAY_INVERT, tick };
+	invert.road = -1;
+	record( invert );
+
+	for ( auto& road : pmap->getRoads( ) )
+		road->invert( );
+}
+
+bool GameEngine::invert( int index )
+{
+	if ( index < 0 || index >= pmap->getRoads( ).size( ) )
+		return false;
+
+	REPLAY_RECORD invert { REPLAY_INVERT, tick };
+	invert.road = index;
+	record( invert );
+
+	pmap->getRoads( ).at( index )->invert( );
+	return true;
+}
+
+bool GameEngine::queueInput( PLAYER_INPUT_TYPE type, int pid, FACING direction, uint32_t seq )
+{
+	const PLAYER_INPUT input { type, pid, direction, seq, steadyNow( ) };
+	if ( inputs.push( input ) )
+		return true;
+
+	if ( type == PLAYER_INPUT_MOVE )
+	{
+		inputs_dropped.fetch_add( 1, std::memory_order_relaxed );
+		return false;
+	}
+
+	std::lock_guard lock( overflow_mutex );
+	overflow.push_back( input );
+	overflowed.store( true, std::memory_order_release );
+
+	return true;
+}
+
+// the overflow is taken before the queue, so whatever got into the queue ahead of it is popped in the same batch
+// either of the two can hold the older input of a player (a join that got in before its leave didn't), so a batch
+// that took some overflow is put back in the order the inputs were queued in. a player's inputs all come from the
+// thread of its transport, their timestamps follow that order
+//
+void GameEngine::applyInputs( )
+{
+	MetricTimer timer( METRIC_INPUTS );
+
+	batch.clear( );
+
+	if ( overflowed.load( std::memory_order_acquire ) )
+	{
+		std::lock_guard lock( overflow_mutex );
+		batch.insert( batch.end( ), overflow.begin( ), overflow.end( ) );
+		overflow.clear( );
+		overflowed.store( false, std::memory_order_relaxed );
+	}
+
+	const bool merge = !batch.empty( );
+
+	PLAYER_INPUT input;
+	while ( inputs.pop( input ) )
+		batch.push_back( input );
+
+	if ( merge )
+		std::stable_sort( batch.begin( ), batch.end( ), [ ] ( const PLAYER_INPUT& a, const PLAYER_INPUT& b )
+			{
+				return a.received_at < b.received_at;
+			} );
+
+	Metrics::set( METRIC_INPUT_BATCH, static_cast<int64_t>( batch.size( ) ) );
+
+	if ( batch.empty( ) )
+		return;
+
+	input_stats.coalesced += coalesceInputs( batch );
+
+	const auto now = steadyNow( );
+	for ( const auto& input : batch )
+	{
+		switch ( input.type )
+		{
+		case PLAYER_INPUT_JOIN:
+			addPlayer( input.pid );
+			break;
+		case PLAYER_INPUT_MOVE:
+			movePlayer( input.pid, input.direction, input.seq );
+			break;
+		case PLAYER_INPUT_LEAVE:
+			removePlayer( input.pid );
+			break;
+		}
+
+		input_stats.wait_ns += now - input.received_at;
+	}
+
+	input_stats.applied += batch.size( );
+}
+
+bool GameEngine::startRecording( const std::string& path, int check_interval )
+{
+	if ( precorder )
+		return false;
+
+	auto recorder = new ReplayRecorder( );
+	if ( !recorder->open( path, settings, random.getSeed( ), check_interval ) )
+	{
+		delete recorder;
+		return false;
+	}
+
+	precorder = recorder;
+
+	return true;
+}
+
+void GameEngine::stopRecording( )
+{
+	if ( !precorder )
+		return;
+
+	precorder->close( tick );
+
+	delete precorder;
+	precorder = nullptr;
+}
+
+void GameEngine::record( REPLAY_RECORD record )
+{
+	if ( precorder )
+		precorder->record( record );
+}
+
+// FNV-1a over what a snapshot carries, in snapshot order
+//
+uint32_t GameEngine::getStateHash( )
+{
+	uint32_t hash = 2166136261u;
+
+	auto mix = [ &hash ] ( int value )
+		{
+			for ( int i = 0; i < 4; i++ )
+			{
+				hash ^= static_cast<uint8_t>( value >> ( i * 8 ) );
+				hash *= 16777619u;
+			}
+		};
+
+	pmap->forEachEntity( [ &mix ] ( const Entity& entity )
+		{
+			const auto pos = entity.getPosition( );
+
+			mix( entity.getType( ) );
+			mix( entity.getFacingDirection( ) );
+			mix( pos.first );
+			mix( pos.second );
+		} );
+
+	return hash;
+}
+
+INPUT_STATS GameEngine::getInputStats( )
+{
+	auto stats = input_stats;
+	stats.dropped = inputs_dropped.load( std::memory_order_relaxed );
+
+	return stats;
+}
+
+bool GameEngine::addPlayer( int pid )
+{
+	REPLAY_RECORD join { REPLAY_ADD_PLAYER, tick };
+	join.pid = pid;
+	record( join );
+
+	// a frog starts on a free cell of the first line, MatchManager never seats more players than there are
+	//
+	const auto columns = pmap->getSize( ).first;
+
+	bool free = false;
+	for ( int x = 0; x < columns && !free; x++ )
+		free = !pmap->isOccupied( { x, 0 } );
+
+	if ( !free )
+		return false;
+
+	std::pair<int, int> coords;
+	do
+	{
+		coords = { random.generateInt( 0, pmap->getSize( ).first - 1 ), 0 };
+	} while ( pmap->isOccupied( coords ) );
+
+	pmap->addFrog( pid, coords.first, coords.second );
+	return true;
+}
+
+void GameEngine::removePlayer( int pid )
+{
+	REPLAY_RECORD leave { REPLAY_REMOVE_PLAYER, tick };
+	leave.pid = pid;
+	record( leave );
+
+	pmap->removeFrog( pid );
+}
+
+void GameEngine::movePlayer( int pid, FACING direction, uint32_t seq )
+{
+	REPLAY_RECORD move { REPLAY_MOVE_PLAYER, tick };
+	move.pid = pid;
+	move.direction = direction;
+	move.seq = seq;
+	record( move );
+
+	auto& frogs = pmap->getFrogs( );
+
+	const auto index = frogs.find( pid );
+	if ( index == -1 )
+		return;
+
+	// taken even if the frog can't move yet, the client learns from the ack that its prediction was wrong
+	//
+	frogs.setInputSeq( index, seq );
+
+	Player player( &frogs, index );
+	if ( !player.canMove( ) )
+		return;
+
+	player.move( direction );
+
+	const auto [columns, lines] = pmap->getSize( );
+	const auto entity_pos = player.getPosition( );
+	const auto clamped = Player::clamp( entity_pos, columns, lines );
+
+	if ( clamped != entity_pos )
+		player.setPosition( clamped.first, clamped.second );
+}
+
+std::span<const PLAYER_ACK> GameEngine::getPlayerAcks( )
+{
+	player_acks.clear( );
+
+	// frogs are the first entities of the list, in the order of the store
+	//
+	auto& frogs = pmap->getFrogs( );
+	for ( int i = 0; i < frogs.size( ); i++ )
+		player_acks.push_back( { frogs.getPid( i ), i, frogs.getInputSeq( i ) } );
+
+	return player_acks;
+}
+
+const GameSettings& GameEngine::getSettings( )
+{
+	return settings;
+}
+
+Random& GameEngine::getRandom( )
+{
+	return random;
+}
\ No newline at end of file
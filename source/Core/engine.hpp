@@ -0,0 +1,159 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <span>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+
+#include "map.hpp"
+#include "pool.hpp"
+#include "input.hpp"
+#include "queue.hpp"
+#include "random.hpp"
+#include "replay.hpp"
+#include "player.hpp"
+#include "protocol.hpp"
+#include "settings.hpp"
+
+typedef struct
+{
+	uint64_t applied;		// inputs that reached the game
+	uint64_t coalesced;		// moves folded into another one of the same tick
+	uint64_t dropped;		// moves turned down because the queue was full
+	uint64_t wait_ns;		// summed time the applied inputs spent queued
+} INPUT_STATS;
+
+// platform neutral game rules, driven one fixed step at a time by processTick( )
+// throws std::runtime_error if the settings describe an invalid map
+//
+class GameEngine
+{
+private:
+	inline static constexpr size_t input_depth = 1024;
+
+	GameSettings settings;
+	Random random;
+
+	// the roads of the map (and the entity arrays in them) outlive its levels and restarts, a new level refills them
+	//
+	Pool<Road> road_pool;
+	Map* pmap = nullptr;
+	WorkerPool* ppool = nullptr;
+
+	uint64_t tick = 0;
+
+	// inputs of the transport threads, applied by the tick thread at the start of the next step
+	// a join or leave that finds the queue full goes to the overflow instead, losing one would leave a frog behind
+	//
+	MpscQueue<PLAYER_INPUT, input_depth> inputs;
+	std::mutex overflow_mutex;
+	std::vector<PLAYER_INPUT> overflow;
+	std::atomic<bool> overflowed = false;
+
+	std::vector<PLAYER_INPUT> batch;
+
+	// rebuilt by getEntityList( ) and getPlayerAcks( ), they keep their capacity from one tick to the next
+	//
+	std::vector<Entity> entity_list;
+	std::vector<PLAYER_ACK> player_acks;
+
+	INPUT_STATS input_stats { };
+	std::atomic<uint64_t> inputs_dropped = 0;
+
+	ReplayRecorder* precorder = nullptr;
+
+	void applyInputs( );
+
+	void record( REPLAY_RECORD record );
+
+public:
+	GameEngine( const GameSettings& settings = GameSettings( ), const Random& random = Random( ) );
+
+	~GameEngine( );
+
+	// back to a new map, players have to join again
+	//
+	void restart( );
+
+	// large boards step their roads on the pool (GameSettings::parallel_roads), nullptr keeps the tick serial
+	//
+	void setWorkerPool( WorkerPool* ppool );
+
+	bool processTick( );
+
+	// simulated time, advances tick_ms per processed tick
+	//
+	uint64_t getTick( );
+
+	uint64_t getTime( );
+
+	std::pair<int, int> getMapSize( );
+
+	// every entity, frogs first. the span points into the engine and is valid until the next call or the next tick
+	//
+	std::span<const Entity> getEntityList( );
+
+	// same entities without building the list, see Map::forEachEntity
+	//
+	template <typename Fn>
+	void forEachEntity( Fn&& fn )
+	{
+		pmap->forEachEntity( fn );
+	}
+
+	// false for a cell off the roads or taken, and for an index that isn't a road (nothing is recorded then)
+	//
+	bool placeRock( int x, int y );
+
+	void setFrozen( bool frozen );
+
+	bool setFrozen( bool frozen, int index );
+
+	void invert( );
+
+	bool invert( int index );
+
+	// logs the seed, the settings and everything done to the engine from now on, for runReplay( )
+	// call it before the first tick, the log starts from the map the seed builds. false if the file can't be created
+	//
+	bool startRecording( const std::string& path, int check_interval = 64 );
+
+	void stopRecording( );
+
+	// of the entities, what a replay is checked against
+	//
+	uint32_t getStateHash( );
+
+	// thread safe, the input is applied at the start of the next processTick( )
+	// returns false if a move was dropped because the queue is full
+	//
+	bool queueInput( PLAYER_INPUT_TYPE type, int pid, FACING direction = UP, uint32_t seq = 0 );
+
+	// counters of the inputs applied so far, read them from the tick thread
+	//
+	INPUT_STATS getInputStats( );
+
+	// the calls below change the game right away and belong on the tick thread, other threads go through queueInput( )
+	//
+	// false once every cell of the first line is taken, the player gets no frog
+	//
+	bool addPlayer( int pid );
+
+	void removePlayer( int pid );
+
+	// seq is the client's number for the input, handed back through getPlayerAcks( )
+	//
+	void movePlayer( int pid, FACING direction, uint32_t seq = 0 );
+
+	// last input taken from every player, slot is the one of its frog in getEntityList( )
+	// valid until the next call or the next tick, like getEntityList( )
+	//
+	std::span<const PLAYER_ACK> getPlayerAcks( );
+
+	const GameSettings& getSettings( );
+
+	Random& getRandom( );
+};
\ No newline at end of file
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "mentity.hpp"
+
+class Car : public MovingEntity
+{
+public:
+	Car( EntityStore* store, size_t index ) : 
+		MovingEntity( store, index )
+	{
+
+	}
+};
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include "types.hpp"
+#include "store.hpp"
+
+// lightweight view over an entity living in an EntityStore
+// views are only valid until the store they point into is changed in size
+//
+class Entity
+{
+protected:
+	EntityStore* store = nullptr;
+	size_t index = 0;
+
+public:
+	Entity(EntityStore* store, size_t index)
+	{
+		this->store = store;
+		this->index = index;
+	}
+
+	std::pair<int, int> getPosition() const
+	{
+		return store->getPosition(index);
+	}
+
+	void setPosition(int x, int y)
+	{
+		store->setPosition(index, x, y);
+	}
+
+	FACING getFacingDirection() const
+	{
+		return store->getFacingDirection(index);
+	}
+
+	ENTITY_TYPE getType() const
+	{
+		return store->getType(index);
+	}
+
+	size_t getIndex() const
+	{
+		return index;
+	}
+};
\ No newline at end of file
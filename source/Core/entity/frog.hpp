@@ -0,0 +1,41 @@
+#pragma once
+
+#include "mentity.hpp"
+
+class Frog : public MovingEntity
+{
+protected:
+	FrogStore* frogs = nullptr;
+
+public:
+	Frog( FrogStore* store, size_t index ) : MovingEntity( store, index )
+	{
+		frogs = store;
+	}
+
+	bool move(FACING facing_direction)
+	{
+		setFacingDirection(facing_direction);
+		if(MovingEntity::move())
+		{
+			frogs->setAfkTimer(index, 0);
+			return true;
+		}
+
+		return false;
+	}
+
+	int getAfkTimer() {
+		return frogs->getAfkTimer(index);
+	}
+
+	void setAfkTimer(int afk_timer) {
+		frogs->setAfkTimer(index, afk_timer);
+	}
+
+	void resetAfkTimer() {
+		frogs->setAfkTimer(index, 0);
+	}
+
+
+};
\ No newline at end of file
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "entity.hpp"
+
+class MovingEntity : public Entity
+{
+public:
+	MovingEntity( EntityStore* store, size_t index ) : Entity( store, index )
+	{
+
+	}
+
+	void setFacingDirection( FACING facing_direction )
+	{
+		store->setFacingDirection( index, facing_direction );
+	}
+
+	void invertFacingDirection()
+	{
+		store->invertFacingDirection( index );
+	}
+
+	double getSpeed( )
+	{
+		return store->getSpeed( index );
+	}
+
+	void setSpeed( double speed )
+	{
+		store->setSpeed( index, speed );
+	}
+
+	bool move() {
+		return store->move( index );
+	}
+
+	std::pair<int, int> getNextPosition()
+	{
+		return store->getNextPosition( index );
+	}
+
+	void setMoving(bool moving)
+	{
+		store->setMoving( index, moving );
+	}
+
+	bool isMoving()
+	{
+		return store->isMoving( index );
+	}
+
+	bool canMove()
+	{
+		return store->canMove( index );
+	}
+};
\ No newline at end of file
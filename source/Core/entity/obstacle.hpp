@@ -0,0 +1,12 @@
+#pragma once
+
+#include "entity.hpp"
+
+class Obstacle : public Entity
+{
+public:
+	Obstacle( EntityStore* store, size_t index ) : Entity( store, index )
+	{
+
+	}
+};
\ No newline at end of file
@@ -0,0 +1,343 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "types.hpp"
+#include "../grid.hpp"
+
+// structure of arrays holding every entity of a road (or every frog of the map)
+// the tick is a linear sweep over these arrays, Car/Obstacle/Frog/Player are views over an index
+//
+class EntityStore
+{
+protected:
+	inline static constexpr int step_x[ ] = { 0, 0, -1, 1 };	// UP, DOWN, LEFT, RIGHT
+	inline static constexpr int step_y[ ] = { 1, -1, 0, 0 };
+
+	Grid* grid = nullptr;
+
+	std::vector<int> pos_x, pos_y;
+	std::vector<FACING> facing;
+	std::vector<double> speed, move_interval;
+	std::vector<int> time_accumulator;
+	std::vector<ENTITY_TYPE> type;
+	std::vector<unsigned char> moving;
+
+public:
+	EntityStore( Grid* grid = nullptr ) : grid( grid )
+	{
+
+	}
+
+	size_t size( )
+	{
+		return type.size( );
+	}
+
+	size_t add( ENTITY_TYPE type, int x, int y, FACING facing_direction, double speed, bool moving )
+	{
+		pos_x.push_back( x );
+		pos_y.push_back( y );
+		facing.push_back( facing_direction );
+		this->speed.push_back( speed );
+		move_interval.push_back( 500 / speed );
+		time_accumulator.push_back( 0 );
+		this->type.push_back( type );
+		this->moving.push_back( moving );
+
+		if ( grid )
+			grid->insert( type, { x, y } );
+
+		return this->type.size( ) - 1;
+	}
+
+	// swap with the last entity, views of the last index now point to index
+	//
+	void remove( size_t index )
+	{
+		if ( grid )
+			grid->erase( type[ index ], getPosition( index ) );
+
+		swapRemove( pos_x, index );
+		swapRemove( pos_y, index );
+		swapRemove( facing, index );
+		swapRemove( speed, index );
+		swapRemove( move_interval, index );
+		swapRemove( time_accumulator, index );
+		swapRemove( type, index );
+		swapRemove( moving, index );
+	}
+
+	void clear( )
+	{
+		if ( grid )
+			for ( size_t i = 0; i < size( ); i++ )
+				grid->erase( type[ i ], getPosition( i ) );
+
+		pos_x.clear( );
+		pos_y.clear( );
+		facing.clear( );
+		speed.clear( );
+		move_interval.clear( );
+		time_accumulator.clear( );
+		type.clear( );
+		moving.clear( );
+	}
+
+	// drops every entity without touching the grid they were on (it was cleared, or is gone) and moves to grid
+	// the arrays keep their capacity, refilling the store doesn't allocate
+	//
+	void reset( Grid* grid )
+	{
+		this->grid = nullptr;
+		clear( );
+
+		this->grid = grid;
+	}
+
+	bool processTick( int tick_ms )
+	{
+		bool moved = false;
+
+		const auto count = size( );
+		for ( size_t i = 0; i < count; i++ )
+		{
+			time_accumulator[ i ] += tick_ms;
+
+			if ( !moving[ i ] || time_accumulator[ i ] < move_interval[ i ] )
+				continue;
+
+			move( i );
+			moved = true;
+		}
+
+		return moved;
+	}
+
+	void invert( )
+	{
+		const auto count = size( );
+		for ( size_t i = 0; i < count; i++ )
+			if ( type[ i ] != ENTITY_TYPE_OBSTACLE )
+				invertFacingDirection( i );
+	}
+
+	void setMoving( bool moving )
+	{
+		const auto count = size( );
+		for ( size_t i = 0; i < count; i++ )
+			if ( type[ i ] != ENTITY_TYPE_OBSTACLE )
+				this->moving[ i ] = moving;
+	}
+
+	void setSpeed( ENTITY_TYPE type, double speed )
+	{
+		const auto count = size( );
+		for ( size_t i = 0; i < count; i++ )
+			if ( this->type[ i ] == type )
+				setSpeed( i, speed );
+	}
+
+	std::pair<int, int> getPosition( size_t index )
+	{
+		return std::make_pair( pos_x[ index ], pos_y[ index ] );
+	}
+
+	void setPosition( size_t index, int x, int y )
+	{
+		if ( grid )
+			grid->relocate( type[ index ], getPosition( index ), { x, y } );
+
+		pos_x[ index ] = x;
+		pos_y[ index ] = y;
+	}
+
+	std::pair<int, int> getNextPosition( size_t index )
+	{
+		return step( getPosition( index ), facing[ index ] );
+	}
+
+	// one cell towards direction, without any bounds
+	//
+	static std::pair<int, int> step( std::pair<int, int> position, FACING direction )
+	{
+		return std::make_pair( position.first + step_x[ direction ], position.second + step_y[ direction ] );
+	}
+
+	bool move( size_t index )
+	{
+		if ( facing[ index ] < FACING::UP || facing[ index ] > FACING::RIGHT )
+			return false;
+
+		const auto next_position = getNextPosition( index );
+		setPosition( index, next_position.first, next_position.second );
+
+		time_accumulator[ index ] = 0;
+		return true;
+	}
+
+	bool canMove( size_t index )
+	{
+		return time_accumulator[ index ] >= move_interval[ index ];
+	}
+
+	ENTITY_TYPE getType( size_t index )
+	{
+		return type[ index ];
+	}
+
+	FACING getFacingDirection( size_t index )
+	{
+		return facing[ index ];
+	}
+
+	void setFacingDirection( size_t index, FACING facing_direction )
+	{
+		if ( facing_direction >= FACING::UP && facing_direction <= FACING::RIGHT )
+			facing[ index ] = facing_direction;
+	}
+
+	// UP <-> DOWN, LEFT <-> RIGHT
+	//
+	void invertFacingDirection( size_t index )
+	{
+		facing[ index ] = static_cast<FACING>( facing[ index ] ^ 1 );
+	}
+
+	double getSpeed( size_t index )
+	{
+		return speed[ index ];
+	}
+
+	void setSpeed( size_t index, double speed )
+	{
+		this->speed[ index ] = speed;
+		move_interval[ index ] = 500 / speed;
+	}
+
+	bool isMoving( size_t index )
+	{
+		return moving[ index ];
+	}
+
+	void setMoving( size_t index, bool moving )
+	{
+		this->moving[ index ] = moving;
+	}
+
+protected:
+	template<typename T>
+	static void swapRemove( std::vector<T>& vector, size_t index )
+	{
+		vector[ index ] = vector.back( );
+		vector.pop_back( );
+	}
+};
+
+// frogs carry a few extra columns (afk timer, the owning player and the last input it sent)
+//
+class FrogStore : public EntityStore
+{
+public:
+	inline static constexpr auto frog_speed = 2.0;
+
+private:
+	std::vector<int> afk_timer, pid, points;
+	std::vector<uint32_t> input_seq;
+
+public:
+	FrogStore( Grid* grid = nullptr ) : EntityStore( grid )
+	{
+
+	}
+
+	size_t add( int pid, int x, int y )
+	{
+		afk_timer.push_back( 0 );
+		this->pid.push_back( pid );
+		points.push_back( 0 );
+		input_seq.push_back( 0 );
+
+		return EntityStore::add( ENTITY_TYPE_FROG, x, y, FACING::UP, frog_speed, false );
+	}
+
+	void remove( size_t index )
+	{
+		EntityStore::remove( index );
+
+		swapRemove( afk_timer, index );
+		swapRemove( pid, index );
+		swapRemove( points, index );
+		swapRemove( input_seq, index );
+	}
+
+	void clear( )
+	{
+		EntityStore::clear( );
+
+		afk_timer.clear( );
+		pid.clear( );
+		points.clear( );
+		input_seq.clear( );
+	}
+
+	bool processTick( int tick_ms )
+	{
+		EntityStore::processTick( tick_ms );
+
+		const auto count = size( );
+		for ( size_t i = 0; i < count; i++ )
+			afk_timer[ i ] = pos_y[ i ] == 0 ? 0 : afk_timer[ i ] + tick_ms;
+
+		return false;
+	}
+
+	// index of the frog owned by pid, -1 if there's none
+	//
+	int find( int pid )
+	{
+		for ( size_t i = 0; i < this->pid.size( ); i++ )
+			if ( this->pid[ i ] == pid )
+				return static_cast<int>( i );
+
+		return -1;
+	}
+
+	int getAfkTimer( size_t index )
+	{
+		return afk_timer[ index ];
+	}
+
+	void setAfkTimer( size_t index, int afk_timer )
+	{
+		this->afk_timer[ index ] = afk_timer;
+	}
+
+	int getPid( size_t index )
+	{
+		return pid[ index ];
+	}
+
+	int getPoints( size_t index )
+	{
+		return points[ index ];
+	}
+
+	void setPoints( size_t index, int points )
+	{
+		this->points[ index ] = points;
+	}
+
+	uint32_t getInputSeq( size_t index )
+	{
+		return input_seq[ index ];
+	}
+
+	void setInputSeq( size_t index, uint32_t seq )
+	{
+		input_seq[ index ] = seq;
+	}
+};
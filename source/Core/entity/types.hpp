@@ -0,0 +1,17 @@
+#pragma once
+
+enum ENTITY_TYPE
+{
+	ENTITY_TYPE_OBSTACLE,
+	ENTITY_TYPE_CAR,
+	ENTITY_TYPE_FROG,
+	ENTITY_TYPE_MAX
+};
+
+enum FACING
+{
+	UP,
+	DOWN,
+	LEFT,
+	RIGHT
+};
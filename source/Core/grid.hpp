@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <vector>
+#include <utility>
+
+#include "entity/types.hpp"
+
+// occupancy grid (columns x lines), one counter per entity type per cell
+// positions outside of the board are not tracked
+//
+class Grid
+{
+private:
+	int columns = 0, lines = 0;
+	std::vector<std::array<unsigned short, ENTITY_TYPE_MAX>> cells;
+
+	int indexOf( std::pair<int, int> pos )
+	{
+		return pos.second * columns + pos.first;
+	}
+
+public:
+	Grid( )
+	{
+
+	}
+
+	Grid( int columns, int lines ) : columns( columns ), lines( lines ), cells( columns * lines )
+	{
+
+	}
+
+	bool contains( std::pair<int, int> pos )
+	{
+		return pos.first >= 0 && pos.first < columns && pos.second >= 0 && pos.second < lines;
+	}
+
+	void insert( ENTITY_TYPE type, std::pair<int, int> pos )
+	{
+		if ( !contains( pos ) )
+			return;
+
+		cells[ indexOf( pos ) ][ type ]++;
+	}
+
+	void erase( ENTITY_TYPE type, std::pair<int, int> pos )
+	{
+		if ( !contains( pos ) )
+			return;
+
+		auto& count = cells[ indexOf( pos ) ][ type ];
+		if ( count )
+			count--;
+	}
+
+	void relocate( ENTITY_TYPE type, std::pair<int, int> from, std::pair<int, int> to )
+	{
+		erase( type, from );
+		insert( type, to );
+	}
+
+	int count( std::pair<int, int> pos, ENTITY_TYPE type )
+	{
+		return contains( pos ) ? cells[ indexOf( pos ) ][ type ] : 0;
+	}
+
+	// any entity at pos
+	//
+	bool isOccupied( std::pair<int, int> pos )
+	{
+		if ( !contains( pos ) )
+			return false;
+
+		for ( const auto count : cells[ indexOf( pos ) ] )
+			if ( count )
+				return true;
+
+		return false;
+	}
+
+	// cars and obstacles block movement, frogs don't
+	//
+	bool isBlocked( std::pair<int, int> pos )
+	{
+		return count( pos, ENTITY_TYPE_CAR ) || count( pos, ENTITY_TYPE_OBSTACLE );
+	}
+
+	void clear( ENTITY_TYPE type )
+	{
+		for ( auto& cell : cells )
+			cell[ type ] = 0;
+	}
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+#include "entity/types.hpp"
+
+typedef enum
+{
+	PLAYER_INPUT_JOIN,
+	PLAYER_INPUT_MOVE,
+	PLAYER_INPUT_LEAVE
+} PLAYER_INPUT_TYPE;
+
+// something a player did, queued by the transport threads and applied by the tick
+//
+typedef struct
+{
+	PLAYER_INPUT_TYPE type;
+	int pid;
+	FACING direction;
+	uint32_t seq;			// client's number for a move, acked back through the frames
+	int64_t received_at;	// steady clock, nanoseconds
+} PLAYER_INPUT;
+
+// puts a tick's inputs in an order that doesn't depend on which transport thread queued first, and folds the
+// moves a frog can't take anyway
+// inputs are ordered by player, each player's in the order they arrived. a frog moves at most once per tick,
+// so a run of moves between a join and a leave becomes the first one carrying the seq of the last, which
+// acks all of them. returns the number of inputs folded away
+//
+inline size_t coalesceInputs( std::vector<PLAYER_INPUT>& inputs )
+{
+	// stable insertion sort, a batch is a few inputs per player and std::stable_sort takes a buffer off the heap every tick
+	//
+	for ( size_t i = 1; i < inputs.size( ); i++ )
+	{
+		const auto input = inputs[ i ];
+
+		auto j = i;
+		for ( ; j > 0 && inputs[ j - 1 ].pid > input.pid; j-- )
+			inputs[ j ] = inputs[ j - 1 ];
+
+		inputs[ j ] = input;
+	}
+
+	size_t count = 0;
+	for ( size_t i = 0; i < inputs.size( ); i++ )
+	{
+		auto& input = inputs[ i ];
+
+		if ( count && input.type == PLAYER_INPUT_MOVE )
+		{
+			auto& previous = inputs[ count - 1 ];
+			if ( previous.type == PLAYER_INPUT_MOVE && previous.pid == input.pid )
+			{
+				previous.seq = input.seq;
+				continue;
+			}
+		}
+
+		inputs[ count++ ] = input;
+	}
+
+	const auto folded = inputs.size( ) - count;
+	inputs.resize( count );
+
+	return folded;
+}
\ No newline at end of file
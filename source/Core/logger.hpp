@@ -0,0 +1,464 @@
+#pragma once
+
+#include <mutex>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <charconv>
+#include <functional>
+#include <string_view>
+#include <type_traits>
+#include <condition_variable>
+
+enum LOG_LEVEL : uint8_t
+{
+	LOG_DEBUG,
+	LOG_INFO,
+	LOG_WARNING,
+	LOG_ERROR
+};
+
+// one message as it waits in a ring, the drain thread turns the timestamp into text
+//
+typedef struct
+{
+	int64_t timestamp;		// steady clock, ns
+	LOG_LEVEL level;
+	uint32_t suppressed;	// repeats of this message the rate limit dropped since the last one that got through
+	uint16_t length;
+	char text[ 240 ];		// utf-8, cut short if it doesn't fit
+} LOG_ENTRY;
+
+typedef struct
+{
+	uint64_t written;		// messages the sink got
+	uint64_t dropped;		// messages that found their thread's ring full
+	uint64_t suppressed;	// repeats held back by the rate limit
+} LOG_STATS;
+
+// the arguments of a message appended into a fixed buffer, without the heap or a stream
+//
+class LogLine
+{
+private:
+	char* data;
+	size_t capacity;
+	size_t length = 0;
+
+	void put( char c )
+	{
+		if ( length < capacity )
+			data[ length++ ] = c;
+	}
+
+	void put( std::string_view text )
+	{
+		const auto size = text.size( ) < capacity - length ? text.size( ) : capacity - length;
+		std::memcpy( data + length, text.data( ), size );
+		length += size;
+	}
+
+	// wide text (TEXT( ) literals of a UNICODE build) goes out as utf-8
+	//
+	void put( std::wstring_view text )
+	{
+		for ( const auto c : text )
+		{
+			const auto code = static_cast<uint32_t>( c );
+			if ( code < 0x80 )
+				put( static_cast<char>( code ) );
+			else if ( code < 0x800 )
+			{
+				put( static_cast<char>( 0xc0 | code >> 6 ) );
+				put( static_cast<char>( 0x80 | ( code & 0x3f ) ) );
+			}
+			else if ( code >= 0x10000 )
+			{
+				put( static_cast<char>( 0xf0 | ( code >> 18 & 0x07 ) ) );
+				put( static_cast<char>( 0x80 | ( code >> 12 & 0x3f ) ) );
+				put( static_cast<char>( 0x80 | ( code >> 6 & 0x3f ) ) );
+				put( static_cast<char>( 0x80 | ( code & 0x3f ) ) );
+			}
+			else
+			{
+				put( static_cast<char>( 0xe0 | ( code >> 12 & 0x0f ) ) );
+				put( static_cast<char>( 0x80 | ( code >> 6 & 0x3f ) ) );
+				put( static_cast<char>( 0x80 | ( code & 0x3f ) ) );
+			}
+		}
+	}
+
+	template <typename T>
+	void putNumber( T value, int base = 10 )
+	{
+		char digits[ 32 ];
+
+		std::to_chars_result result;
+		if constexpr ( std::is_floating_point_v<T> )
+			result = std::to_chars( digits, digits + sizeof( digits ), value );
+		else
+			result = std::to_chars( digits, digits + sizeof( digits ), value, base );
+
+		if ( result.ec == std::errc( ) )
+			put( std::string_view( digits, result.ptr - digits ) );
+	}
+
+public:
+	LogLine( char* data, size_t capacity ) : data( data ), capacity( capacity )
+	{
+
+	}
+
+	size_t size( ) const
+	{
+		return length;
+	}
+
+	template <typename T>
+	void append( const T& value )
+	{
+		if constexpr ( std::is_same_v<T, bool> )
+			put( value ? std::string_view( "true" ) : std::string_view( "false" ) );
+		else if constexpr ( std::is_same_v<T, char> )
+			put( value );
+		else if constexpr ( std::is_same_v<T, wchar_t> )
+			put( std::wstring_view( &value, 1 ) );
+		else if constexpr ( std::is_convertible_v<const T&, std::string_view> )
+			put( std::string_view( value ) );
+		else if constexpr ( std::is_convertible_v<const T&, std::wstring_view> )
+			put( std::wstring_view( value ) );
+		else if constexpr ( std::is_enum_v<T> )
+			putNumber( static_cast<std::underlying_type_t<T>>( value ) );
+		else if constexpr ( std::is_integral_v<T> )
+			putNumber( value );
+		else if constexpr ( std::is_floating_point_v<T> )
+			putNumber( static_cast<double>( value ) );
+		else if constexpr ( std::is_pointer_v<T> )
+			putNumber( reinterpret_cast<uintptr_t>( value ), 16 );
+		else
+			static_assert( std::is_void_v<T>, "no log format for this type" );
+	}
+};
+
+// asynchronous logging shared by the executables, a message costs its formatting into a ring of the calling thread
+// and nothing else: no lock, no allocation once the thread's ring exists, no console i/o. one drain thread empties
+// the rings into the sink (stdout / stderr by default) every few milliseconds, and a last time at exit
+// a ring that is full drops the message and counts it, the same message repeated more than burst times in a second
+// is held back and reported with the next one that gets through. messages are only ordered within their thread
+//
+class Logger
+{
+public:
+	using Sink = std::function<void( LOG_LEVEL level, const char* line )>;
+
+	inline static constexpr size_t ring_size = 256;
+	inline static constexpr uint32_t burst = 8;
+
+private:
+	inline static constexpr auto drain_period = std::chrono::milliseconds( 10 );
+	inline static constexpr int64_t rate_window_ns = 1000000000;
+	inline static constexpr size_t rate_slots = 32;
+
+	// single producer (its thread), single consumer (the drain thread)
+	//
+	struct RING
+	{
+		alignas( 64 ) std::atomic<uint64_t> head { 0 };		// next to write, producer
+		alignas( 64 ) std::atomic<uint64_t> tail { 0 };		// next to read, consumer
+		std::atomic<uint64_t> dropped { 0 };				// producer
+		uint64_t reported = 0;								// drops the drain thread already told the sink about
+
+		// producer only, the rate limit of the messages of this thread
+		//
+		struct
+		{
+			uint64_t key;
+			int64_t window;
+			uint32_t count, suppressed;
+		} rates[ rate_slots ] { };
+
+		std::array<LOG_ENTRY, ring_size> entries;
+	};
+
+	std::mutex mutex;
+	std::vector<std::unique_ptr<RING>> rings;
+	std::vector<RING*> draining;		// the rings as of the last drain, only touched by drain( )
+	std::thread drainer;
+	std::condition_variable wake;
+	bool stopping = false;
+	std::atomic<bool> closed = false;		// drained for the last time, messages are printed right away
+
+	Sink sink;
+	std::atomic<uint8_t> level { LOG_DEBUG };
+	std::atomic<uint64_t> written { 0 }, suppressed { 0 };
+
+	const int64_t epoch = now( );
+
+	Logger( )
+	{
+
+	}
+
+	void shutdown( )
+	{
+		{
+			std::lock_guard lock( mutex );
+			stopping = true;
+		}
+
+		wake.notify_one( );
+
+		if ( drainer.joinable( ) )
+			drainer.join( );
+
+		drain( );
+		closed.store( true, std::memory_order_release );
+	}
+
+	static int64_t now( )
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ).time_since_epoch( ) ).count( );
+	}
+
+	static uint64_t hash( const char* text, size_t length )
+	{
+		uint64_t value = 0xcbf29ce484222325ull;
+		for ( size_t i = 0; i < length; i++ )
+			value = ( value ^ static_cast<uint8_t>( text[ i ] ) ) * 0x100000001b3ull;
+
+		return value;
+	}
+
+	RING& local( )
+	{
+		thread_local RING* pring = nullptr;
+		if ( pring )
+			return *pring;
+
+		std::lock_guard lock( mutex );
+
+		rings.push_back( std::make_unique<RING>( ) );
+		pring = rings.back( ).get( );
+
+		if ( !drainer.joinable( ) && !stopping )
+			drainer = std::thread( [ this ] ( ) { drainRoutine( ); } );
+
+		return *pring;
+	}
+
+	// the key of a message is its first argument (the text of the call site), so a storm of the same error with
+	// different codes is still one message
+	//
+	bool admit( RING& ring, uint64_t key, int64_t timestamp, uint32_t& held_back )
+	{
+		auto& rate = ring.rates[ key % rate_slots ];
+
+		if ( rate.key != key || timestamp - rate.window >= rate_window_ns )
+		{
+			held_back = rate.key == key ? rate.suppressed : 0;
+			rate = { key, timestamp, 1, 0 };
+			return true;
+		}
+
+		if ( rate.count < burst )
+		{
+			held_back = rate.suppressed;
+			rate.count++;
+			rate.suppressed = 0;
+			return true;
+		}
+
+		rate.suppressed++;
+		suppressed.fetch_add( 1, std::memory_order_relaxed );
+		return false;
+	}
+
+	void output( LOG_LEVEL level, const char* line )
+	{
+		if ( sink )
+			sink( level, line );
+		else
+		{
+			std::fputs( line, level >= LOG_WARNING ? stderr : stdout );
+			std::fputc( '\n', level >= LOG_WARNING ? stderr : stdout );
+		}
+
+		written.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	void print( const LOG_ENTRY& entry )
+	{
+		static constexpr const char* level_names[ ] = { "debug", "info", "warning", "error" };
+
+		const auto elapsed = entry.timestamp - epoch;
+
+		char line[ sizeof( entry.text ) + 96 ];
+		auto length = std::snprintf( line, sizeof( line ), "[ %lld.%06lld ] %s: %.*s", static_cast<long long>( elapsed / 1000000000 ),
+			static_cast<long long>( elapsed % 1000000000 / 1000 ), level_names[ entry.level & 3 ], static_cast<int>( entry.length ), entry.text );
+
+		if ( entry.suppressed && length > 0 && static_cast<size_t>( length ) < sizeof( line ) )
+			std::snprintf( line + length, sizeof( line ) - length, " (%u more like it held back)", entry.suppressed );
+
+		output( entry.level, line );
+	}
+
+	// the lock is only held to see which rings there are, the sink does console i/o and a thread logging for the
+	// first time must not wait on it. the entries need no lock, this is their only consumer (the drain thread, or
+	// the exit once that one is gone)
+	//
+	void drain( )
+	{
+		{
+			std::lock_guard lock( mutex );
+
+			draining.clear( );
+			for ( const auto& ring : rings )
+				draining.push_back( ring.get( ) );
+		}
+
+		for ( const auto ring : draining )
+		{
+			const auto head = ring->head.load( std::memory_order_acquire );
+			auto tail = ring->tail.load( std::memory_order_relaxed );
+
+			for ( ; tail != head; tail++ )
+				print( ring->entries[ tail % ring_size ] );
+
+			ring->tail.store( tail, std::memory_order_release );
+
+			const auto dropped = ring->dropped.load( std::memory_order_relaxed );
+			if ( dropped != ring->reported )
+			{
+				char line[ 96 ];
+				std::snprintf( line, sizeof( line ), "%llu messages dropped, the log couldn't keep up", static_cast<unsigned long long>( dropped - ring->reported ) );
+				output( LOG_WARNING, line );
+
+				ring->reported = dropped;
+			}
+		}
+	}
+
+	void drainRoutine( )
+	{
+		std::unique_lock lock( mutex );
+
+		while ( !stopping )
+		{
+			wake.wait_for( lock, drain_period );
+
+			lock.unlock( );
+			drain( );
+			lock.lock( );
+		}
+	}
+
+public:
+	Logger( const Logger& ) = delete;
+	Logger& operator=( const Logger& ) = delete;
+
+	// never destroyed, a thread still running at exit may log after the last drain
+	//
+	static Logger& instance( )
+	{
+		static Logger* plogger = [ ] ( )
+			{
+				const auto plogger = new Logger( );
+				std::atexit( [ ] ( ) { instance( ).shutdown( ); } );
+
+				return plogger;
+			}( );
+
+		return *plogger;
+	}
+
+	// set before the first message, the drain thread calls it one line at a time
+	//
+	static void setSink( Sink sink )
+	{
+		auto& logger = instance( );
+
+		std::lock_guard lock( logger.mutex );
+		logger.sink = std::move( sink );
+	}
+
+	// messages below it are dropped at the call site
+	//
+	static void setLevel( LOG_LEVEL level )
+	{
+		instance( ).level.store( level, std::memory_order_relaxed );
+	}
+
+	template <typename... T>
+	static void write( LOG_LEVEL level, const T&... args )
+	{
+		auto& logger = instance( );
+		if ( level < logger.level.load( std::memory_order_relaxed ) )
+			return;
+
+		const auto timestamp = now( );
+
+		if ( logger.closed.load( std::memory_order_acquire ) )
+		{
+			LOG_ENTRY entry;
+
+			LogLine line( entry.text, sizeof( entry.text ) );
+			( line.append( args ), ... );
+
+			entry.timestamp = timestamp;
+			entry.level = level;
+			entry.suppressed = 0;
+			entry.length = static_cast<uint16_t>( line.size( ) );
+
+			std::lock_guard lock( logger.mutex );
+			logger.print( entry );
+			return;
+		}
+
+		auto& ring = logger.local( );
+		const auto head = ring.head.load( std::memory_order_relaxed );
+
+		if ( head - ring.tail.load( std::memory_order_acquire ) >= ring_size )
+		{
+			ring.dropped.store( ring.dropped.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+			return;
+		}
+
+		auto& entry = ring.entries[ head % ring_size ];
+
+		LogLine line( entry.text, sizeof( entry.text ) );
+
+		size_t key_length = 0;
+		( ( line.append( args ), key_length = key_length ? key_length : line.size( ) ), ... );
+
+		uint32_t held_back = 0;
+		if ( !logger.admit( ring, hash( entry.text, key_length ), timestamp, held_back ) )
+			return;
+
+		entry.timestamp = timestamp;
+		entry.level = level;
+		entry.suppressed = held_back;
+		entry.length = static_cast<uint16_t>( line.size( ) );
+
+		ring.head.store( head + 1, std::memory_order_release );
+	}
+
+	static LOG_STATS getStats( )
+	{
+		auto& logger = instance( );
+
+		LOG_STATS stats { logger.written.load( std::memory_order_relaxed ), 0, logger.suppressed.load( std::memory_order_relaxed ) };
+
+		std::lock_guard lock( logger.mutex );
+		for ( const auto& ring : logger.rings )
+			stats.dropped += ring->dropped.load( std::memory_order_relaxed );
+
+		return stats;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,266 @@
+#include "map.hpp"
+
+#include <stdexcept>
+
+#include "metrics.hpp"
+#include "protocol.hpp"
+
+Map::Map( const GameSettings& settings, Random& random, Pool<Road>& road_pool ) : settings( settings ), random( random ), road_pool( road_pool )
+{
+	if ( settings.num_roads < 1 )
+		throw std::runtime_error( "The number of roads must be greater than 0" );
+
+	if ( settings.num_columns < 1 )
+		throw std::runtime_error( "The number of columns must be greater than 0" );
+
+	if ( settings.init_car_number < 0 || settings.init_car_number > settings.num_columns )
+		throw std::runtime_error( "A road can't have more cars than columns" );
+
+	// the frames have to be able to address every cell (see MAX_BOARD_CELLS), past that the board is only bounded by memory
+	//
+	if ( settings.num_columns > MAX_BOARD_SIDE || settings.num_roads + 2 > MAX_BOARD_SIDE ||
+		static_cast<long long>( settings.num_columns ) * ( settings.num_roads + 2 ) > MAX_BOARD_CELLS )
+		throw std::runtime_error( "The board has more cells than a frame can address" );
+
+	this->columns = settings.num_columns;
+	this->lines = settings.num_roads + 2;
+
+	grid = Grid( columns, lines );
+
+	road_pool.rewind( );
+	initialize();
+
+	setLevel(1);
+
+	road_step = [ this ] ( size_t road )
+		{
+			road_moved[ road ] = roads[ road ]->processTick( this->settings.tick_ms );
+			repositionEntities( road );
+		};
+}
+
+Map::~Map( )
+{
+	frogs.clear();
+	roads.clear();
+
+	road_pool.rewind( );
+}
+
+void Map::initialize()
+{
+	std::pair<int, int> coords;
+	for (int i = 0; i < settings.num_roads; i++) {
+		Road* road = &road_pool.acquire( );
+		road->reset(columns, &grid);
+
+		for (int j = 0; j < settings.init_car_number; j++){
+			do
+			{
+				coords = { random.generateInt(0, columns - 1), i + 1 };
+			} while ( isOccupied( coords ) );
+
+			road->addCar(coords.first, coords.second, i % 2 == 0 ? RIGHT : LEFT, settings.init_car_speed);
+		}
+		roads.push_back(road);
+	}
+}
+
+void Map::rebuildRoads()
+{
+	grid.clear(ENTITY_TYPE_CAR);
+	grid.clear(ENTITY_TYPE_OBSTACLE);
+
+	roads.clear();
+	road_pool.rewind( );
+
+	initialize();
+}
+
+void Map::reset()
+{
+	frogs.clear();
+
+	rebuildRoads();
+	setLevel(1);
+}
+
+int Map::checkWin()
+{
+	for (int i = 0; i < frogs.size(); i++) 
+		if (frogs.getPosition(i).second >= lines - 1)
+			return i;
+
+	return -1;
+}
+
+void Map::repositionEntities()
+{
+	for (int i = 0; i < roads.size(); i++)
+		repositionEntities( i );
+}
+
+void Map::repositionEntities( size_t road )
+{
+	EntityStore& entities = roads.at( road )->getEntities( );
+
+	const auto count = entities.size( );
+	for ( size_t j = 0; j < count; j++ )
+	{
+		if ( entities.getType( j ) == ENTITY_TYPE_OBSTACLE )
+			continue;
+
+		if ( grid.isBlocked( entities.getNextPosition( j ) ) )
+			entities.invertFacingDirection( j );
+
+		std::pair<int, int> entity_pos = entities.getPosition( j );
+		if ( entity_pos.first < 0 )
+			entities.setPosition( j, columns - 1, entity_pos.second );
+		if ( entity_pos.first > columns - 1 )
+			entities.setPosition( j, 0, entity_pos.second );
+		if ( entity_pos.second > lines - 1 )
+			entities.setPosition( j, entity_pos.first, lines - 1 );
+		if ( entity_pos.second < 0 )
+			entities.setPosition( j, entity_pos.first, 0 );
+	}
+}
+
+// cars drive along their own line and only ever look at its cells of the grid (obstacles are placed on the road
+// of their line), so every road can step and reposition on its own, in any order and on any thread
+// the frogs are the only thing crossing lines, their collisions are resolved afterwards on the calling thread
+//
+bool Map::processRoads( )
+{
+	road_moved.assign( roads.size( ), 0 );
+	ppool->run( roads.size( ), road_step );
+
+	bool moved = false;
+	for ( const auto road : road_moved )
+		moved |= road != 0;
+
+	return moved;
+}
+
+void Map::checkColision()
+{
+	MetricTimer timer( METRIC_COLLISION );
+
+	for (int i = 0; i < frogs.size(); i++)
+		if (grid.isBlocked(frogs.getPosition(i)))
+			frogs.setPosition(i, 0, 0);
+}
+
+void Map::setWorkerPool( WorkerPool* ppool )
+{
+	this->ppool = ppool;
+}
+
+bool Map::processTick()
+{
+	bool ret = false;
+	ret |= frogs.processTick(settings.tick_ms);
+
+	// the roads never move a frog, so a win is known before they step. a win rebuilds the roads, that tick stays serial
+	//
+	const bool parallel = ppool && settings.parallel_roads > 0 && roads.size() >= settings.parallel_roads;
+	if (parallel && checkWin() == -1) {
+		{
+			MetricTimer timer( METRIC_ROADS );
+			ret |= processRoads();
+		}
+
+		checkColision();
+
+		return ret;
+	}
+
+	{
+		MetricTimer timer( METRIC_ROADS );
+
+		for (int i = 0; i < roads.size(); i++)
+			ret |= roads.at(i)->processTick(settings.tick_ms);
+	}
+
+	int winner = checkWin();
+	if (winner != -1) {
+		rebuildRoads();
+		setLevel(getLevel() + 1);
+
+		for (int i = 0; i < frogs.size(); i++)
+			frogs.setPosition(i, random.generateInt( 0, columns - 1 ), 0);
+
+	}
+
+	{
+		MetricTimer timer( METRIC_REPOSITION );
+		repositionEntities();
+	}
+
+	checkColision();
+
+	return ret;
+}
+
+bool Map::isOccupied( std::pair<int, int> coords )
+{
+	return grid.isOccupied( coords );
+}
+
+FrogStore& Map::getFrogs( )
+{
+	return frogs;
+}
+
+// rocks only go on the roads, the first and last lines belong to the frogs
+//
+bool Map::placeRock(int x, int y) {
+	if (x < 0 || x > columns - 1 || y < 1 || y > lines - 2)
+		return false;
+	if (isOccupied({ x, y }))
+		return false;
+	roads.at(y - 1)->addObstacle(x, y);
+	return true;
+}
+
+const std::vector<Road*>& Map::getRoads()
+{
+	return roads;
+}
+
+size_t Map::getEntityCount()
+{
+	size_t count = frogs.size();
+	for (const auto road : roads)
+		count += road->getEntities().size();
+
+	return count;
+}
+
+std::pair<int, int> Map::getSize( )
+{
+	return std::make_pair( columns, lines );
+}
+
+int Map::getLevel()
+{
+	return level;
+}
+
+void Map::setLevel(int level)
+{
+	this->level = level;
+	for (const auto road : roads)
+		road->getEntities().setSpeed(ENTITY_TYPE_CAR, settings.init_car_speed + (level * 0.25));
+}
+
+Player Map::addFrog( int pid, int x, int y )
+{
+	return Player( &frogs, frogs.add( pid, x, y ) );
+}
+
+void Map::removeFrog( int pid )
+{
+	const auto index = frogs.find( pid );
+	if ( index != -1 )
+		frogs.remove( index );
+}
\ No newline at end of file
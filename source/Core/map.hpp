@@ -0,0 +1,105 @@
+#pragma once 
+
+#include <vector>
+#include <utility>
+#include <functional>
+
+#include "grid.hpp"
+#include "pool.hpp"
+#include "road.hpp"
+#include "random.hpp"
+#include "player.hpp"
+#include "settings.hpp"
+#include "workers.hpp"
+#include "entity/store.hpp"
+#include "entity/entity.hpp"
+
+class Map
+{
+private:
+	int level = 1;
+	int lines = 0, columns = 0;
+	std::vector<Road*> roads;		// taken from road_pool, which owns them
+	Grid grid;
+	FrogStore frogs { &grid };
+
+	const GameSettings& settings;
+	Random& random;
+	Pool<Road>& road_pool;
+
+	// parallel road step, see processRoads( )
+	//
+	WorkerPool* ppool = nullptr;
+	std::vector<unsigned char> road_moved;
+	std::function<void( size_t )> road_step;
+
+	void initialize();
+
+	// level up: the roads go back to the pool and come out again empty, then get new cars
+	//
+	void rebuildRoads();
+
+	int checkWin();
+
+	void repositionEntities();
+
+	void repositionEntities( size_t road );
+
+	bool processRoads( );
+
+	void checkColision();
+
+public:
+	// the roads come from road_pool, the map rewinds it when it's rebuilt or destroyed (one map per pool at a time)
+	//
+	Map( const GameSettings& settings, Random& random, Pool<Road>& road_pool );
+
+	~Map( );
+
+	// large boards step their roads on the pool, with the same result as the serial tick
+	//
+	void setWorkerPool( WorkerPool* ppool );
+
+	bool processTick();
+
+	// back to level 1 without frogs or rocks, the way a new map starts, reusing the memory of this one
+	//
+	void reset();
+
+	bool isOccupied( std::pair<int, int> coords );
+
+	FrogStore& getFrogs( );
+
+	bool placeRock(int x, int y);
+
+	const std::vector<Road*>& getRoads();
+
+	// calls fn( const Entity& ) for every entity without copying the list, the views are only valid during the call
+	// frogs go first, a frog's slot in the snapshot is its index in the store (GameEngine::getPlayerAcks relies on it)
+	//
+	template <typename Fn>
+	void forEachEntity( Fn&& fn )
+	{
+		for ( size_t i = 0; i < frogs.size( ); i++ )
+			fn( Entity( &frogs, i ) );
+
+		for ( const auto road : roads )
+		{
+			auto& entities = road->getEntities( );
+			for ( size_t j = 0; j < entities.size( ); j++ )
+				fn( Entity( &entities, j ) );
+		}
+	}
+
+	size_t getEntityCount( );
+
+	std::pair<int, int> getSize( );
+
+	int getLevel();
+
+	void setLevel(int level);
+
+	Player addFrog( int pid, int x, int y );
+
+	void removeFrog( int pid );
+};
\ No newline at end of file
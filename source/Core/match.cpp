@@ -0,0 +1,241 @@
+#include "match.hpp"
+
+#include <algorithm>
+
+#include "metrics.hpp"
+
+// every frog starts on a cell of the first line, a match that seated more players than that would leave one without
+// a frog. a player that doesn't fit goes to another match, or is declined once there is none left
+//
+MatchManager::MatchManager( const GameSettings& settings, int max_matches, int players_per_match, int num_threads, Random random ) :
+	settings( settings ), players_per_match( std::clamp( players_per_match, 1, std::max( 1, settings.num_columns ) ) ), seed( random.getSeed( ) ), pool( num_threads )
+{
+	// a match is only created when a player joins, invalid settings are reported here instead
+	//
+	GameEngine probe( settings );
+
+	matches.resize( std::max( 1, max_matches ), MATCH { nullptr, SINGLEPLAYER, 0, false } );
+
+	step = [ this ] ( size_t index )
+		{
+			const auto [match, pengine] = running[ index ];
+
+			const bool processed = pengine->processTick( );
+			if ( on_tick )
+				on_tick( match, *pengine, processed );
+		};
+}
+
+MatchManager::~MatchManager( )
+{
+	for ( auto& match : matches )
+		if ( match.pengine )
+			delete match.pengine;
+}
+
+void MatchManager::setOnTick( TickCallback callback )
+{
+	on_tick = callback;
+}
+
+void MatchManager::setOnClose( CloseCallback callback )
+{
+	on_close = callback;
+}
+
+void MatchManager::setReplayDirectory( const std::string& directory )
+{
+	std::unique_lock lock( mutex );
+	replay_directory = directory;
+}
+
+int MatchManager::join( uint32_t pid, GAME_TYPE type )
+{
+	std::unique_lock lock( mutex );
+
+	// a spectator isn't a player of the match, it watches the first one running and doesn't keep it open
+	//
+	if ( type == SPECTATOR )
+	{
+		for ( int i = 0; i < matches.size( ); i++ )
+			if ( matches[ i ].pengine && !matches[ i ].closing )
+				return i;
+
+		return -1;
+	}
+
+	if ( players.find( pid ) != players.end( ) )
+		return -1;
+
+	int index = -1;
+	if ( type == MULTIPLAYER )
+	{
+		for ( int i = 0; i < matches.size( ) && index == -1; i++ )
+		{
+			const auto& match = matches[ i ];
+			if ( match.pengine && !match.closing && match.type == MULTIPLAYER && match.players < players_per_match )
+				index = i;
+		}
+	}
+
+	// lowest free slot, so the first match running always has the same id
+	//
+	for ( int i = 0; i < matches.size( ) && index == -1; i++ )
+	{
+		auto& match = matches[ i ];
+		if ( match.pengine )
+			continue;
+
+		const auto match_seed = seed + num_created++;
+
+		try
+		{
+			match.pengine = new GameEngine( settings, Random( match_seed ) );
+		}
+		catch ( const std::exception& )
+		{
+			return -1;
+		}
+
+		if ( !replay_directory.empty( ) )
+			match.pengine->startRecording( replay_directory + "/match-" + std::to_string( match_seed ) + ".crr" );
+
+		// a big board steps its roads on the pool too, while the matches themselves run in parallel that is done serially
+		//
+		match.pengine->setWorkerPool( &pool );
+
+		match.type = type;
+		match.players = 0;
+		match.closing = false;
+
+		index = i;
+	}
+
+	if ( index == -1 )
+		return -1;
+
+	auto& match = matches[ index ];
+	match.players++;
+	players[ pid ] = index;
+
+	match.pengine->queueInput( PLAYER_INPUT_JOIN, pid );
+
+	return index;
+}
+
+bool MatchManager::move( uint32_t pid, FACING direction, uint32_t seq )
+{
+	std::shared_lock lock( mutex );
+
+	const auto player = players.find( pid );
+	if ( player == players.end( ) )
+		return false;
+
+	return matches[ player->second ].pengine->queueInput( PLAYER_INPUT_MOVE, pid, direction, seq );
+}
+
+void MatchManager::leave( uint32_t pid )
+{
+	std::unique_lock lock( mutex );
+
+	const auto player = players.find( pid );
+	if ( player == players.end( ) )
+		return;
+
+	auto& match = matches[ player->second ];
+	players.erase( player );
+
+	match.pengine->queueInput( PLAYER_INPUT_LEAVE, pid );
+
+	if ( !--match.players )
+		match.closing = true;
+}
+
+void MatchManager::execute( Command command, int match )
+{
+	std::lock_guard lock( commands_mutex );
+	commands.push_back( { match, std::move( command ) } );
+}
+
+// the engines are only freed here, between two steps, so nothing else can be inside one of them
+// (joins and moves only queue inputs, under the shared mutex)
+//
+int MatchManager::processTick( )
+{
+	{
+		std::unique_lock lock( mutex );
+
+		running.clear( );
+		for ( int i = 0; i < matches.size( ); i++ )
+		{
+			auto& match = matches[ i ];
+			if ( match.closing )
+			{
+				delete match.pengine;
+				match.pengine = nullptr;
+				match.closing = false;
+
+				// before the lock is let go, no one can join the next match of the slot yet
+				//
+				if ( on_close )
+					on_close( i );
+			}
+
+			if ( match.pengine )
+				running.push_back( { i, match.pengine } );
+		}
+	}
+
+	{
+		std::lock_guard lock( commands_mutex );
+		pending.swap( commands );
+	}
+
+	Metrics::set( METRIC_COMMAND_QUEUE, static_cast<int64_t>( pending.size( ) ) );
+	Metrics::add( METRIC_COMMANDS, pending.size( ) );
+
+	// a command that doesn't fit a match (a road it doesn't have) leaves that one as it was
+	//
+	for ( const auto& [target, command] : pending )
+	{
+		for ( const auto& [match, pengine] : running )
+		{
+			if ( target != -1 && target != match )
+				continue;
+
+			try
+			{
+				command( *pengine );
+			}
+			catch ( const std::exception& )
+			{
+
+			}
+		}
+	}
+
+	pending.clear( );
+
+	pool.run( running.size( ), step );
+
+	return static_cast<int>( running.size( ) );
+}
+
+int MatchManager::getMatch( uint32_t pid )
+{
+	std::shared_lock lock( mutex );
+
+	const auto player = players.find( pid );
+	return player != players.end( ) ? player->second : -1;
+}
+
+MATCH_STATS MatchManager::getStats( )
+{
+	std::shared_lock lock( mutex );
+
+	MATCH_STATS stats { 0, static_cast<int>( players.size( ) ), pool.getThreadCount( ) };
+	for ( const auto& match : matches )
+		stats.matches += match.pengine && !match.closing;
+
+	return stats;
+}
\ No newline at end of file
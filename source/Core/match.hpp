@@ -0,0 +1,140 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <functional>
+#include <shared_mutex>
+#include <unordered_map>
+
+#include "engine.hpp"
+#include "random.hpp"
+#include "workers.hpp"
+#include "protocol.hpp"
+#include "settings.hpp"
+
+typedef struct
+{
+	int matches;		// games running
+	int players;
+	int threads;		// ticking them, the caller of processTick( ) included
+} MATCH_STATS;
+
+// runs many independent games side by side, every processTick( ) steps each of them once on a fixed pool of threads
+// a singleplayer game gets a match of its own, a multiplayer one takes a seat in the first match that has one free.
+// a match ends with its last player, its slot (the id the transports know it by) is handed out again
+// join( ), move( ), leave( ) and execute( ) are thread safe, processTick( ) is called from a single thread
+// throws std::runtime_error if the settings describe an invalid map
+//
+class MatchManager
+{
+public:
+	// called from the pool once a match stepped, matches are stepped in parallel
+	//
+	using TickCallback = std::function<void( int match, GameEngine& engine, bool processed )>;
+
+	using Command = std::function<void( GameEngine& engine )>;
+
+	// called from processTick( ) once a match is gone, before its slot can run another one
+	// it runs under the lock of the manager, so it must not call back into it
+	//
+	using CloseCallback = std::function<void( int match )>;
+
+private:
+	typedef struct
+	{
+		GameEngine* pengine;		// nullptr while the slot is free
+		GAME_TYPE type;
+		int players;
+		bool closing;				// the last player left, freed by the next processTick( )
+	} MATCH;
+
+	GameSettings settings;
+	int players_per_match;
+
+	// every match gets a seed of its own, derived from this one, so a run can be reproduced
+	//
+	uint32_t seed;
+	uint32_t num_created = 0;
+
+	// exclusive to add or remove a match or a player, shared to queue a move
+	//
+	std::shared_mutex mutex;
+	std::vector<MATCH> matches;
+	std::unordered_map<uint32_t, int> players;
+
+	// each with the match it is for, -1 for every one
+	//
+	std::mutex commands_mutex;
+	std::vector<std::pair<int, Command>> commands;
+
+	WorkerPool pool;
+
+	// only touched by processTick( )
+	//
+	std::vector<std::pair<int, GameEngine*>> running;
+	std::vector<std::pair<int, Command>> pending;
+	std::function<void( size_t )> step;
+
+	TickCallback on_tick;
+	CloseCallback on_close;
+
+	std::string replay_directory;
+
+public:
+	// num_threads = 0 sizes the pool to the cores
+	//
+	MatchManager( const GameSettings& settings = GameSettings( ), int max_matches = 256, int players_per_match = 2, int num_threads = 0, Random random = Random( ) );
+
+	~MatchManager( );
+
+	MatchManager( const MatchManager& ) = delete;
+	MatchManager& operator=( const MatchManager& ) = delete;
+
+	// set before the first processTick( )
+	//
+	void setOnTick( TickCallback callback );
+
+	void setOnClose( CloseCallback callback );
+
+	// every match created from now on is recorded to <directory>/match-<seed>.crr, for runReplay( )
+	// a match whose file can't be created runs without one
+	//
+	void setReplayDirectory( const std::string& directory );
+
+	// returns the match the player went to, -1 if it is already playing or there is no room for another match
+	// a spectator only gets the match to watch (-1 while none is running), it isn't added to it
+	//
+	int join( uint32_t pid, GAME_TYPE type );
+
+	bool move( uint32_t pid, FACING direction, uint32_t seq );
+
+	void leave( uint32_t pid );
+
+	// runs command on match (on every running one with -1) at the start of the next processTick( ), before any of them steps
+	// a match that isn't running by then doesn't get it
+	//
+	void execute( Command command, int match = -1 );
+
+	// steps every match once, returns how many ran
+	//
+	int processTick( );
+
+	// -1 if the player isn't in a match
+	//
+	int getMatch( uint32_t pid );
+
+	MATCH_STATS getStats( );
+
+	int getMaxMatches( )
+	{
+		return static_cast<int>( matches.size( ) );
+	}
+
+	const GameSettings& getSettings( )
+	{
+		return settings;
+	}
+};
\ No newline at end of file
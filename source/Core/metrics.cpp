@@ -0,0 +1,224 @@
+#include "metrics.hpp"
+
+#include <bit>
+#include <cstdio>
+
+static constexpr const char* timer_names[ METRIC_TIMER_MAX ] = {
+	"tick", "inputs", "roads", "reposition", "collision", "snapshot", "operator_update"
+};
+
+static constexpr const char* counter_names[ METRIC_COUNTER_MAX ] = {
+	"pipe_writes", "pipe_bytes", "pipe_dropped", "pipe_evicted", "tcp_writes", "tcp_bytes", "tcp_dropped", "tcp_evicted", "commands"
+};
+
+static constexpr const char* gauge_names[ METRIC_GAUGE_MAX ] = {
+	"command_queue", "input_batch"
+};
+
+Metrics& Metrics::instance( )
+{
+	static Metrics metrics;
+	return metrics;
+}
+
+Metrics::SHARD& Metrics::local( )
+{
+	thread_local SHARD* pshard = nullptr;
+	if ( pshard )
+		return *pshard;
+
+	auto& metrics = instance( );
+	std::lock_guard<std::mutex> lock( metrics.mutex );
+
+	metrics.shards.push_back( std::make_unique<SHARD>( ) );
+	pshard = metrics.shards.back( ).get( );
+
+	return *pshard;
+}
+
+void Metrics::time( METRIC_TIMER timer, uint64_t ns )
+{
+	auto& slot = local( ).timers[ timer ];
+
+	bump( slot.count, 1 );
+	bump( slot.total_ns, ns );
+	bump( slot.histogram[ std::bit_width( ns ) & ( buckets - 1 ) ], 1 );
+
+	if ( ns > slot.max_ns.load( std::memory_order_relaxed ) )
+		slot.max_ns.store( ns, std::memory_order_relaxed );
+}
+
+void Metrics::set( METRIC_GAUGE gauge, int64_t value )
+{
+	auto& slot = local( ).gauges[ gauge ];
+
+	slot.value.store( value, std::memory_order_relaxed );
+	slot.written_ns.store( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ).time_since_epoch( ) ).count( ),
+		std::memory_order_relaxed );
+
+	if ( value > slot.max.load( std::memory_order_relaxed ) )
+		slot.max.store( value, std::memory_order_relaxed );
+}
+
+// bucket b holds the durations of b significant bits, [ 2^(b-1), 2^b )
+//
+static uint64_t percentile( const uint64_t* histogram, int buckets, uint64_t count, double quantile )
+{
+	if ( !count )
+		return 0;
+
+	const auto target = static_cast<uint64_t>( quantile * ( count - 1 ) );
+
+	uint64_t seen = 0;
+	for ( int b = 0; b < buckets; b++ )
+	{
+		seen += histogram[ b ];
+		if ( seen > target )
+			return b ? ( uint64_t( 1 ) << b ) - 1 : 0;
+	}
+
+	return ~uint64_t( 0 );
+}
+
+METRICS Metrics::read( )
+{
+	METRICS metrics { };
+	uint64_t histograms[ METRIC_TIMER_MAX ][ buckets ] { };
+	int64_t gauges_written[ METRIC_GAUGE_MAX ] { };
+
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+
+		for ( const auto& shard : shards )
+		{
+			for ( int i = 0; i < METRIC_COUNTER_MAX; i++ )
+				metrics.counters[ i ] += shard->counters[ i ].load( std::memory_order_relaxed );
+
+			for ( int i = 0; i < METRIC_TIMER_MAX; i++ )
+			{
+				auto& timer = metrics.timers[ i ];
+				const auto& slot = shard->timers[ i ];
+
+				timer.count += slot.count.load( std::memory_order_relaxed );
+				timer.total_ns += slot.total_ns.load( std::memory_order_relaxed );
+
+				const auto max_ns = slot.max_ns.load( std::memory_order_relaxed );
+				timer.max_ns = max_ns > timer.max_ns ? max_ns : timer.max_ns;
+
+				for ( int b = 0; b < buckets; b++ )
+					histograms[ i ][ b ] += slot.histogram[ b ].load( std::memory_order_relaxed );
+			}
+
+			for ( int i = 0; i < METRIC_GAUGE_MAX; i++ )
+			{
+				auto& gauge = metrics.gauges[ i ];
+				const auto& slot = shard->gauges[ i ];
+
+				const auto written_ns = slot.written_ns.load( std::memory_order_relaxed );
+				if ( written_ns > gauges_written[ i ] )
+				{
+					gauges_written[ i ] = written_ns;
+					gauge.value = slot.value.load( std::memory_order_relaxed );
+				}
+
+				const auto max = slot.max.load( std::memory_order_relaxed );
+				gauge.max = max > gauge.max ? max : gauge.max;
+			}
+		}
+	}
+
+	for ( int i = 0; i < METRIC_TIMER_MAX; i++ )
+	{
+		uint64_t count = 0;
+		for ( int b = 0; b < buckets; b++ )
+			count += histograms[ i ][ b ];
+
+		metrics.timers[ i ].p50_ns = percentile( histograms[ i ], buckets, count, 0.5 );
+		metrics.timers[ i ].p99_ns = percentile( histograms[ i ], buckets, count, 0.99 );
+	}
+
+	return metrics;
+}
+
+std::string Metrics::format( const METRICS& metrics )
+{
+	std::string text;
+	char line[ 160 ];
+
+	std::snprintf( line, sizeof( line ), "%-16s %12s %10s %10s %10s %10s\n", "timer", "count", "avg us", "p50 us", "p99 us", "max us" );
+	text += line;
+
+	for ( int i = 0; i < METRIC_TIMER_MAX; i++ )
+	{
+		const auto& timer = metrics.timers[ i ];
+		const auto avg = timer.count ? timer.total_ns / static_cast<double>( timer.count ) : 0.0;
+
+		std::snprintf( line, sizeof( line ), "%-16s %12llu %10.2f %10.2f %10.2f %10.2f\n", timer_names[ i ], static_cast<unsigned long long>( timer.count ),
+			avg / 1000.0, timer.p50_ns / 1000.0, timer.p99_ns / 1000.0, timer.max_ns / 1000.0 );
+		text += line;
+	}
+
+	for ( int i = 0; i < METRIC_COUNTER_MAX; i++ )
+	{
+		std::snprintf( line, sizeof( line ), "%-16s %12llu\n", counter_names[ i ], static_cast<unsigned long long>( metrics.counters[ i ] ) );
+		text += line;
+	}
+
+	for ( int i = 0; i < METRIC_GAUGE_MAX; i++ )
+	{
+		std::snprintf( line, sizeof( line ), "%-16s %12lld (max %lld)\n", gauge_names[ i ], static_cast<long long>( metrics.gauges[ i ].value ),
+			static_cast<long long>( metrics.gauges[ i ].max ) );
+		text += line;
+	}
+
+	return text;
+}
+
+std::string Metrics::toJson( const METRICS& metrics )
+{
+	std::string json = "{\"timers\":{";
+	char field[ 256 ];
+
+	for ( int i = 0; i < METRIC_TIMER_MAX; i++ )
+	{
+		const auto& timer = metrics.timers[ i ];
+		std::snprintf( field, sizeof( field ), "%s\"%s\":{\"count\":%llu,\"total_ns\":%llu,\"p50_ns\":%llu,\"p99_ns\":%llu,\"max_ns\":%llu}", i ? "," : "",
+			timer_names[ i ], static_cast<unsigned long long>( timer.count ), static_cast<unsigned long long>( timer.total_ns ),
+			static_cast<unsigned long long>( timer.p50_ns ), static_cast<unsigned long long>( timer.p99_ns ), static_cast<unsigned long long>( timer.max_ns ) );
+		json += field;
+	}
+
+	json += "},\"counters\":{";
+	for ( int i = 0; i < METRIC_COUNTER_MAX; i++ )
+	{
+		std::snprintf( field, sizeof( field ), "%s\"%s\":%llu", i ? "," : "", counter_names[ i ], static_cast<unsigned long long>( metrics.counters[ i ] ) );
+		json += field;
+	}
+
+	json += "},\"gauges\":{";
+	for ( int i = 0; i < METRIC_GAUGE_MAX; i++ )
+	{
+		std::snprintf( field, sizeof( field ), "%s\"%s\":{\"value\":%lld,\"max\":%lld}", i ? "," : "", gauge_names[ i ],
+			static_cast<long long>( metrics.gauges[ i ].value ), static_cast<long long>( metrics.gauges[ i ].max ) );
+		json += field;
+	}
+
+	json += "}}";
+
+	return json;
+}
+
+const char* Metrics::getName( METRIC_TIMER timer )
+{
+	return timer_names[ timer ];
+}
+
+const char* Metrics::getName( METRIC_COUNTER counter )
+{
+	return counter_names[ counter ];
+}
+
+const char* Metrics::getName( METRIC_GAUGE gauge )
+{
+	return gauge_names[ gauge ];
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+enum METRIC_TIMER
+{
+	METRIC_TICK,				// GameEngine::processTick of one match
+	METRIC_INPUTS,				// the queued inputs applied at the start of it
+	METRIC_ROADS,				// the roads stepped (and repositioned, when they run on the pool)
+	METRIC_REPOSITION,			// Map::repositionEntities of a serial tick
+	METRIC_COLLISION,			// Map::checkColision
+	METRIC_SNAPSHOT,			// a tick serialized for a transport
+	METRIC_OPERATOR_UPDATE,		// a tick serialized and written to the operators' shared memory
+	METRIC_TIMER_MAX
+};
+
+enum METRIC_COUNTER
+{
+	METRIC_PIPE_WRITES,			// frames written to local clients
+	METRIC_PIPE_BYTES,
+	METRIC_PIPE_DROPPED,		// frames a local client missed, it was still reading the previous one
+	METRIC_PIPE_EVICTED,		// local clients disconnected for not reading a frame within the write timeout
+	METRIC_TCP_WRITES,
+	METRIC_TCP_BYTES,
+	METRIC_TCP_DROPPED,
+	METRIC_TCP_EVICTED,
+	METRIC_COMMANDS,			// operator commands run on the matches
+	METRIC_COUNTER_MAX
+};
+
+enum METRIC_GAUGE
+{
+	METRIC_COMMAND_QUEUE,		// operator commands taken by the last round
+	METRIC_INPUT_BATCH,			// inputs applied by the last tick of a match
+	METRIC_GAUGE_MAX
+};
+
+typedef struct
+{
+	uint64_t count;
+	uint64_t total_ns, max_ns;
+	uint64_t p50_ns, p99_ns;	// upper bound of the power of two bucket the percentile falls in
+} TIMER_METRICS;
+
+typedef struct
+{
+	int64_t value, max;
+} GAUGE_METRICS;
+
+typedef struct
+{
+	TIMER_METRICS timers[ METRIC_TIMER_MAX ];
+	uint64_t counters[ METRIC_COUNTER_MAX ];
+	GAUGE_METRICS gauges[ METRIC_GAUGE_MAX ];
+} METRICS;
+
+// what a transport sent to one of its clients
+//
+typedef struct
+{
+	uint32_t pid;
+	int match;
+	uint64_t writes, bytes, dropped;
+	bool spectator;
+} CLIENT_METRICS;
+
+// process wide counters and phase timers of the hot path
+// every thread writes a shard of its own (no lock, no shared cache line, no atomic read-modify-write), a read sums
+// the shards up. a shard is registered the first time its thread records something and is kept when the thread
+// ends, so the totals never go backwards. reads may see a timer's count before its total, they are for display
+//
+class Metrics
+{
+private:
+	inline static constexpr int buckets = 64;
+
+	struct alignas( 64 ) SHARD
+	{
+		std::atomic<uint64_t> counters[ METRIC_COUNTER_MAX ] { };
+
+		struct
+		{
+			std::atomic<uint64_t> count { 0 }, total_ns { 0 }, max_ns { 0 };
+			std::atomic<uint64_t> histogram[ buckets ] { };
+		} timers[ METRIC_TIMER_MAX ];
+
+		// written_ns tells which shard set a gauge last, that one's value is the gauge's
+		//
+		struct
+		{
+			std::atomic<int64_t> value { 0 }, max { 0 }, written_ns { 0 };
+		} gauges[ METRIC_GAUGE_MAX ];
+	};
+
+	std::mutex mutex;
+	std::vector<std::unique_ptr<SHARD>> shards;
+
+	static SHARD& local( );
+
+	// only the owning thread writes a shard, a plain load and store is enough
+	//
+	static void bump( std::atomic<uint64_t>& value, uint64_t amount )
+	{
+		value.store( value.load( std::memory_order_relaxed ) + amount, std::memory_order_relaxed );
+	}
+
+public:
+	static Metrics& instance( );
+
+	static void add( METRIC_COUNTER counter, uint64_t amount = 1 )
+	{
+		bump( local( ).counters[ counter ], amount );
+	}
+
+	static void time( METRIC_TIMER timer, uint64_t ns );
+
+	// last value wins (by the time it was set at), the max is kept across writers
+	//
+	static void set( METRIC_GAUGE gauge, int64_t value );
+
+	METRICS read( );
+
+	// a table for the console and one json object for dashboards
+	//
+	static std::string format( const METRICS& metrics );
+
+	static std::string toJson( const METRICS& metrics );
+
+	static const char* getName( METRIC_TIMER timer );
+
+	static const char* getName( METRIC_COUNTER counter );
+
+	static const char* getName( METRIC_GAUGE gauge );
+};
+
+// times the scope it lives in
+//
+class MetricTimer
+{
+private:
+	METRIC_TIMER timer;
+	std::chrono::steady_clock::time_point start;
+
+public:
+	MetricTimer( METRIC_TIMER timer ) : timer( timer ), start( std::chrono::steady_clock::now( ) )
+	{
+
+	}
+
+	~MetricTimer( )
+	{
+		Metrics::time( timer, std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now( ) - start ).count( ) );
+	}
+
+	MetricTimer( const MetricTimer& ) = delete;
+	MetricTimer& operator=( const MetricTimer& ) = delete;
+};
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <utility>
+#include <algorithm>
+
+#include "entity/frog.hpp"
+
+class Player : public Frog
+{
+public:
+	// a frog can't move again before this much time has passed (see EntityStore::canMove)
+	//
+	inline static constexpr int move_interval_ms = static_cast<int>( 500 / FrogStore::frog_speed );
+
+	Player( FrogStore* store, size_t index ) : Frog( store, index )
+	{
+
+	}
+
+	// where a move leaves a frog on a board of columns x lines, the client predicts its own moves with it
+	//
+	static std::pair<int, int> step( std::pair<int, int> position, FACING direction, int columns, int lines )
+	{
+		return clamp( EntityStore::step( position, direction ), columns, lines );
+	}
+
+	static std::pair<int, int> clamp( std::pair<int, int> position, int columns, int lines )
+	{
+		position.first = std::max( 0, std::min( position.first, columns - 1 ) );
+		position.second = std::max( 0, std::min( position.second, lines - 1 ) );
+		return position;
+	}
+
+	int getPid( )
+	{
+		return frogs->getPid( index );
+	}
+
+	int getPoints( )
+	{
+		return frogs->getPoints( index );
+	}
+
+	void setPoints( int points )
+	{
+		frogs->setPoints( index, points );
+	}
+
+	void addPoints( int points )
+	{
+		frogs->setPoints( index, getPoints( ) + points );
+	}
+
+	void resetPoints( )
+	{
+		frogs->setPoints( index, 0 );
+	}
+};
\ No newline at end of file
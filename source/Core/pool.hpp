@@ -0,0 +1,55 @@
+#pragma once
+
+#include <deque>
+#include <cstddef>
+
+// objects handed out one after the other and taken back all at once
+// rewind( ) destroys nothing, the next acquire( ) calls hand the same objects out again together with the memory they
+// hold on to (a road keeps the capacity of its entity arrays), so rebuilding what was built before doesn't allocate.
+// objects never move, a pointer to one stays valid for as long as the pool lives
+//
+template <typename T>
+class Pool
+{
+private:
+	std::deque<T> objects;
+	size_t used = 0;
+
+public:
+	Pool( )
+	{
+
+	}
+
+	Pool( const Pool& ) = delete;
+	Pool& operator=( const Pool& ) = delete;
+
+	// a new object is default constructed, a recycled one comes back the way it was left and the caller resets it
+	//
+	T& acquire( )
+	{
+		if ( used == objects.size( ) )
+			objects.emplace_back( );
+
+		return objects[ used++ ];
+	}
+
+	// every object handed out so far is free again
+	//
+	void rewind( )
+	{
+		used = 0;
+	}
+
+	size_t size( ) const
+	{
+		return used;
+	}
+
+	// objects constructed so far, they are only freed with the pool
+	//
+	size_t capacity( ) const
+	{
+		return objects.size( );
+	}
+};
\ No newline at end of file
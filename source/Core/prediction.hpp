@@ -0,0 +1,169 @@
+#pragma once
+
+#include <deque>
+#include <chrono>
+#include <cstdint>
+
+#include "player.hpp"
+#include "protocol.hpp"
+
+typedef struct
+{
+	uint32_t seq;
+	FACING direction;
+	bool predicted;			// moved locally, or held back by the rate limit
+	std::chrono::steady_clock::time_point sent_at;
+	int pos_x, pos_y;		// where the frog was drawn once this input was sent
+} PREDICTED_INPUT;
+
+// client side prediction of the own frog
+// an input moves the frog locally as soon as it is sent, with the same rules the engine applies to it,
+// and stays pending until a frame acknowledges it. every authoritative frame replaces the prediction
+// and the inputs the server hasn't taken yet are replayed on top of it
+//
+class Predictor
+{
+private:
+	// the server isn't taking the inputs, stop running ahead of it
+	//
+	inline static constexpr size_t max_pending = 32;
+
+	std::deque<PREDICTED_INPUT> pending;
+	uint32_t next_seq = 1;
+
+	int slot = -1;			// own frog in the replica, -1 while there is none
+	int pos_x = 0, pos_y = 0;
+	FACING direction = UP;
+	int columns = 0, lines = 0;
+
+	// the rate limit runs from the last move the server took, a local guess would drift out of phase with it
+	//
+	int server_x = 0, server_y = 0;
+	std::chrono::steady_clock::time_point last_move { };
+
+	uint64_t predicted = 0, corrected = 0;
+
+public:
+	void reset( )
+	{
+		pending.clear( );
+		slot = -1;
+		last_move = { };
+	}
+
+	// returns the seq the input is sent with, the frog moves right away if the rules let it
+	//
+	uint32_t predict( FACING direction )
+	{
+		const auto seq = next_seq++;
+		if ( slot == -1 || pending.size( ) >= max_pending )
+			return seq;
+
+		const auto now = std::chrono::steady_clock::now( );
+
+		auto previous = last_move;
+		for ( const auto& input : pending )
+			if ( input.predicted )
+				previous = input.sent_at;
+
+		const bool can_move = now - previous >= std::chrono::milliseconds( Player::move_interval_ms );
+		if ( can_move )
+		{
+			const auto position = Player::step( { pos_x, pos_y }, direction, columns, lines );
+			pos_x = position.first;
+			pos_y = position.second;
+			this->direction = direction;
+
+			predicted++;
+		}
+
+		pending.push_back( { seq, direction, can_move, now, pos_x, pos_y } );
+
+		return seq;
+	}
+
+	// call after every frame applied to the replica
+	//
+	void reconcile( const DATA& replica, uint32_t input_ack, int player_slot )
+	{
+		if ( player_slot < 0 || player_slot >= replica.num_entities || replica.entities[ player_slot ].type != ENTITY_TYPE_FROG )
+		{
+			reset( );
+			return;
+		}
+
+		const auto& frog = replica.entities[ player_slot ];
+		const bool moved = slot != -1 && ( frog.pos_x != server_x || frog.pos_y != server_y );
+
+		// the frog has to be where we drew it after the last input the server took
+		//
+		bool acked = false;
+		PREDICTED_INPUT last { };
+		while ( !pending.empty( ) && static_cast<int32_t>( pending.front( ).seq - input_ack ) <= 0 )
+		{
+			last = pending.front( );
+			acked = true;
+			pending.pop_front( );
+		}
+
+		// a frog that just joined has to wait like one that just moved
+		//
+		if ( slot == -1 )
+			last_move = std::chrono::steady_clock::now( );
+		else if ( acked && moved )
+			last_move = last.sent_at;
+
+		if ( acked && ( last.pos_x != frog.pos_x || last.pos_y != frog.pos_y ) )
+			corrected++;
+
+		slot = player_slot;
+		columns = replica.width;
+		lines = replica.height;
+		pos_x = server_x = frog.pos_x;
+		pos_y = server_y = frog.pos_y;
+		direction = frog.direction;
+
+		for ( auto& input : pending )
+		{
+			if ( input.predicted )
+			{
+				const auto position = Player::step( { pos_x, pos_y }, input.direction, columns, lines );
+				pos_x = position.first;
+				pos_y = position.second;
+				direction = input.direction;
+			}
+
+			input.pos_x = pos_x;
+			input.pos_y = pos_y;
+		}
+	}
+
+	// draws the own frog of view (a copy of the replica) where we predict it
+	//
+	void apply( DATA& view ) const
+	{
+		if ( slot == -1 || slot >= view.num_entities )
+			return;
+
+		view.entities[ slot ].pos_x = pos_x;
+		view.entities[ slot ].pos_y = pos_y;
+		view.entities[ slot ].direction = direction;
+	}
+
+	size_t getPending( ) const
+	{
+		return pending.size( );
+	}
+
+	// inputs moved locally, and how many of them the server placed somewhere else
+	//
+	uint64_t getPredicted( ) const
+	{
+		return predicted;
+	}
+
+	uint64_t getCorrected( ) const
+	{
+		return corrected;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include "entity/types.hpp"
+#include "entity/entity.hpp"
+
+// the frames address an entity by a 16 bit slot and a cell by 16 bit coordinates, a board can't get larger than that
+// every entity but the frogs takes a cell of its own on the roads, so a board never has more entities than cells
+//
+#define MAX_BOARD_SIDE      0x7fff
+#define MAX_BOARD_CELLS     0xffff
+
+#define PROTOCOL_VERSION    4
+
+typedef struct
+{
+	ENTITY_TYPE type;
+	FACING direction;
+	int pos_x, pos_y;
+} ENTITY;
+
+// what a joining client asks for, a game of its own, a seat in a shared one or a read-only view of one
+//
+typedef enum
+{
+	SINGLEPLAYER,
+	MULTIPLAYER,
+	SPECTATOR
+} GAME_TYPE;
+
+enum GAME_STATE
+{
+	GAME_STATE_READY,
+	GAME_STATE_RUNNING,
+	GAME_STATE_PLAYER1_WINS,
+	GAME_STATE_PLAYER2_WINS,
+	GAME_STATE_DRAW,
+	GAME_STATE_LOSS,
+	GAME_STATE_MAX
+};
+
+// snapshot sent to the operators and clients once per processed tick
+// entities holds num_entities, as many as the board has, its capacity is kept when a copy is assigned to it
+//
+typedef struct
+{
+	GAME_STATE state;
+	int time, level;
+	int width, height;
+	int num_entities;
+	std::vector<ENTITY> entities;
+} DATA;
+
+// last input the engine took from a player and the slot of its frog in the snapshot
+//
+typedef struct
+{
+	int pid;
+	int slot;
+	uint32_t input_seq;
+} PLAYER_ACK;
+
+// a serialized tick, tagged with the tick it was taken at
+// the acks are not part of DATA, every client only gets its own one in the frame header
+//
+typedef struct
+{
+	uint32_t seq;
+	DATA data;
+	std::vector<PLAYER_ACK> players;
+} SNAPSHOT;
+
+// fills data with the snapshot of the given entities
+// fails if an entity has an invalid type or if there are more than a frame can address
+//
+inline bool serializeSnapshot( DATA& data, std::span<const Entity> entities, GAME_STATE state, int time, int level, int width, int height )
+{
+	data.time = time;
+	data.state = state;
+	data.level = level;
+	data.width = width;
+	data.height = height;
+	data.num_entities = 0;
+
+	if ( entities.size( ) > MAX_BOARD_CELLS )
+		return false;
+
+	data.entities.resize( entities.size( ) );
+
+	for ( auto& entity : entities )
+	{
+		const auto type = entity.getType( );
+		if ( type < ENTITY_TYPE::ENTITY_TYPE_OBSTACLE || type >= ENTITY_TYPE::ENTITY_TYPE_MAX )
+			return false;
+
+		auto entity_data = &data.entities[ data.num_entities++ ];
+
+		const auto pos = entity.getPosition( );
+		entity_data->pos_x = pos.first;
+		entity_data->pos_y = pos.second;
+
+		entity_data->direction = entity.getFacingDirection( );
+		entity_data->type = type;
+	}
+
+	return true;
+}
+
+inline void serializeAcks( SNAPSHOT& snapshot, std::span<const PLAYER_ACK> acks )
+{
+	snapshot.players.assign( acks.begin( ), acks.end( ) );
+}
+
+enum FRAME_TYPE
+{
+	FRAME_KEYFRAME,		// followed by num_records ENTITY, replaces the whole replica
+	FRAME_DELTA			// followed by num_records ENTITY_DELTA, applies on top of the frame base_seq
+};
+
+// header of every game update sent to a client
+// entities are addressed by their slot in the snapshot, a removal shrinks num_entities and
+// whatever moved into the freed slots is sent as a change of those slots
+//
+typedef struct
+{
+	int version;
+	FRAME_TYPE type;
+	uint32_t seq, base_seq;
+	GAME_STATE state;
+	int time, level;
+	int width, height;
+	int num_entities;
+	int num_records;
+	uint32_t input_ack;		// last input of this client the frame reflects
+	int player_slot;		// its frog, -1 if it has none
+} FRAME_HEADER;
+
+typedef struct
+{
+	int slot;
+	ENTITY entity;
+} ENTITY_DELTA;
+
+inline void fillFrameHeader( FRAME_HEADER& header, FRAME_TYPE type, const DATA& data, uint32_t seq, uint32_t base_seq )
+{
+	header.version = PROTOCOL_VERSION;
+	header.type = type;
+	header.seq = seq;
+	header.base_seq = base_seq;
+	header.state = data.state;
+	header.time = data.time;
+	header.level = data.level;
+	header.width = data.width;
+	header.height = data.height;
+	header.num_entities = data.num_entities;
+	header.num_records = 0;
+	header.input_ack = 0;
+	header.player_slot = -1;
+}
+
+// the part of the header that differs between clients, filled after the frame was encoded
+//
+inline void fillFrameInput( FRAME_HEADER& header, const SNAPSHOT& snapshot, uint32_t pid )
+{
+	header.input_ack = 0;
+	header.player_slot = -1;
+
+	for ( const auto& player : snapshot.players )
+	{
+		if ( static_cast<uint32_t>( player.pid ) != pid )
+			continue;
+
+		header.input_ack = player.input_seq;
+		header.player_slot = player.slot;
+		break;
+	}
+}
+
+// records is reused between calls, so a steady stream doesn't allocate
+//
+inline void encodeKeyframe( const DATA& data, uint32_t seq, FRAME_HEADER& header, std::vector<char>& records )
+{
+	fillFrameHeader( header, FRAME_KEYFRAME, data, seq, seq );
+
+	header.num_records = data.num_entities;
+	records.resize( data.num_entities * sizeof( ENTITY ) );
+	if ( data.num_entities )
+		memcpy( records.data( ), data.entities.data( ), records.size( ) );
+}
+
+// returns false if there is nothing to send, data is exactly the base the client already has
+//
+inline bool encodeDelta( const DATA& base, uint32_t base_seq, const DATA& data, uint32_t seq, FRAME_HEADER& header, std::vector<char>& records )
+{
+	fillFrameHeader( header, FRAME_DELTA, data, seq, base_seq );
+
+	records.clear( );
+	for ( int i = 0; i < data.num_entities; i++ )
+	{
+		const auto& entity = data.entities[ i ];
+		if ( i < base.num_entities && !memcmp( &entity, &base.entities[ i ], sizeof( ENTITY ) ) )
+			continue;
+
+		ENTITY_DELTA delta;
+		delta.slot = i;
+		delta.entity = entity;
+
+		const auto offset = records.size( );
+		records.resize( offset + sizeof( ENTITY_DELTA ) );
+		memcpy( records.data( ) + offset, &delta, sizeof( ENTITY_DELTA ) );
+
+		header.num_records++;
+	}
+
+	return header.num_records || data.num_entities != base.num_entities || data.state != base.state || data.time != base.time ||
+		data.level != base.level || data.width != base.width || data.height != base.height;
+}
+
+// applies a frame to a client replica, fails if it can't be applied (the client must ask for a keyframe)
+// the replica grows with the board, a delta to a larger one carries every slot the base didn't have
+//
+inline bool applyFrame( DATA& replica, uint32_t& replica_seq, const FRAME_HEADER& header, const char* records )
+{
+	if ( header.version != PROTOCOL_VERSION || header.num_entities < 0 || header.num_entities > MAX_BOARD_CELLS )
+		return false;
+
+	if ( header.type == FRAME_DELTA && header.base_seq != replica_seq )
+		return false;
+
+	if ( header.type == FRAME_KEYFRAME && header.num_records != header.num_entities )
+		return false;
+
+	replica.entities.resize( header.num_entities );
+
+	if ( header.type == FRAME_KEYFRAME )
+	{
+		if ( header.num_records )
+			memcpy( replica.entities.data( ), records, header.num_records * sizeof( ENTITY ) );
+	}
+	else
+	{
+		for ( int i = 0; i < header.num_records; i++ )
+		{
+			ENTITY_DELTA delta;
+			memcpy( &delta, records + i * sizeof( ENTITY_DELTA ), sizeof( ENTITY_DELTA ) );
+
+			if ( delta.slot < 0 || delta.slot >= header.num_entities )
+				return false;
+
+			replica.entities[ delta.slot ] = delta.entity;
+		}
+	}
+
+	replica.state = header.state;
+	replica.time = header.time;
+	replica.level = header.level;
+	replica.width = header.width;
+	replica.height = header.height;
+	replica.num_entities = header.num_entities;
+
+	replica_seq = header.seq;
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+// bounded lock free queue, any number of producer threads and one consumer
+// producers reserve a position with a CAS and publish the cell through its sequence, a full queue turns the value down
+// instead of waiting, so a producer never blocks on the consumer
+//
+template <typename T, size_t N = 1024>
+class MpscQueue
+{
+	static_assert( std::is_trivially_copyable_v<T>, "values are copied in and out of the cells" );
+	static_assert( N >= 2 && !( N & ( N - 1 ) ), "the depth has to be a power of two" );
+
+private:
+	// sequence == position: free for the producer of that position
+	// sequence == position + 1: holds the value of that position for the consumer
+	//
+	struct alignas( 64 ) CELL
+	{
+		std::atomic<uint64_t> sequence;
+		T value;
+	};
+
+	CELL cells[ N ];
+
+	alignas( 64 ) std::atomic<uint64_t> enqueue_index { 0 };
+	alignas( 64 ) uint64_t dequeue_index = 0;
+
+public:
+	MpscQueue( )
+	{
+		for ( size_t i = 0; i < N; i++ )
+			cells[ i ].sequence.store( i, std::memory_order_relaxed );
+	}
+
+	MpscQueue( const MpscQueue& ) = delete;
+	MpscQueue& operator=( const MpscQueue& ) = delete;
+
+	// false if the queue is full
+	//
+	bool push( const T& value )
+	{
+		auto position = enqueue_index.load( std::memory_order_relaxed );
+		while ( true )
+		{
+			auto& cell = cells[ position & ( N - 1 ) ];
+			const auto sequence = cell.sequence.load( std::memory_order_acquire );
+
+			const auto difference = static_cast<int64_t>( sequence - position );
+			if ( !difference )
+			{
+				if ( enqueue_index.compare_exchange_weak( position, position + 1, std::memory_order_relaxed ) )
+				{
+					cell.value = value;
+					cell.sequence.store( position + 1, std::memory_order_release );
+					return true;
+				}
+			}
+			else if ( difference < 0 )
+				return false;
+			else
+				position = enqueue_index.load( std::memory_order_relaxed );
+		}
+	}
+
+	// consumer side, false once nothing published is left
+	//
+	bool pop( T& value )
+	{
+		const auto position = dequeue_index;
+		auto& cell = cells[ position & ( N - 1 ) ];
+
+		if ( cell.sequence.load( std::memory_order_acquire ) != position + 1 )
+			return false;
+
+		value = cell.value;
+
+		dequeue_index = position + 1;
+		cell.sequence.store( position + N, std::memory_order_release );
+		return true;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <random>
+#include <cstdint>
+
+// seedable rng owned by the engine, so a run can be reproduced from its seed
+//
+class Random
+{
+private:
+	uint32_t seed = 0;
+	std::minstd_rand num_gen;
+
+public:
+	Random( ) : Random( std::random_device { }( ) )
+	{
+
+	}
+
+	Random( uint32_t seed ) : seed( seed ), num_gen( seed )
+	{
+
+	}
+
+	int generateInt( int min, int max )
+	{
+		return static_cast<int>( num_gen( ) ) % ( max - min + 1 ) + min;
+	}
+
+	uint32_t getSeed( )
+	{
+		return seed;
+	}
+};
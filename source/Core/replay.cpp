@@ -0,0 +1,370 @@
+#include "replay.hpp"
+
+#include <cstring>
+
+#include "engine.hpp"
+
+static constexpr char replay_magic[ 4 ] = { 'C', 'R', 'R', 'P' };
+static constexpr uint8_t replay_version = 1;
+
+// flushed once it holds this much, or with a check so a log cut short still ends close to where the game did
+//
+static constexpr size_t replay_buffer_size = 0x10000;
+
+typedef struct
+{
+	const char* data;
+	size_t size;
+	size_t offset;
+	bool ok;			// cleared by any read past the end
+} REPLAY_READER;
+
+static uint8_t get8( REPLAY_READER& reader )
+{
+	if ( reader.offset >= reader.size )
+	{
+		reader.ok = false;
+		return 0;
+	}
+
+	return static_cast<uint8_t>( reader.data[ reader.offset++ ] );
+}
+
+static uint32_t get32( REPLAY_READER& reader )
+{
+	uint32_t value = 0;
+	for ( int i = 0; i < 4; i++ )
+		value |= static_cast<uint32_t>( get8( reader ) ) << ( i * 8 );
+
+	return value;
+}
+
+static uint64_t getVarint( REPLAY_READER& reader )
+{
+	uint64_t value = 0;
+	for ( int shift = 0; shift < 64 && reader.ok; shift += 7 )
+	{
+		const auto byte = get8( reader );
+		value |= static_cast<uint64_t>( byte & 0x7f ) << shift;
+
+		if ( !( byte & 0x80 ) )
+			return value;
+	}
+
+	reader.ok = false;
+	return 0;
+}
+
+// zigzag, small negative numbers stay small
+//
+static int64_t getSigned( REPLAY_READER& reader )
+{
+	const auto value = getVarint( reader );
+	return static_cast<int64_t>( value >> 1 ) ^ -static_cast<int64_t>( value & 1 );
+}
+
+ReplayRecorder::~ReplayRecorder( )
+{
+	if ( file )
+	{
+		flush( );
+		std::fclose( file );
+	}
+}
+
+void ReplayRecorder::putVarint( uint64_t value )
+{
+	while ( value >= 0x80 )
+	{
+		buffer.push_back( static_cast<char>( ( value & 0x7f ) | 0x80 ) );
+		value >>= 7;
+	}
+
+	buffer.push_back( static_cast<char>( value ) );
+}
+
+void ReplayRecorder::putSigned( int64_t value )
+{
+	putVarint( ( static_cast<uint64_t>( value ) << 1 ) ^ static_cast<uint64_t>( value >> 63 ) );
+}
+
+void ReplayRecorder::put32( uint32_t value )
+{
+	for ( int i = 0; i < 4; i++ )
+		buffer.push_back( static_cast<char>( value >> ( i * 8 ) ) );
+}
+
+void ReplayRecorder::flush( )
+{
+	if ( buffer.empty( ) )
+		return;
+
+	std::fwrite( buffer.data( ), 1, buffer.size( ), file );
+	std::fflush( file );
+
+	buffer.clear( );
+}
+
+bool ReplayRecorder::open( const std::string& path, const GameSettings& settings, uint32_t seed, int check_interval )
+{
+	if ( file )
+		return false;
+
+	file = std::fopen( path.c_str( ), "wb" );
+	if ( !file )
+		return false;
+
+	this->check_interval = check_interval;
+	last_tick = 0;
+
+	buffer.reserve( replay_buffer_size );
+	buffer.insert( buffer.end( ), replay_magic, replay_magic + sizeof( replay_magic ) );
+	buffer.push_back( static_cast<char>( replay_version ) );
+
+	put32( seed );
+	putSigned( settings.num_roads );
+	putSigned( settings.num_columns );
+	putSigned( settings.init_car_number );
+	putSigned( settings.tick_ms );
+	putSigned( settings.max_afk_timer );
+	putSigned( settings.parallel_roads );
+
+	uint64_t speed;
+	std::memcpy( &speed, &settings.init_car_speed, sizeof( speed ) );
+	put32( static_cast<uint32_t>( speed ) );
+	put32( static_cast<uint32_t>( speed >> 32 ) );
+
+	flush( );
+
+	return true;
+}
+
+void ReplayRecorder::record( const REPLAY_RECORD& record )
+{
+	if ( !file )
+		return;
+
+	buffer.push_back( static_cast<char>( record.event ) );
+	putVarint( record.tick - last_tick );
+
+	last_tick = record.tick;
+
+	switch ( record.event )
+	{
+	case REPLAY_ADD_PLAYER:
+	case REPLAY_REMOVE_PLAYER:
+		putSigned( record.pid );
+		break;
+	case REPLAY_MOVE_PLAYER:
+		putSigned( record.pid );
+		buffer.push_back( static_cast<char>( record.direction ) );
+		putVarint( record.seq );
+		break;
+	case REPLAY_PLACE_ROCK:
+		putSigned( record.x );
+		putSigned( record.y );
+		break;
+	case REPLAY_INVERT:
+		putSigned( record.road );
+		break;
+	case REPLAY_FREEZE:
+		putSigned( record.road );
+		buffer.push_back( static_cast<char>( record.frozen ) );
+		break;
+	case REPLAY_RESTART:
+		// the engine starts counting again
+		//
+		last_tick = 0;
+		break;
+	case REPLAY_CHECK:
+		put32( record.hash );
+		break;
+	case REPLAY_END:
+		break;
+	}
+
+	if ( record.event == REPLAY_CHECK || buffer.size( ) >= replay_buffer_size )
+		flush( );
+}
+
+void ReplayRecorder::close( uint64_t tick )
+{
+	if ( !file )
+		return;
+
+	REPLAY_RECORD end { REPLAY_END, tick };
+	record( end );
+
+	flush( );
+	std::fclose( file );
+
+	file = nullptr;
+}
+
+bool loadReplay( const std::string& path, REPLAY_LOG& log )
+{
+	auto file = std::fopen( path.c_str( ), "rb" );
+	if ( !file )
+		return false;
+
+	std::vector<char> data;
+
+	char chunk[ 0x10000 ];
+	size_t read;
+	while ( ( read = std::fread( chunk, 1, sizeof( chunk ), file ) ) > 0 )
+		data.insert( data.end( ), chunk, chunk + read );
+
+	std::fclose( file );
+
+	REPLAY_READER reader { data.data( ), data.size( ), 0, true };
+
+	if ( data.size( ) < sizeof( replay_magic ) || std::memcmp( data.data( ), replay_magic, sizeof( replay_magic ) ) )
+		return false;
+
+	reader.offset = sizeof( replay_magic );
+	if ( get8( reader ) != replay_version )
+		return false;
+
+	log.seed = get32( reader );
+	log.settings.num_roads = static_cast<int>( getSigned( reader ) );
+	log.settings.num_columns = static_cast<int>( getSigned( reader ) );
+	log.settings.init_car_number = static_cast<int>( getSigned( reader ) );
+	log.settings.tick_ms = static_cast<int>( getSigned( reader ) );
+	log.settings.max_afk_timer = static_cast<int>( getSigned( reader ) );
+	log.settings.parallel_roads = static_cast<int>( getSigned( reader ) );
+
+	uint64_t speed = get32( reader );
+	speed |= static_cast<uint64_t>( get32( reader ) ) << 32;
+	std::memcpy( &log.settings.init_car_speed, &speed, sizeof( speed ) );
+
+	if ( !reader.ok )
+		return false;
+
+	log.records.clear( );
+	log.complete = false;
+
+	// a record the file ends in the middle of is dropped, everything before it still replays
+	//
+	uint64_t tick = 0;
+	while ( reader.offset < reader.size && !log.complete )
+	{
+		REPLAY_RECORD record { };
+		record.event = static_cast<REPLAY_EVENT>( get8( reader ) );
+		record.tick = tick + getVarint( reader );
+
+		switch ( record.event )
+		{
+		case REPLAY_ADD_PLAYER:
+		case REPLAY_REMOVE_PLAYER:
+			record.pid = static_cast<int>( getSigned( reader ) );
+			break;
+		case REPLAY_MOVE_PLAYER:
+			record.pid = static_cast<int>( getSigned( reader ) );
+			record.direction = static_cast<FACING>( get8( reader ) );
+			record.seq = static_cast<uint32_t>( getVarint( reader ) );
+			break;
+		case REPLAY_PLACE_ROCK:
+			record.x = static_cast<int>( getSigned( reader ) );
+			record.y = static_cast<int>( getSigned( reader ) );
+			break;
+		case REPLAY_INVERT:
+			record.road = static_cast<int>( getSigned( reader ) );
+			break;
+		case REPLAY_FREEZE:
+			record.road = static_cast<int>( getSigned( reader ) );
+			record.frozen = get8( reader ) != 0;
+			break;
+		case REPLAY_RESTART:
+			break;
+		case REPLAY_CHECK:
+			record.hash = get32( reader );
+			break;
+		case REPLAY_END:
+			log.complete = true;
+			break;
+		default:
+			reader.ok = false;
+			break;
+		}
+
+		if ( !reader.ok )
+			break;
+
+		tick = record.event == REPLAY_RESTART ? 0 : record.tick;
+		log.records.push_back( record );
+	}
+
+	return true;
+}
+
+REPLAY_RESULT runReplay( const REPLAY_LOG& log, WorkerPool* ppool )
+{
+	REPLAY_RESULT result { 0, 0, 0, -1 };
+
+	GameEngine engine( log.settings, Random( log.seed ) );
+	engine.setWorkerPool( ppool );
+
+	for ( const auto& record : log.records )
+	{
+		while ( engine.getTick( ) < record.tick )
+		{
+			engine.processTick( );
+			result.ticks++;
+		}
+
+		// operator commands name a road the board may not have, the server ignores those the same way
+		//
+		try
+		{
+			switch ( record.event )
+			{
+			case REPLAY_ADD_PLAYER:
+				engine.addPlayer( record.pid );
+				break;
+			case REPLAY_REMOVE_PLAYER:
+				engine.removePlayer( record.pid );
+				break;
+			case REPLAY_MOVE_PLAYER:
+				engine.movePlayer( record.pid, record.direction, record.seq );
+				break;
+			case REPLAY_PLACE_ROCK:
+				engine.placeRock( record.x, record.y );
+				break;
+			case REPLAY_INVERT:
+				if ( record.road < 0 )
+					engine.invert( );
+				else
+					engine.invert( record.road );
+				break;
+			case REPLAY_FREEZE:
+				if ( record.road < 0 )
+					engine.setFrozen( record.frozen );
+				else
+					engine.setFrozen( record.frozen, record.road );
+				break;
+			case REPLAY_RESTART:
+				engine.restart( );
+				break;
+			case REPLAY_CHECK:
+				if ( engine.getStateHash( ) != record.hash )
+				{
+					result.desync_tick = static_cast<int64_t>( record.tick );
+					return result;
+				}
+
+				result.checks++;
+				continue;
+			case REPLAY_END:
+				return result;
+			}
+		}
+		catch ( const std::exception& )
+		{
+
+		}
+
+		result.events++;
+	}
+
+	return result;
+}
\ No newline at end of file
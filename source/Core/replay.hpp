@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "settings.hpp"
+#include "workers.hpp"
+#include "entity/types.hpp"
+
+// a game is its seed, its settings and what was done to it at which tick, replaying that reproduces every tick
+// (the order the transport threads queued inputs in is gone by then, the log has them in the order the tick took them)
+//
+enum REPLAY_EVENT : uint8_t
+{
+	REPLAY_ADD_PLAYER,
+	REPLAY_REMOVE_PLAYER,
+	REPLAY_MOVE_PLAYER,
+	REPLAY_PLACE_ROCK,
+	REPLAY_INVERT,
+	REPLAY_FREEZE,
+	REPLAY_RESTART,
+	REPLAY_CHECK,		// hash of the entities after tick, what the replay has to arrive at
+	REPLAY_END
+};
+
+// tick is the one the engine was at: an event was applied before stepping it, a check was taken once it was reached
+//
+typedef struct
+{
+	REPLAY_EVENT event;
+	uint64_t tick;
+	int pid = 0;
+	FACING direction = UP;
+	uint32_t seq = 0;
+	int x = 0, y = 0;
+	int road = -1;		// of an invert or freeze, -1 = every road
+	bool frozen = false;
+	uint32_t hash = 0;	// of a check
+} REPLAY_RECORD;
+
+typedef struct
+{
+	GameSettings settings;
+	uint32_t seed;
+	std::vector<REPLAY_RECORD> records;
+	bool complete;		// ends with REPLAY_END, otherwise the recording was cut short (the server died)
+} REPLAY_LOG;
+
+typedef struct
+{
+	uint64_t ticks;			// stepped, across restarts
+	uint64_t events;		// inputs and operator commands applied
+	uint64_t checks;		// hashes that matched
+	int64_t desync_tick;	// of the first hash that didn't match, -1 if none did
+} REPLAY_RESULT;
+
+// writes the log of one engine, from the tick it was created at
+// every record is a byte for the event, the ticks since the previous record and its fields, as little endian varints
+//
+class ReplayRecorder
+{
+private:
+	std::FILE* file = nullptr;
+	std::vector<char> buffer;
+
+	uint64_t last_tick = 0;
+	int check_interval = 0;
+
+	void putVarint( uint64_t value );
+
+	void putSigned( int64_t value );
+
+	void put32( uint32_t value );
+
+	void flush( );
+
+public:
+	ReplayRecorder( )
+	{
+
+	}
+
+	~ReplayRecorder( );
+
+	ReplayRecorder( const ReplayRecorder& ) = delete;
+	ReplayRecorder& operator=( const ReplayRecorder& ) = delete;
+
+	// a hash of the entities is logged every check_interval ticks, 0 = never
+	//
+	bool open( const std::string& path, const GameSettings& settings, uint32_t seed, int check_interval );
+
+	bool isCheckDue( uint64_t tick )
+	{
+		return check_interval > 0 && tick % check_interval == 0;
+	}
+
+	void record( const REPLAY_RECORD& record );
+
+	// writes REPLAY_END and closes the file
+	//
+	void close( uint64_t tick );
+};
+
+// false if the file can't be read or isn't a replay, a log cut short keeps every record before the cut
+//
+bool loadReplay( const std::string& path, REPLAY_LOG& log );
+
+// runs the log on a new engine as fast as it goes, stops at the first check that doesn't match
+// ppool steps large boards in parallel, the result has to be the same as without it
+//
+REPLAY_RESULT runReplay( const REPLAY_LOG& log, WorkerPool* ppool = nullptr );
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "entity/car.hpp"
+#include "entity/store.hpp"
+#include "entity/obstacle.hpp"
+
+#include <vector>
+
+class Road {
+public:
+	Road() {
+
+	}
+
+	Road(int size, Grid* grid) : entities(grid) {
+		this->size = size;
+	}
+
+	// empty road on grid, for a road that comes back from a Pool. the entity arrays keep their capacity
+	//
+	void reset(int size, Grid* grid) {
+		this->size = size;
+		entities.reset(grid);
+	}
+
+	bool processTick(int tick_ms)
+	{
+		return entities.processTick(tick_ms);
+	}
+
+	void invert() {
+		entities.invert();
+	}
+
+	void setFrozen(bool frozen) {
+		entities.setMoving(!frozen);
+	}
+
+	Car addCar(int x, int y, FACING facing_direction, double speed) {
+		return Car(&entities, entities.add(ENTITY_TYPE_CAR, x, y, facing_direction, speed, true));
+	}
+
+	Obstacle addObstacle(int x, int y) {
+		return Obstacle(&entities, entities.add(ENTITY_TYPE_OBSTACLE, x, y, UP, 0, false));
+	}
+
+	EntityStore& getEntities() {
+		return entities;
+	}
+private:
+	int size = 0;
+
+	EntityStore entities;
+};
\ No newline at end of file
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+
+#include "clock.hpp"
+
+typedef struct
+{
+	uint64_t ticks;				// simulation steps executed
+	uint64_t overruns;			// steps that took longer than the tick period
+	uint64_t catch_up_steps;	// extra steps run to recover from a stall
+	uint64_t dropped_steps;		// steps skipped because the stall exceeded max_substeps
+	double last_tick_ms, avg_tick_ms, max_tick_ms;
+} TICK_STATS;
+
+// fixed timestep loop driven by a monotonic clock
+// wall time is accumulated and consumed in tick_ms steps, so the simulation rate doesn't depend on the step cost
+//
+class TickScheduler
+{
+private:
+	Clock& clock;
+
+	std::chrono::nanoseconds tick_period;
+	int max_substeps = 5;
+
+	bool stopped = false;
+	bool suspended = false;
+
+	TICK_STATS stats { };
+
+	std::mutex mutex;
+	std::condition_variable cv;
+
+public:
+	TickScheduler( int tick_ms, Clock& clock = SteadyClock::instance( ), int max_substeps = 5 ) :
+		clock( clock ), tick_period( std::chrono::milliseconds( tick_ms ) ), max_substeps( max_substeps )
+	{
+
+	}
+
+	// blocks until stop( ) is called, returns immediately if it already was
+	//
+	void run( std::function<void( )> step )
+	{
+		std::unique_lock<std::mutex> lock( mutex );
+
+		auto previous = clock.now( );
+		std::chrono::nanoseconds accumulator { 0 };
+
+		while ( !stopped )
+		{
+			if ( suspended )
+			{
+				cv.wait( lock, [ this ] ( ) { return !suspended || stopped; } );
+
+				// time spent suspended is not simulated
+				//
+				previous = clock.now( );
+				accumulator = std::chrono::nanoseconds { 0 };
+				continue;
+			}
+
+			const auto now = clock.now( );
+			accumulator += now - previous;
+			previous = now;
+
+			int substeps = 0;
+			while ( accumulator >= tick_period && substeps < max_substeps && !stopped && !suspended )
+			{
+				lock.unlock( );
+
+				const auto start = clock.now( );
+				step( );
+				const auto duration = clock.now( ) - start;
+
+				lock.lock( );
+
+				onStep( duration, substeps > 0 );
+
+				accumulator -= tick_period;
+				substeps++;
+			}
+
+			// bound the catch up, anything past max_substeps is dropped instead of spiraling
+			//
+			if ( accumulator >= tick_period )
+			{
+				stats.dropped_steps += accumulator / tick_period;
+				accumulator %= tick_period;
+			}
+
+			cv.wait_for( lock, previous + ( tick_period - accumulator ) - clock.now( ), [ this ] ( )
+				{
+					return stopped || suspended;
+				} );
+		}
+	}
+
+	void stop( )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+
+		stopped = true;
+		cv.notify_all( );
+	}
+
+	void suspend( )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+
+		suspended = true;
+		cv.notify_all( );
+	}
+
+	void resume( )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+
+		suspended = false;
+		cv.notify_all( );
+	}
+
+	bool isSuspended( )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+
+		return suspended;
+	}
+
+	TICK_STATS getStats( )
+	{
+		std::lock_guard<std::mutex> lock( mutex );
+
+		return stats;
+	}
+
+private:
+	void onStep( std::chrono::nanoseconds duration, bool catch_up )
+	{
+		const auto duration_ms = std::chrono::duration<double, std::milli>( duration ).count( );
+
+		stats.ticks++;
+		stats.last_tick_ms = duration_ms;
+		stats.max_tick_ms = std::max( stats.max_tick_ms, duration_ms );
+		stats.avg_tick_ms += ( duration_ms - stats.avg_tick_ms ) / static_cast<double>( stats.ticks );
+
+		if ( duration > tick_period )
+			stats.overruns++;
+
+		if ( catch_up )
+			stats.catch_up_steps++;
+	}
+};
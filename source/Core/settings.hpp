@@ -0,0 +1,19 @@
+#pragma once
+
+// game rules the simulation depends on
+// the server fills this from its own (registry backed) settings, headless runs build it directly
+//
+struct GameSettings
+{
+	int num_roads = 5;
+	int num_columns = 20;
+	double init_car_speed = 1.0f;
+	int init_car_number = 2;
+	int tick_ms = 15;
+	int max_afk_timer = 10000;
+
+	// roads a board needs before its tick is split across the worker pool (if the engine was given one), 0 = never
+	// a road is a few cars, on a small board waking the pool costs more than the roads themselves
+	//
+	int parallel_roads = 16;
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <cstddef>
+#include <cstdint>
+
+// lock free publication of a value from one writer thread to any number of readers
+// the writer fills a slot nobody is reading and never waits on the readers, a reader pins the latest published slot
+// while it copies it and never waits on the writer (it moves on to the newer slot if the writer got there first).
+// values may own memory (a snapshot holds as many entities as the board has): a slot is only rewritten once nobody
+// reads it, and assigning keeps the capacity of the slots and of the copies, so a steady stream doesn't allocate
+//
+template <typename T, size_t N = 4>
+class SnapshotBuffer
+{
+	static_assert( N >= 3 && N <= 256, "the writer needs a slot besides the published one and the one being read" );
+
+private:
+	// bit 0 = the writer is inside the slot, the rest counts the readers copying it (in steps of 2)
+	// version is the one of the value the slot holds, 0 while it holds none
+	//
+	struct alignas( 64 ) SLOT
+	{
+		std::atomic<uint32_t> state { 0 };
+		uint64_t version = 0;
+		T value { };
+	};
+
+	SLOT slots[ N ];
+
+	// version << 8 | slot of the latest value
+	//
+	std::atomic<uint64_t> published { 0 };
+
+	size_t writing = 0;
+
+public:
+	// writer side, begin( ) hands out the slot to fill and publish( ) makes it the latest
+	// cancel( ) drops it, readers keep getting the previous value
+	//
+	T& begin( )
+	{
+		const auto current = published.load( std::memory_order_relaxed ) & 0xff;
+
+		// readers hold a slot for one copy, only more of them than there are slots can make the writer go around again
+		//
+		while ( true )
+		{
+			for ( size_t i = 1; i < N; i++ )
+			{
+				auto& slot = slots[ ( current + i ) % N ];
+
+				uint32_t expected = 0;
+				if ( !slot.state.compare_exchange_strong( expected, 1, std::memory_order_acquire ) )
+					continue;
+
+				writing = ( current + i ) % N;
+				slot.version = 0;
+
+				return slot.value;
+			}
+
+			std::this_thread::yield( );
+		}
+	}
+
+	void publish( )
+	{
+		const auto version = ( published.load( std::memory_order_relaxed ) >> 8 ) + 1;
+		auto& slot = slots[ writing ];
+
+		slot.version = version;
+		slot.state.fetch_and( ~1u, std::memory_order_release );
+
+		published.store( version << 8 | writing, std::memory_order_release );
+	}
+
+	void cancel( )
+	{
+		slots[ writing ].state.fetch_and( ~1u, std::memory_order_release );
+	}
+
+	// reader side, returns false while nothing was published yet
+	//
+	bool read( T& out, uint64_t* pversion = nullptr )
+	{
+		while ( true )
+		{
+			const auto latest = published.load( std::memory_order_acquire );
+			if ( !latest )
+				return false;
+
+			auto& slot = slots[ latest & 0xff ];
+
+			// the writer took the slot since, there is a newer one
+			//
+			if ( slot.state.fetch_add( 2, std::memory_order_acquire ) & 1 )
+			{
+				slot.state.fetch_sub( 2, std::memory_order_relaxed );
+				continue;
+			}
+
+			const auto version = slot.version;
+			if ( version )
+				out = slot.value;
+
+			slot.state.fetch_sub( 2, std::memory_order_release );
+
+			if ( !version )
+				continue;
+
+			if ( pversion )
+				*pversion = version;
+
+			return true;
+		}
+	}
+
+	// number of values published so far
+	//
+	uint64_t getVersion( ) const
+	{
+		return published.load( std::memory_order_acquire ) >> 8;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <condition_variable>
+
+// fixed set of threads running the iterations of a parallel loop, with work stealing
+// every thread starts on a contiguous range of the iterations (neighbours stay on one core), one that runs out takes
+// half of what is left of another, so a slow iteration doesn't hold back the ones queued behind it.
+// the calling thread works along and run( ) returns once every iteration is done. a run started from inside
+// another one (or while another thread runs one) is done serially by its caller, so nested loops can share a pool
+//
+class WorkerPool
+{
+private:
+	// [ begin, end ) packed in one word, the owner takes from the front and thieves from the back
+	//
+	struct alignas( 64 ) RANGE
+	{
+		std::atomic<uint64_t> bounds { 0 };
+	};
+
+	inline static thread_local bool inside = false;
+
+	std::vector<std::thread> threads;
+	std::unique_ptr<RANGE[ ]> ranges;
+
+	std::mutex run_mutex;
+
+	std::mutex mutex;
+	std::condition_variable cv_start, cv_done;
+
+	// the loop being run, published to the workers under the mutex
+	//
+	const std::function<void( size_t )>* pjob = nullptr;
+	uint64_t generation = 0;
+	size_t busy = 0;
+	bool stopped = false;
+
+	std::atomic<uint64_t> stolen { 0 };
+
+public:
+	// num_threads counts the caller of run( ) as well, 0 = one per core
+	//
+	WorkerPool( int num_threads = 0 )
+	{
+		if ( num_threads <= 0 )
+			num_threads = static_cast<int>( std::thread::hardware_concurrency( ) );
+
+		num_threads = num_threads > 1 ? num_threads : 1;
+		ranges = std::make_unique<RANGE[ ]>( num_threads );
+
+		for ( int i = 1; i < num_threads; i++ )
+			threads.emplace_back( workerRoutine, this, static_cast<size_t>( i ) );
+	}
+
+	~WorkerPool( )
+	{
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+			stopped = true;
+		}
+
+		cv_start.notify_all( );
+
+		for ( auto& thread : threads )
+			thread.join( );
+	}
+
+	WorkerPool( const WorkerPool& ) = delete;
+	WorkerPool& operator=( const WorkerPool& ) = delete;
+
+	int getThreadCount( ) const
+	{
+		return static_cast<int>( threads.size( ) ) + 1;
+	}
+
+	// ranges taken from another thread so far
+	//
+	uint64_t getSteals( ) const
+	{
+		return stolen.load( std::memory_order_relaxed );
+	}
+
+	// calls job( i ) for every i in [ 0, count ), from any of the threads
+	//
+	void run( size_t count, const std::function<void( size_t )>& job )
+	{
+		if ( threads.empty( ) || count < 2 || inside || !run_mutex.try_lock( ) )
+		{
+			for ( size_t i = 0; i < count; i++ )
+				job( i );
+
+			return;
+		}
+
+		std::lock_guard<std::mutex> run_lock( run_mutex, std::adopt_lock );
+
+		const auto participants = threads.size( ) + 1;
+		for ( size_t i = 0; i < participants; i++ )
+			ranges[ i ].bounds.store( pack( count * i / participants, count * ( i + 1 ) / participants ), std::memory_order_relaxed );
+
+		{
+			std::lock_guard<std::mutex> lock( mutex );
+
+			pjob = &job;
+			busy = threads.size( );
+			generation++;
+		}
+
+		cv_start.notify_all( );
+
+		inside = true;
+		work( job, 0 );
+		inside = false;
+
+		std::unique_lock<std::mutex> lock( mutex );
+		cv_done.wait( lock, [ this ] ( ) { return !busy; } );
+
+		pjob = nullptr;
+	}
+
+private:
+	static uint64_t pack( size_t begin, size_t end )
+	{
+		return static_cast<uint64_t>( begin ) << 32 | static_cast<uint32_t>( end );
+	}
+
+	void work( const std::function<void( size_t )>& job, size_t self )
+	{
+		while ( true )
+		{
+			size_t index;
+			if ( pop( self, index ) )
+			{
+				job( index );
+				continue;
+			}
+
+			if ( !steal( self ) )
+				return;
+		}
+	}
+
+	bool pop( size_t self, size_t& index )
+	{
+		auto& bounds = ranges[ self ].bounds;
+
+		auto current = bounds.load( std::memory_order_acquire );
+		while ( true )
+		{
+			const auto begin = current >> 32, end = current & 0xffffffff;
+			if ( begin >= end )
+				return false;
+
+			if ( bounds.compare_exchange_weak( current, pack( begin + 1, end ), std::memory_order_acq_rel ) )
+			{
+				index = begin;
+				return true;
+			}
+		}
+	}
+
+	// the word is the whole state of a range, a CAS that goes through takes iterations that are still in it
+	//
+	bool steal( size_t self )
+	{
+		const auto participants = threads.size( ) + 1;
+		for ( size_t i = 1; i < participants; i++ )
+		{
+			auto& bounds = ranges[ ( self + i ) % participants ].bounds;
+
+			auto current = bounds.load( std::memory_order_acquire );
+			while ( true )
+			{
+				const auto begin = current >> 32, end = current & 0xffffffff;
+				if ( begin >= end )
+					break;
+
+				const auto take = ( end - begin + 1 ) / 2;
+				if ( bounds.compare_exchange_weak( current, pack( begin, end - take ), std::memory_order_acq_rel ) )
+				{
+					ranges[ self ].bounds.store( pack( end - take, end ), std::memory_order_release );
+					stolen.fetch_add( 1, std::memory_order_relaxed );
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	static void workerRoutine( WorkerPool* _this, size_t self )
+	{
+		inside = true;
+
+		uint64_t seen = 0;
+
+		std::unique_lock<std::mutex> lock( _this->mutex );
+		while ( true )
+		{
+			_this->cv_start.wait( lock, [ _this, seen ] ( ) { return _this->stopped || _this->generation != seen; } );
+			if ( _this->stopped )
+				return;
+
+			seen = _this->generation;
+
+			const auto job = _this->pjob;
+
+			lock.unlock( );
+			_this->work( *job, self );
+			lock.lock( );
+
+			if ( !--_this->busy )
+				_this->cv_done.notify_one( );
+		}
+	}
+};
\ No newline at end of file
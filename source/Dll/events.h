@@ -2,6 +2,12 @@
 
 #include <functional>
 
+#ifdef _WIN32
+#define DLL_EXPORT  __declspec( dllexport )
+#else
+#define DLL_EXPORT  __attribute__( ( visibility( "default" ) ) )
+#endif
+
 enum EVENT_TYPE
 {
     EVENT_GAME_UPDATE,
@@ -14,9 +20,9 @@ using EventCallback = std::function<void( void* ptr_data )>;
 
 extern "C"
 {
-    __declspec( dllexport ) bool registerEvent( EVENT_TYPE type, EventCallback callback );
+    DLL_EXPORT bool registerEvent( EVENT_TYPE type, EventCallback callback );
 
-    __declspec( dllexport ) void unregisterEvent( EVENT_TYPE type );
+    DLL_EXPORT void unregisterEvent( EVENT_TYPE type );
 }
 
 bool triggerEvent( EVENT_TYPE type, void* ptr_data );
\ No newline at end of file
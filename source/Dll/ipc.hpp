@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// os services the shared memory channel is built on
+// every backend provides, in namespace ipc:
+//
+//  Section  - named shared memory, open( name, size ) creates it or maps the existing one (only the latter with
+//             create = false), the owner( ) of a section removes its name when it closes it
+//  Waiter   - what an instance sleeps on, other processes wake it through its pid and the wake word in its slot
+//  Waker    - wakes other instances, caching whatever handles that takes
+//  isAlive  - whether a pid still belongs to a running process
+//  currentPid, pause
+//
+namespace ipc
+{
+    enum WAIT_RESULT
+    {
+        WAIT_WOKEN,
+        WAIT_INTERRUPTED,
+        WAIT_FAILED
+    };
+
+    // the shared section is accessed from several processes, so everything shared goes through these
+    //
+    template <typename T>
+    inline T load( T& value )
+    {
+        return std::atomic_ref<T>( value ).load( std::memory_order_acquire );
+    }
+
+    template <typename T>
+    inline void store( T& value, T desired )
+    {
+        std::atomic_ref<T>( value ).store( desired, std::memory_order_release );
+    }
+
+    template <typename T>
+    inline T fetchAdd( T& value, T delta )
+    {
+        return std::atomic_ref<T>( value ).fetch_add( delta, std::memory_order_acq_rel );
+    }
+
+    // returns the value found, the swap happened if it equals expected
+    //
+    template <typename T>
+    inline T compareExchange( T& value, T expected, T desired )
+    {
+        std::atomic_ref<T>( value ).compare_exchange_strong( expected, desired, std::memory_order_acq_rel );
+        return expected;
+    }
+}
+
+#ifdef _WIN32
+#include "ipc_win32.hpp"
+#else
+#include "ipc_posix.hpp"
+#endif
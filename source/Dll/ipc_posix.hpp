@@ -0,0 +1,214 @@
+#pragma once
+
+#include <cstdio>
+#include <cerrno>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#ifndef TEXT
+#define TEXT( text ) text
+#endif
+
+// stand-in for the Win32 console module
+//
+namespace console
+{
+    template <typename... T>
+    inline void log( T... args )
+    {
+        ( std::clog << ... << args ) << std::endl;
+    }
+
+    template <typename... T>
+    inline void error( T... args )
+    {
+        ( std::cerr << ... << args ) << std::endl;
+    }
+}
+
+// POSIX backend: shm_open + mmap, and a futex on the wake word of each instance slot
+// the futexes are process shared (no FUTEX_PRIVATE_FLAG), they live in the mapping
+//
+namespace ipc
+{
+    inline uint32_t currentPid( )
+    {
+        return static_cast<uint32_t>( getpid( ) );
+    }
+
+    inline void pause( )
+    {
+#if defined( __x86_64__ ) || defined( __i386__ )
+        __builtin_ia32_pause( );
+#endif
+    }
+
+    inline bool isAlive( uint32_t pid )
+    {
+        return kill( static_cast<pid_t>( pid ), 0 ) == 0 || errno == EPERM;
+    }
+
+    inline long futex( uint32_t* ptr_word, int operation, uint32_t value )
+    {
+        return syscall( SYS_futex, ptr_word, operation, value, nullptr, nullptr, 0 );
+    }
+
+    class Section
+    {
+    private:
+        char name[ 256 ] { };
+        void* ptr_data = nullptr;
+        size_t size = 0;
+        bool created = false;
+        bool owned = false;
+
+    public:
+        ~Section( )
+        {
+            close( );
+        }
+
+        // a reader passes create = false, a name it finds gone was removed by its owner and must not come back empty
+        //
+        bool open( const char* section_name, size_t size, bool create = true )
+        {
+            std::snprintf( name, sizeof( name ), "/%s", section_name );
+
+            int fd = create ? shm_open( name, O_RDWR | O_CREAT | O_EXCL, 0600 ) : -1;
+            created = fd != -1;
+            if ( !created )
+                fd = shm_open( name, O_RDWR, 0600 );
+
+            if ( fd == -1 )
+                return false;
+
+            // both sides size it, so a joiner never maps a section the creator didn't grow yet
+            //
+            if ( ftruncate( fd, static_cast<off_t>( size ) ) == -1 )
+            {
+                ::close( fd );
+                return false;
+            }
+
+            ptr_data = mmap( nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0 );
+            ::close( fd );
+
+            if ( ptr_data == MAP_FAILED )
+            {
+                ptr_data = nullptr;
+                return false;
+            }
+
+            this->size = size;
+            return true;
+        }
+
+        // the owner removes the name, instances still mapping it keep working
+        //
+        void close( )
+        {
+            if ( ptr_data )
+                munmap( ptr_data, size );
+
+            if ( ptr_data && owned )
+                shm_unlink( name );
+
+            ptr_data = nullptr;
+            owned = false;
+        }
+
+        // the one that publishes the section, whether it created the name or found it left behind
+        //
+        void own( )
+        {
+            owned = true;
+        }
+
+        bool isCreator( )
+        {
+            return created;
+        }
+
+        void* data( )
+        {
+            return ptr_data;
+        }
+    };
+
+    class Waiter
+    {
+    private:
+        uint32_t* ptr_word = nullptr;
+        uint32_t seen = 0;
+        bool interrupted = false;
+
+    public:
+        bool open( uint32_t pid, uint32_t* ptr_word )
+        {
+            this->ptr_word = ptr_word;
+            seen = load( *ptr_word );
+            return true;
+        }
+
+        void close( )
+        {
+            ptr_word = nullptr;
+        }
+
+        // returns as soon as the word moved since the last wake up, so a burst collapses into one
+        //
+        WAIT_RESULT wait( )
+        {
+            while ( true )
+            {
+                if ( load( interrupted ) )
+                    return WAIT_INTERRUPTED;
+
+                const auto current = load( *ptr_word );
+                if ( current != seen )
+                {
+                    seen = current;
+                    return WAIT_WOKEN;
+                }
+
+                if ( futex( ptr_word, FUTEX_WAIT, current ) == -1 && errno != EAGAIN && errno != EINTR )
+                {
+                    console::error( "futex wait failed: ", errno );
+                    return WAIT_FAILED;
+                }
+            }
+        }
+
+        void interrupt( )
+        {
+            store( interrupted, true );
+            fetchAdd( *ptr_word, 1u );
+            futex( ptr_word, FUTEX_WAKE, INT32_MAX );
+        }
+    };
+
+    template <size_t N>
+    class Waker
+    {
+    public:
+        // false if the process behind the slot is gone
+        //
+        // liveness is only checked when nobody was sleeping on the word, a running instance costs one syscall
+        //
+        bool wake( size_t index, uint32_t pid, uint32_t* ptr_word )
+        {
+            fetchAdd( *ptr_word, 1u );
+
+            return futex( ptr_word, FUTEX_WAKE, 1 ) > 0 || isAlive( pid );
+        }
+    };
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+
+import console;
+
+// Win32 backend: file mapping backed by the paging file, and a named auto reset event per instance
+//
+namespace ipc
+{
+    inline constexpr auto wake_event_format = TEXT( "Local\\CRR_SMEM_WAKE_EVENT_%lu" );
+
+    inline uint32_t currentPid( )
+    {
+        return GetCurrentProcessId( );
+    }
+
+    inline void pause( )
+    {
+        YieldProcessor( );
+    }
+
+    inline bool isAlive( uint32_t pid )
+    {
+        const auto h_process = OpenProcess( SYNCHRONIZE, false, pid );
+        if ( !h_process )
+            return GetLastError( ) == ERROR_ACCESS_DENIED;
+
+        const bool alive = WaitForSingleObject( h_process, 0 ) == WAIT_TIMEOUT;
+        CloseHandle( h_process );
+
+        return alive;
+    }
+
+    class Section
+    {
+    private:
+        HANDLE h_section = nullptr;
+        void* ptr_data = nullptr;
+        bool created = false;
+
+    public:
+        ~Section( )
+        {
+            close( );
+        }
+
+        bool open( const char* name, size_t size, bool create = true )
+        {
+            char section_name[ MAX_PATH ];
+            std::snprintf( section_name, sizeof( section_name ), "Local\\%s", name );
+
+            if ( create )
+                h_section = CreateFileMappingA( INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>( size ), section_name );
+            else
+                h_section = OpenFileMappingA( FILE_MAP_ALL_ACCESS, false, section_name );
+
+            if ( !h_section )
+                return false;
+
+            created = create && GetLastError( ) != ERROR_ALREADY_EXISTS;
+
+            ptr_data = MapViewOfFile( h_section, FILE_MAP_ALL_ACCESS, 0, 0, size );
+            if ( !ptr_data )
+            {
+                CloseHandle( h_section );
+                h_section = nullptr;
+                return false;
+            }
+
+            return true;
+        }
+
+        void close( )
+        {
+            if ( ptr_data )
+                UnmapViewOfFile( ptr_data );
+
+            if ( h_section )
+                CloseHandle( h_section );
+
+            ptr_data = nullptr;
+            h_section = nullptr;
+        }
+
+        bool isCreator( )
+        {
+            return created;
+        }
+
+        // a mapping goes away with its last handle, there is no name to remove
+        //
+        void own( )
+        {
+
+        }
+
+        void* data( )
+        {
+            return ptr_data;
+        }
+    };
+
+    class Waiter
+    {
+    private:
+        HANDLE h_wake_event = nullptr;
+        HANDLE h_interrupt_event = nullptr;
+
+    public:
+        ~Waiter( )
+        {
+            close( );
+        }
+
+        // auto reset, a burst of wake ups collapses into one
+        //
+        bool open( uint32_t pid, uint32_t* ptr_word )
+        {
+            TCHAR wake_event[ MAX_PATH ];
+            wsprintf( wake_event, wake_event_format, static_cast<DWORD>( pid ) );
+
+            h_wake_event = CreateEvent( nullptr, false, false, wake_event );
+            if ( !h_wake_event )
+                return false;
+
+            h_interrupt_event = CreateEvent( nullptr, true, false, nullptr );
+            if ( !h_interrupt_event )
+            {
+                CloseHandle( h_wake_event );
+                h_wake_event = nullptr;
+                return false;
+            }
+
+            return true;
+        }
+
+        void close( )
+        {
+            if ( h_interrupt_event )
+                CloseHandle( h_interrupt_event );
+
+            if ( h_wake_event )
+                CloseHandle( h_wake_event );
+
+            h_interrupt_event = nullptr;
+            h_wake_event = nullptr;
+        }
+
+        WAIT_RESULT wait( )
+        {
+            const HANDLE handles[ ] = { h_interrupt_event, h_wake_event };
+
+            switch ( WaitForMultipleObjectsEx( 2, handles, false, INFINITE, false ) )
+            {
+            case WAIT_OBJECT_0:
+                return WAIT_INTERRUPTED;
+            case WAIT_OBJECT_0 + 1:
+                return WAIT_WOKEN;
+            default:
+                console::error( TEXT( "WaitForMultipleObjectsEx failed: " ), GetLastError( ) );
+                return WAIT_FAILED;
+            }
+        }
+
+        void interrupt( )
+        {
+            if ( h_interrupt_event )
+                SetEvent( h_interrupt_event );
+        }
+    };
+
+    template <size_t N>
+    class Waker
+    {
+    private:
+        uint32_t pids[ N ] { };
+        HANDLE h_events[ N ] { };
+
+    public:
+        ~Waker( )
+        {
+            for ( auto h_event : h_events )
+                if ( h_event )
+                    CloseHandle( h_event );
+        }
+
+        // false if the process behind the slot is gone
+        //
+        bool wake( size_t index, uint32_t pid, uint32_t* ptr_word )
+        {
+            if ( pid != pids[ index ] )
+            {
+                if ( h_events[ index ] )
+                    CloseHandle( h_events[ index ] );
+
+                TCHAR wake_event[ MAX_PATH ];
+                wsprintf( wake_event, wake_event_format, static_cast<DWORD>( pid ) );
+
+                pids[ index ] = pid;
+                h_events[ index ] = OpenEvent( EVENT_MODIFY_STATE, false, wake_event );
+            }
+
+            return h_events[ index ] && SetEvent( h_events[ index ] );
+        }
+    };
+}
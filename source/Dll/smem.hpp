@@ -1,14 +1,30 @@
 #pragma once
 
-#include <Windows.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
 #include <functional>
 
+#include "ipc.hpp"
 #include "events.h"
 
-import console;
+#define MAX_FRAMES      8
+#define MAX_INSTANCES   10
 
-#define MAX_COMMANDS    10
-#define MAX_ENTITIES    160  // 10 - 2 = 8, 8 * 20 = 160
+// entities a frame has room for in the first frames section, a larger board moves the frames to a larger one
+//
+#define FRAME_ENTITIES  256
+
+// commands each instance can have queued, power of two
+// every process mapping the section has to be built with the same value
+//
+#ifndef COMMAND_QUEUE_DEPTH
+#define COMMAND_QUEUE_DEPTH     64
+#endif
 
 enum COMMAND_TYPE
 {
@@ -90,437 +106,622 @@ enum GAME_STATE
     GAME_STATE_MAX
 };
 
+// a frame as the channel hands it over, entities points to num_entities of them
+// the memory belongs to whoever filled the DATA (for a handler, it is valid until the handler returns)
+//
 typedef struct
 {
     GAME_STATE state;
     int time, level;
     int width, height;
     int num_entities;
-    ENTITY entities[ MAX_ENTITIES ];
+    ENTITY* entities;
 } DATA;
 
 using DataHandler = std::function<void( DATA data )>;
 
+// one slot of the frame ring, sequence is odd while the writer is inside it
+// its num_entities entities follow it, every slot has room for as many as the frames section was made for
+// version is the write index the frame was published at, a slot of a section that was just mapped may not have it yet
+//
+typedef struct
+{
+    int32_t sequence;
+    GAME_STATE state;
+    int64_t version;
+    int time, level;
+    int width, height;
+    int num_entities;
+} FRAME;
+
+// a cell is free for the producer that reserved position p when sequence == p,
+// and holds a command for the consumer when sequence == p + 1
+//
+typedef struct
+{
+    int64_t sequence;
+    COMMAND command;
+} COMMAND_CELL;
+
+// bounded multi producer / single consumer queue, every instance owns one
+//
+typedef struct
+{
+    int64_t enqueue_index;
+    int64_t dequeue_index;
+    COMMAND_CELL cells[ COMMAND_QUEUE_DEPTH ];
+} COMMAND_QUEUE;
+
+// same layout on every backend, all the shared fields are accessed through ipc::load / store / compareExchange
+//
 typedef struct
 {
-    int num_instances, processed_instances;
-    DATA data;
+    // broadcast ring, written only by the server and read by every instance without locks
+    // the frames live in a section of their own ("<name>_FRAMES_<generation>", MAX_FRAMES slots of layout's capacity),
+    // a frame that doesn't fit makes the server move to the next generation, twice as large, readers follow on their next read
+    //
+    struct
+    {
+        int64_t write_index;    // frames published so far, the newest is at ( write_index - 1 ) % MAX_FRAMES
+        int64_t layout;         // generation << 32 | entities a slot has room for, 0 before the first frame
+    } frames;
+
+    // pid of the instance that answers to target 0 (the first one to map the section, the server)
+    //
+    int32_t main_pid;
+
+    // one slot per instance, pid 0 = free, -1 = being set up
+    // wake is bumped whenever the instance has something to do (the futex word on POSIX, unused on Win32)
+    //
     struct
     {
-        unsigned long read_index, write_index;
-        COMMAND commands[ MAX_COMMANDS ];
-    } commands;
+        int32_t pid;
+        uint32_t wake;
+        COMMAND_QUEUE commands;
+    } instances[ MAX_INSTANCES ];
 } SMEM;
 
+// a mapping of the frames section
+//
+typedef struct
+{
+    ipc::Section section;
+    int64_t layout = 0;
+} FRAMES;
+
 class SMem
 {
 private:
-    inline static constexpr auto update_interval        = 100;
+    inline static constexpr auto max_instances          = MAX_INSTANCES;
+    inline static constexpr auto queue_depth            = COMMAND_QUEUE_DEPTH;
+    inline static constexpr auto max_retries            = 4096;
 
-    inline static constexpr auto max_readers            = 10;
-    inline static constexpr auto max_commands           = MAX_COMMANDS;
+    static_assert( ( COMMAND_QUEUE_DEPTH & ( COMMAND_QUEUE_DEPTH - 1 ) ) == 0, "COMMAND_QUEUE_DEPTH must be a power of two" );
 
-    inline static constexpr auto identifier             = TEXT( "Local\\CRR" );
+    inline static constexpr auto identifier             = "CRR";
 
-    inline static constexpr auto updated_event          = TEXT( "Local\\CRR_SMEM_UPDATED_EVENT" );
+    // local
+    //
+    char name[ 64 ]             = { };
 
-    inline static constexpr auto mutex_data_usage       = TEXT( "Local\\CRR_SMEM_MUTEX_DATA_USAGE" );
+    bool is_main_instance              = false;
 
-    inline static constexpr auto sem_read_commands      = TEXT( "Local\\CRR_SMEM_SEM_READ_COMMANDS" );
-    inline static constexpr auto sem_write_commands     = TEXT( "Local\\CRR_SMEM_SEM_WRITE_COMMANDS" );
+    std::thread listener;
+    int status                  = -1;   // of the listener, see getStatus
 
-    inline static constexpr auto mutex_read_commands    = TEXT( "Local\\CRR_SMEM_MUTEX_READ_COMMANDS" );
-    inline static constexpr auto mutex_write_commands   = TEXT( "Local\\CRR_SMEM_MUTEX_WRITE_COMMANDS" );
+    int slot                    = -1;
+    int64_t cursor              = 0;    // last frame handed to data_handler
 
-    inline static constexpr auto mutex_instances_usage  = TEXT( "Local\\CRR_SMEM_MUTEX_INSTANCES_USAGE" );
+    ipc::Waiter waiter;
 
-    // local
+    // wakes the other instances, caches whatever the backend needs per slot
     //
-    bool is_main_instance              = false;
-
-    HANDLE h_thread             = nullptr;
+    ipc::Waker<MAX_INSTANCES> waker;
+    std::mutex mtx_instances;
 
-    CRITICAL_SECTION cs_usage { };
+    // recursive, a handler may register another one
+    //
+    std::recursive_mutex mtx_usage;
 
     DataHandler data_handler    = nullptr;
     CommandHandler cmd_handler  = nullptr;
 
-    // shared
+    // the frame handed to data_handler, only touched by the listener
     //
-    SMEM* ptr_smem                  = nullptr;
+    std::vector<ENTITY> entities;
 
-    HANDLE h_smem                   = nullptr;
-
-    HANDLE h_event                  = nullptr, h_updated_event          = nullptr;
+    // shared
+    //
+    ipc::Section section;
 
-    HANDLE h_sem_read_commands      = nullptr, h_sem_write_commands     = nullptr;
-    HANDLE h_mutex_read_commands    = nullptr, h_mutex_write_commands   = nullptr;
+    SMEM* ptr_smem                  = nullptr;
 
-    HANDLE h_mutex_data_usage       = nullptr, h_mutex_instances_usage  = nullptr;
+    // the frames section the server writes to, and the one this instance last read from (readers under mtx_frames)
+    //
+    FRAMES write_frames;
+    FRAMES read_frames;
+    std::mutex mtx_frames;
 
 public:
-    SMem( )
+    // name lets several independent channels coexist (benchmarks, tests), every instance of one channel must use the same
+    //
+    SMem( const char* name = identifier )
     {
-        h_smem = CreateFileMapping( INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof( SMEM ), identifier );
-        if ( !h_smem )
-            exit( 1 );
-
-        is_main_instance = GetLastError( ) != ERROR_ALREADY_EXISTS;
-
-        ptr_smem = reinterpret_cast<SMEM*>( MapViewOfFile( h_smem, FILE_MAP_ALL_ACCESS, 0, 0, sizeof( SMEM ) ) );
-        if ( !ptr_smem )
-        {
-            CloseHandle( h_smem );
-            exit( 1 );
-        }
+        std::snprintf( this->name, sizeof( this->name ), "%s", name );
 
-        if ( !InitializeCriticalSectionEx( &cs_usage, 200, NULL ) )
+        if ( !section.open( name, sizeof( SMEM ) ) )
         {
-            UnmapViewOfFile( ptr_smem );
-            CloseHandle( h_smem );
+            console::error( TEXT( "Could not map the shared memory" ) );
             exit( 1 );
         }
 
-        h_mutex_data_usage = CreateMutexEx( nullptr, mutex_data_usage, 0, MUTEX_ALL_ACCESS );
-        if ( !h_mutex_data_usage )
-        {
-            DeleteCriticalSection( &cs_usage );
-            UnmapViewOfFile( ptr_smem );
-            CloseHandle( h_smem );
-            exit( 1 );
-        }
+        ptr_smem = reinterpret_cast<SMEM*>( section.data( ) );
 
-        h_mutex_instances_usage = CreateMutexEx( nullptr, mutex_instances_usage, 0, MUTEX_ALL_ACCESS );
-        if ( !h_mutex_instances_usage )
-        {
-            CloseHandle( h_mutex_data_usage );
-            DeleteCriticalSection( &cs_usage );
-            UnmapViewOfFile( ptr_smem );
-            CloseHandle( h_smem );
-            exit( 1 );
-        }
-
-        h_mutex_read_commands = CreateMutexEx( nullptr, mutex_read_commands, 0, MUTEX_ALL_ACCESS );
-        if ( !h_mutex_read_commands )
+        // a section left behind by instances that are all gone (a crashed server on POSIX keeps its name) is started over
+        //
+        is_main_instance = section.isCreator( ) || isAbandoned( );
+        if ( is_main_instance )
         {
-            CloseHandle( h_mutex_instances_usage );
-            CloseHandle( h_mutex_data_usage );
-            DeleteCriticalSection( &cs_usage );
-            UnmapViewOfFile( ptr_smem );
-            CloseHandle( h_smem );
-            exit( 1 );
-        }
+            section.own( );
 
-        h_mutex_write_commands = CreateMutexEx( nullptr, mutex_write_commands, 0, MUTEX_ALL_ACCESS );
-        if ( !h_mutex_write_commands )
-        {
-            CloseHandle( h_mutex_read_commands );
-            CloseHandle( h_mutex_instances_usage );
-            CloseHandle( h_mutex_data_usage );
-            DeleteCriticalSection( &cs_usage );
-            UnmapViewOfFile( ptr_smem );
-            CloseHandle( h_smem );
-            exit( 1 );
+            memset( ptr_smem, 0, sizeof( SMEM ) );
+            ipc::store( ptr_smem->main_pid, static_cast<int32_t>( ipc::currentPid( ) ) );
         }
 
-        h_sem_read_commands = CreateSemaphoreEx( nullptr, 0, max_commands, sem_read_commands, 0, SEMAPHORE_ALL_ACCESS );
-        if ( !h_sem_read_commands )
-        {
-            CloseHandle( h_mutex_write_commands );
-            CloseHandle( h_mutex_read_commands );
-            CloseHandle( h_mutex_instances_usage );
-            CloseHandle( h_mutex_data_usage );
-            DeleteCriticalSection( &cs_usage );
-            UnmapViewOfFile( ptr_smem );
-            CloseHandle( h_smem );
+        if ( !claimSlot( ) )
             exit( 1 );
-        }
 
-        h_sem_write_commands = CreateSemaphoreEx( nullptr, max_commands, max_commands, sem_write_commands, 0, SEMAPHORE_ALL_ACCESS );
-        if ( !h_sem_write_commands )
+        if ( !waiter.open( ipc::currentPid( ), &ptr_smem->instances[ slot ].wake ) )
         {
-            CloseHandle( h_sem_read_commands );
-            CloseHandle( h_mutex_write_commands );
-            CloseHandle( h_mutex_read_commands );
-            CloseHandle( h_mutex_instances_usage );
-            CloseHandle( h_mutex_data_usage );
-            DeleteCriticalSection( &cs_usage );
-            UnmapViewOfFile( ptr_smem );
-            CloseHandle( h_smem );
+            ipc::store( ptr_smem->instances[ slot ].pid, 0 );
             exit( 1 );
         }
 
-        h_event = CreateEvent( nullptr, true, false, nullptr );
-        if ( !h_event )
+        try
         {
-            CloseHandle( h_sem_write_commands );
-            CloseHandle( h_sem_read_commands );
-            CloseHandle( h_mutex_write_commands );
-            CloseHandle( h_mutex_read_commands );
-            CloseHandle( h_mutex_instances_usage );
-            CloseHandle( h_mutex_data_usage );
-            DeleteCriticalSection( &cs_usage );
-            UnmapViewOfFile( ptr_smem );
-            CloseHandle( h_smem );
-            exit( 1 );
+            listener = std::thread( listenerRoutine, this );
         }
-
-        h_updated_event = CreateEvent( nullptr, true, false, updated_event );
-        if ( !h_updated_event )
+        catch ( const std::system_error& )
         {
-            CloseHandle( h_event );
-            CloseHandle( h_sem_write_commands );
-            CloseHandle( h_sem_read_commands );
-            CloseHandle( h_mutex_write_commands );
-            CloseHandle( h_mutex_read_commands );
-            CloseHandle( h_mutex_instances_usage );
-            CloseHandle( h_mutex_data_usage );
-            DeleteCriticalSection( &cs_usage );
-            UnmapViewOfFile( ptr_smem );
-            CloseHandle( h_smem );
+            ipc::store( ptr_smem->instances[ slot ].pid, 0 );
             exit( 1 );
         }
+    }
 
-        h_thread = CreateThread( nullptr, NULL, reinterpret_cast<LPTHREAD_START_ROUTINE>( listenerRoutine ), this, NULL, nullptr );
-        if ( !h_thread )
-        {
-            CloseHandle( h_updated_event );
-            CloseHandle( h_event );
-            CloseHandle( h_sem_write_commands );
-            CloseHandle( h_sem_read_commands );
-            CloseHandle( h_mutex_write_commands );
-            CloseHandle( h_mutex_read_commands );
-            CloseHandle( h_mutex_instances_usage );
-            CloseHandle( h_mutex_data_usage );
-            DeleteCriticalSection( &cs_usage );
-            UnmapViewOfFile( ptr_smem );
-            CloseHandle( h_smem );
-            exit( 1 );
-        }
+    ~SMem( )
+    {
+        waiter.interrupt( );
 
-        if ( is_main_instance )
-            memset( ptr_smem, 0, sizeof( SMEM ) );
+        if ( listener.joinable( ) )
+            listener.join( );
 
-        WaitForSingleObjectEx( h_mutex_instances_usage, INFINITE, false );
+        if ( slot != -1 )
+            ipc::compareExchange( ptr_smem->instances[ slot ].pid, static_cast<int32_t>( ipc::currentPid( ) ), 0 );
 
-        ptr_smem->num_instances++;
+        waiter.close( );
+        read_frames.section.close( );
+        write_frames.section.close( );
+        section.close( );
+    }
 
-        ReleaseMutex( h_mutex_instances_usage );
+    // -1 while the listener runs, 0 once it stopped after the instance closed and 1 if it failed
+    //
+    int getStatus( )
+    {
+        return ipc::load( status );
     }
 
-    ~SMem( )
+    // newest complete frame, never waits on the writer
+    // num_entities says how many entities has room for, a larger frame fails and leaves the number it needs there
+    //
+    bool getData( DATA* ptr_data )
     {
-        if ( h_event )
-            SetEvent( h_event );
+        if ( !ptr_data )
+            return false;
 
-        if ( h_thread )
-        {
-            if ( getStatus( ) == -1 )
-                WaitForSingleObjectEx( h_thread, INFINITE, false );
+        DATA data;
+        std::vector<ENTITY> frame_entities;
+        if ( !readFrame( data, frame_entities, nullptr ) )
+            return false;
 
-            CloseHandle( h_thread );
+        if ( data.num_entities > ptr_data->num_entities || ( data.num_entities && !ptr_data->entities ) )
+        {
+            ptr_data->num_entities = data.num_entities;
+            return false;
         }
 
-        if ( h_updated_event )
-            CloseHandle( h_updated_event );
+        data.entities = ptr_data->entities;
+        if ( data.num_entities )
+            memcpy( data.entities, frame_entities.data( ), data.num_entities * sizeof( ENTITY ) );
 
-        if ( h_event )
-            CloseHandle( h_event );
+        *ptr_data = data;
+        return true;
+    }
 
-        if ( h_sem_write_commands )
-            CloseHandle( h_sem_write_commands );
+    // only the server writes, it never waits on the readers: a reader that falls behind skips to the newest frame
+    // a frame costs what its entities take, the frames section only grows when a larger board comes along
+    //
+    bool writeData( const DATA* ptr_data )
+    {
+        if ( !ptr_data || ptr_data->num_entities < 0 || ( ptr_data->num_entities && !ptr_data->entities ) )
+            return false;
+
+        if ( !reserveFrames( ptr_data->num_entities ) )
+        {
+            console::error( TEXT( "Could not map the frames of " ), ptr_data->num_entities, TEXT( " entities" ) );
+            return false;
+        }
 
-        if ( h_sem_read_commands )
-            CloseHandle( h_sem_read_commands );
+        const auto index = ipc::load( ptr_smem->frames.write_index );
+        auto frame = frameAt( write_frames, index % MAX_FRAMES );
 
-        if ( h_mutex_write_commands )
-            CloseHandle( h_mutex_write_commands );
+        ipc::fetchAdd( frame->sequence, 1 );
 
-        if ( h_mutex_read_commands )
-            CloseHandle( h_mutex_read_commands );
+        frame->state = ptr_data->state;
+        frame->version = index + 1;
+        frame->time = ptr_data->time;
+        frame->level = ptr_data->level;
+        frame->width = ptr_data->width;
+        frame->height = ptr_data->height;
+        frame->num_entities = ptr_data->num_entities;
+        if ( ptr_data->num_entities )
+            memcpy( frame + 1, ptr_data->entities, ptr_data->num_entities * sizeof( ENTITY ) );
 
-        if ( h_mutex_instances_usage )
-            CloseHandle( h_mutex_instances_usage );
+        ipc::fetchAdd( frame->sequence, 1 );
 
-        if ( h_mutex_data_usage )
-            CloseHandle( h_mutex_data_usage );
+        // a new section goes out together with its first frame
+        //
+        if ( ipc::load( ptr_smem->frames.layout ) != write_frames.layout )
+            ipc::store( ptr_smem->frames.layout, write_frames.layout );
 
-        DeleteCriticalSection( &cs_usage );
+        ipc::store( ptr_smem->frames.write_index, index + 1 );
 
-        if ( ptr_smem )
-            UnmapViewOfFile( ptr_smem );
+        std::lock_guard lock( mtx_instances );
 
-        if ( h_smem )
-            CloseHandle( h_smem );
+        for ( int i = 0; i < max_instances; i++ )
+            wake( i );
+
+        return true;
     }
 
-    DWORD getStatus( )
+    // routed straight into the queue of the target (-1 = every other instance, 0 = the server)
+    // fails right away if the target doesn't exist or its queue is full, it never waits
+    //
+    bool writeCommand( COMMAND* ptr_command )
     {
-        DWORD status = NULL;
+        const auto self = static_cast<int32_t>( ipc::currentPid( ) );
+
+        int32_t target_pid = ptr_command->target_pid;
+        if ( !target_pid )
+            target_pid = ipc::load( ptr_smem->main_pid );
 
-        switch ( GetExitCodeThread( h_thread, &status ) )
+        bool delivered = false, failed = false;
+
+        std::lock_guard lock( mtx_instances );
+
+        for ( int i = 0; i < max_instances; i++ )
         {
-        case STILL_ACTIVE:
-            return -1;
-        case NULL:
-            return 1;
-        default:
-            return status;
+            const auto pid = ipc::load( ptr_smem->instances[ i ].pid );
+            if ( pid <= 0 || pid == self || ( target_pid != -1 && pid != target_pid ) )
+                continue;
+
+            if ( !enqueue( ptr_smem->instances[ i ].commands, ptr_command ) )
+            {
+                console::error( TEXT( "Command queue of " ), pid, TEXT( " is full" ) );
+                failed = true;
+                continue;
+            }
+
+            wake( i );
+            delivered = true;
         }
+
+        return delivered && !failed;
     }
 
-    bool getData( DATA* ptr_data )
+    bool registerCmdHandler( CommandHandler cmd_handler )
     {
-        if ( WaitForSingleObjectEx( h_mutex_data_usage, INFINITE, false ) != WAIT_OBJECT_0 )
-            return false;
+        std::lock_guard lock( mtx_usage );
 
-        memcpy_s( ptr_data, sizeof( DATA ), &ptr_smem->data, sizeof( DATA ) );
+        this->cmd_handler = cmd_handler;
 
-        ReleaseMutex( h_mutex_data_usage );
         return true;
     }
 
-    bool writeData( DATA* ptr_data )
+    bool registerHandler( DataHandler data_handler )
     {
-        if ( WaitForSingleObjectEx( h_mutex_data_usage, INFINITE, false ) != WAIT_OBJECT_0 )
-            return false;
-
-        memcpy_s( &ptr_smem->data, sizeof( DATA ), ptr_data, sizeof( DATA ) );
-
-        ReleaseMutex( h_mutex_data_usage );
+        std::lock_guard lock( mtx_usage );
 
-        if ( !SetEvent( h_updated_event ) )
-            console::error( TEXT( "SetEvent failed: " ), GetLastError( ) );
+        this->data_handler = data_handler;
 
         return true;
     }
 
-    bool writeCommand( COMMAND* ptr_command )
+private:
+    bool isAbandoned( )
     {
-        if ( WaitForSingleObjectEx( h_sem_write_commands, INFINITE, false ) != WAIT_OBJECT_0 )
+        const auto main_pid = ipc::load( ptr_smem->main_pid );
+        if ( main_pid > 0 && ipc::isAlive( main_pid ) )
             return false;
 
-        if ( WaitForSingleObjectEx( h_mutex_write_commands, INFINITE, false ) != WAIT_OBJECT_0 )
+        for ( auto& instance : ptr_smem->instances )
         {
-            ReleaseSemaphore( h_sem_write_commands, 1, nullptr );
-            return false;
+            const auto pid = ipc::load( instance.pid );
+            if ( pid == -1 || ( pid > 0 && ipc::isAlive( pid ) ) )
+                return false;
         }
 
-        memcpy_s( &ptr_smem->commands.commands[ ptr_smem->commands.write_index++ ], sizeof( COMMAND ), ptr_command, sizeof( COMMAND ) );
-
-        if ( ptr_smem->commands.write_index == MAX_COMMANDS )
-            ptr_smem->commands.write_index = 0;
+        return true;
+    }
 
-        ReleaseMutex( h_mutex_write_commands );
-        ReleaseSemaphore( h_sem_read_commands, 1, nullptr );
+    // the slot is reserved ( -1 ) while its queue is reset, so nobody enqueues into a half initialized queue
+    //
+    bool claimSlot( )
+    {
+        for ( int i = 0; i < max_instances; i++ )
+        {
+            if ( ipc::compareExchange( ptr_smem->instances[ i ].pid, 0, -1 ) != 0 )
+                continue;
+
+            auto& queue = ptr_smem->instances[ i ].commands;
+            queue.enqueue_index = 0;
+            queue.dequeue_index = 0;
+            for ( int j = 0; j < queue_depth; j++ )
+                queue.cells[ j ].sequence = j;
+
+            // frames published before we joined are of no interest
+            //
+            cursor = ipc::load( ptr_smem->frames.write_index );
+
+            ipc::store( ptr_smem->instances[ i ].pid, static_cast<int32_t>( ipc::currentPid( ) ) );
+            slot = i;
+            return true;
+        }
 
-        return true;
+        console::error( TEXT( "No free instance slot in the shared memory" ) );
+        return false;
     }
 
-    bool registerCmdHandler( CommandHandler cmd_handler )
+    // never blocks, so the writer pays the same whatever the other instances are doing
+    // slots of processes that are gone are freed on the way
+    // mtx_instances must be held
+    //
+    void wake( int index )
     {
-        EnterCriticalSection( &cs_usage );
+        auto& instance = ptr_smem->instances[ index ];
 
-        this->cmd_handler = cmd_handler;
+        const auto pid = ipc::load( instance.pid );
+        if ( pid <= 0 || index == slot )
+            return;
 
-        LeaveCriticalSection( &cs_usage );
+        if ( !waker.wake( index, static_cast<uint32_t>( pid ), &instance.wake ) )
+            ipc::compareExchange( instance.pid, pid, 0 );
+    }
 
-        return true;
+    // producers reserve a position with a CAS and publish the cell through its sequence
+    //
+    bool enqueue( COMMAND_QUEUE& queue, const COMMAND* ptr_command )
+    {
+        auto position = ipc::load( queue.enqueue_index );
+        while ( true )
+        {
+            auto& cell = queue.cells[ position & ( queue_depth - 1 ) ];
+            const auto sequence = ipc::load( cell.sequence );
+
+            const auto difference = sequence - position;
+            if ( !difference )
+            {
+                const auto current = ipc::compareExchange( queue.enqueue_index, position, position + 1 );
+                if ( current == position )
+                {
+                    memcpy( &cell.command, ptr_command, sizeof( COMMAND ) );
+                    ipc::store( cell.sequence, position + 1 );
+                    return true;
+                }
+
+                position = current;
+            }
+            else if ( difference < 0 )
+                return false;
+            else
+                position = ipc::load( queue.enqueue_index );
+        }
     }
 
-    bool registerHandler( DataHandler data_handler )
+    // only the owner of the queue dequeues
+    //
+    bool dequeue( COMMAND_QUEUE& queue, COMMAND* ptr_command )
     {
-        EnterCriticalSection( &cs_usage );
+        const auto position = queue.dequeue_index;
+        auto& cell = queue.cells[ position & ( queue_depth - 1 ) ];
 
-        this->data_handler = data_handler;
+        if ( ipc::load( cell.sequence ) != position + 1 )
+            return false;
 
-        LeaveCriticalSection( &cs_usage );
+        memcpy( ptr_command, &cell.command, sizeof( COMMAND ) );
 
+        queue.dequeue_index = position + 1;
+        ipc::store( cell.sequence, position + queue_depth );
         return true;
     }
 
-private:
-    bool onProcessedInstance( )
+    static size_t slotSize( int64_t layout )
     {
-        if ( WaitForSingleObjectEx( h_mutex_instances_usage, INFINITE, false ) != WAIT_OBJECT_0 )
-            return false;
+        return sizeof( FRAME ) + static_cast<size_t>( layout & 0xffffffff ) * sizeof( ENTITY );
+    }
+
+    static FRAME* frameAt( FRAMES& frames, int64_t index )
+    {
+        return reinterpret_cast<FRAME*>( static_cast<char*>( frames.section.data( ) ) + index * slotSize( frames.layout ) );
+    }
+
+    // maps the frames section of layout, if frames doesn't have it mapped already
+    // only the server creates (and removes) one, a reader just maps what the server published
+    //
+    bool mapFrames( FRAMES& frames, int64_t layout, bool create )
+    {
+        if ( frames.layout == layout )
+            return true;
+
+        frames.section.close( );
+        frames.layout = 0;
+
+        char frames_name[ 96 ];
+        std::snprintf( frames_name, sizeof( frames_name ), "%s_FRAMES_%u", name, static_cast<uint32_t>( layout >> 32 ) );
 
-        ptr_smem->processed_instances++;
+        if ( !frames.section.open( frames_name, MAX_FRAMES * slotSize( layout ), create ) )
+            return false;
 
-        ReleaseMutex( h_mutex_instances_usage );
+        if ( create )
+            frames.section.own( );
 
+        frames.layout = layout;
         return true;
     }
 
-    bool resetProcessedInstance( )
+    // the server moves to a new frames section when a frame has more entities than a slot has room for
+    // the old one stays mapped by the readers still in it, a read that finds its frame gone just reads again
+    //
+    bool reserveFrames( int num_entities )
     {
-        if ( WaitForSingleObjectEx( h_mutex_instances_usage, INFINITE, false ) != WAIT_OBJECT_0 )
-            return false;
+        const auto capacity = write_frames.layout & 0xffffffff;
+        if ( write_frames.layout && num_entities <= capacity )
+            return true;
 
-        ptr_smem->processed_instances = 0;
+        const auto generation = ( ipc::load( ptr_smem->frames.layout ) >> 32 ) + 1;
+        const auto layout = generation << 32 | std::max<int64_t>( { num_entities, capacity * 2, FRAME_ENTITIES } );
 
-        ReleaseMutex( h_mutex_instances_usage );
+        if ( !mapFrames( write_frames, layout, true ) )
+            return false;
 
+        // a section left behind by a server that crashed (POSIX keeps the name) has frames of another run in it
+        //
+        memset( write_frames.section.data( ), 0, MAX_FRAMES * slotSize( layout ) );
         return true;
     }
 
-    static DWORD WINAPI listenerRoutine( SMem* _this )
+    // seqlock read of the newest frame, retried if the writer came around to that slot meanwhile
+    // (or moved to a new frames section, this frame isn't written in it yet)
+    //
+    bool readFrame( DATA& data, std::vector<ENTITY>& frame_entities, int64_t* ptr_version )
     {
-        DWORD ret_cause = NULL;
-        while ( ( ret_cause = WaitForSingleObjectEx( _this->h_event, update_interval, false ) ) == WAIT_TIMEOUT )
+        std::lock_guard lock( mtx_frames );
+
+        int retries = 0;
+        while ( true )
         {
-            auto ptr_smem = ( _this->ptr_smem );
+            const auto version = ipc::load( ptr_smem->frames.write_index );
+            if ( !version )
+                return false;
 
-            EnterCriticalSection( &_this->cs_usage );
+            const auto layout = ipc::load( ptr_smem->frames.layout );
+            if ( !mapFrames( read_frames, layout, false ) )
+                return false;
 
-            if ( WaitForSingleObjectEx( _this->h_updated_event, NULL, false ) == WAIT_OBJECT_0 )
+            const auto frame = frameAt( read_frames, ( version - 1 ) % MAX_FRAMES );
+
+            const auto before = ipc::load( frame->sequence );
+            if ( before & 1 )
             {
-                if ( _this->data_handler )
-                    _this->data_handler( ptr_smem->data );
+                ipc::pause( );
+                continue;
+            }
 
-                _this->onProcessedInstance( );
+            FRAME header;
+            memcpy( &header, frame, sizeof( FRAME ) );
 
-                if ( ptr_smem->processed_instances >= ptr_smem->num_instances )
-                {
-                    _this->resetProcessedInstance( );
+            // a torn count is caught by the sequence below, it only has to stay inside the slot
+            //
+            const auto num_entities = std::clamp<int64_t>( header.num_entities, 0, layout & 0xffffffff );
+            if ( frame_entities.size( ) < static_cast<size_t>( num_entities ) )
+                frame_entities.resize( num_entities );
 
-                    ResetEvent( _this->h_updated_event );
-                }
-            }
+            if ( num_entities )
+                memcpy( frame_entities.data( ), frame + 1, num_entities * sizeof( ENTITY ) );
+
+            std::atomic_thread_fence( std::memory_order_acquire );
 
-            if ( WaitForSingleObjectEx( _this->h_sem_read_commands, NULL, false ) == WAIT_OBJECT_0 )
+            if ( std::atomic_ref<int32_t>( frame->sequence ).load( std::memory_order_relaxed ) != before )
+                continue;
+
+            // lapped by the writer, or it is between publishing a new frames section and the frame that goes with it
+            // (a server that died right there leaves nothing to read)
+            //
+            if ( header.version != version || header.num_entities != num_entities )
             {
-                if ( WaitForSingleObjectEx( _this->h_mutex_read_commands, NULL, false ) != WAIT_OBJECT_0 )
-                {
-                    ReleaseSemaphore( _this->h_sem_read_commands, 1, nullptr );
-                    LeaveCriticalSection( &_this->cs_usage );
-                    continue;
-                }
+                if ( ++retries > max_retries )
+                    return false;
 
-                const auto target_pid = ptr_smem->commands.commands[ ptr_smem->commands.read_index ].target_pid;
-                if ( ( target_pid == -1 && _this->is_main_instance ) && target_pid != GetCurrentProcessId( ) && ( target_pid == 0 && !_this->is_main_instance ) )
-                {
-                    ReleaseMutex( _this->h_mutex_read_commands );
-                    ReleaseSemaphore( _this->h_sem_read_commands, 1, nullptr );
-                    LeaveCriticalSection( &_this->cs_usage );
-                    continue;
-                }
+                ipc::pause( );
+                continue;
+            }
 
-                if ( _this->cmd_handler )
-                    _this->cmd_handler( ptr_smem->commands.commands[ ptr_smem->commands.read_index ] );
+            data.state = header.state;
+            data.time = header.time;
+            data.level = header.level;
+            data.width = header.width;
+            data.height = header.height;
+            data.num_entities = header.num_entities;
+            data.entities = frame_entities.data( );
 
-                ptr_smem->commands.read_index++;
+            if ( ptr_version )
+                *ptr_version = version;
 
-                if ( _this->ptr_smem->commands.read_index == MAX_COMMANDS )
-                    _this->ptr_smem->commands.read_index = 0;
+            return true;
+        }
+    }
 
-                ReleaseMutex( _this->h_mutex_read_commands );
-                ReleaseSemaphore( _this->h_sem_write_commands, 1, nullptr );
-            }
+    void onFrame( )
+    {
+        DATA data;
+        int64_t version = 0;
+
+        // always the newest frame, whatever was published in between is skipped
+        //
+        if ( !readFrame( data, entities, &version ) || version == cursor )
+            return;
+
+        cursor = version;
+
+        std::lock_guard lock( mtx_usage );
+
+        if ( data_handler )
+            data_handler( data );
+    }
 
-            LeaveCriticalSection( &_this->cs_usage );
+    // the handler runs on a private copy, nothing shared is held while it does
+    //
+    void onCommands( )
+    {
+        COMMAND command;
+        while ( dequeue( ptr_smem->instances[ slot ].commands, &command ) )
+        {
+            std::lock_guard lock( mtx_usage );
+
+            if ( cmd_handler )
+                cmd_handler( command );
         }
+    }
 
-        return ret_cause != WAIT_OBJECT_0;
+    // sleeps until a frame is published or a command is queued for us, or until the instance closes
+    //
+    static void listenerRoutine( SMem* _this )
+    {
+        while ( true )
+        {
+            switch ( _this->waiter.wait( ) )
+            {
+            case ipc::WAIT_WOKEN:
+                _this->onCommands( );
+                _this->onFrame( );
+                break;
+            case ipc::WAIT_INTERRUPTED:
+                ipc::store( _this->status, 0 );
+                return;
+            default:
+                ipc::store( _this->status, 1 );
+                return;
+            }
+        }
     }
 };
\ No newline at end of file
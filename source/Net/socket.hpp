@@ -0,0 +1,441 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#pragma comment( lib, "ws2_32.lib" )
+#else
+#if defined( __linux__ ) && !defined( CRR_NET_POLL )
+#define CRR_NET_EPOLL
+#include <sys/epoll.h>
+#endif
+
+#include <poll.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+
+// the few socket calls the transport needs, the same on winsock and on BSD sockets
+// only included by translation units, so the Win32 modules never see winsock next to their Windows.h
+//
+namespace net
+{
+#ifdef _WIN32
+	using socket_t = SOCKET;
+	using pollfd_t = WSAPOLLFD;
+
+	inline constexpr socket_t invalid_socket = INVALID_SOCKET;
+#else
+	using socket_t = int;
+	using pollfd_t = pollfd;
+
+	inline constexpr socket_t invalid_socket = -1;
+#endif
+
+	inline bool startup( )
+	{
+#ifdef _WIN32
+		static const bool started = [ ] ( )
+			{
+				WSADATA wsa_data;
+				return WSAStartup( MAKEWORD( 2, 2 ), &wsa_data ) == 0;
+			}( );
+
+		return started;
+#else
+		return true;
+#endif
+	}
+
+	inline int lastError( )
+	{
+#ifdef _WIN32
+		return WSAGetLastError( );
+#else
+		return errno;
+#endif
+	}
+
+	inline bool wouldBlock( int error )
+	{
+#ifdef _WIN32
+		return error == WSAEWOULDBLOCK;
+#else
+		return error == EAGAIN || error == EWOULDBLOCK || error == EINTR;
+#endif
+	}
+
+	inline void closeSocket( socket_t socket )
+	{
+		if ( socket == invalid_socket )
+			return;
+
+#ifdef _WIN32
+		closesocket( socket );
+#else
+		close( socket );
+#endif
+	}
+
+	inline bool setNonBlocking( socket_t socket )
+	{
+#ifdef _WIN32
+		u_long mode = 1;
+		return ioctlsocket( socket, FIONBIO, &mode ) == 0;
+#else
+		const auto flags = fcntl( socket, F_GETFL, 0 );
+		return flags != -1 && fcntl( socket, F_SETFL, flags | O_NONBLOCK ) == 0;
+#endif
+	}
+
+	// inputs are a few bytes each, they must not sit in Nagle's buffer waiting for more
+	//
+	inline bool setNoDelay( socket_t socket )
+	{
+		int enable = 1;
+		return setsockopt( socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>( &enable ), sizeof( enable ) ) == 0;
+	}
+
+	// caps what the kernel holds for a peer that doesn't read, the system may round it up
+	//
+	inline bool setSendBuffer( socket_t socket, int bytes )
+	{
+		return setsockopt( socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>( &bytes ), sizeof( bytes ) ) == 0;
+	}
+
+	inline int pollSockets( pollfd_t* fds, size_t count, int timeout_ms )
+	{
+#ifdef _WIN32
+		return WSAPoll( fds, static_cast<ULONG>( count ), timeout_ms );
+#else
+		return poll( fds, static_cast<nfds_t>( count ), timeout_ms );
+#endif
+	}
+
+	// -1 on error, 0 if nothing could be moved right now
+	//
+	inline long sendSome( socket_t socket, const char* data, size_t size )
+	{
+#ifdef _WIN32
+		const long sent = ::send( socket, data, static_cast<int>( size ), 0 );
+#else
+		const long sent = ::send( socket, data, size, MSG_NOSIGNAL );
+#endif
+		if ( sent < 0 )
+			return wouldBlock( lastError( ) ) ? 0 : -1;
+
+		return sent;
+	}
+
+	// -1 on error or when the peer closed, 0 if nothing arrived yet
+	//
+	inline long receiveSome( socket_t socket, char* data, size_t size )
+	{
+#ifdef _WIN32
+		const long received = ::recv( socket, data, static_cast<int>( size ), 0 );
+#else
+		const long received = ::recv( socket, data, size, 0 );
+#endif
+		if ( received < 0 )
+			return wouldBlock( lastError( ) ) ? 0 : -1;
+
+		return received ? received : -1;
+	}
+
+	// port 0 picks a free one, it is returned through pport
+	//
+	inline socket_t listenTcp( const char* address, uint16_t port, uint16_t* pport )
+	{
+		if ( !startup( ) )
+			return invalid_socket;
+
+		const auto socket = ::socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+		if ( socket == invalid_socket )
+			return invalid_socket;
+
+		int enable = 1;
+		setsockopt( socket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>( &enable ), sizeof( enable ) );
+
+		sockaddr_in addr { };
+		addr.sin_family = AF_INET;
+		addr.sin_port = htons( port );
+		if ( inet_pton( AF_INET, address, &addr.sin_addr ) != 1 ||
+			bind( socket, reinterpret_cast<sockaddr*>( &addr ), sizeof( addr ) ) != 0 ||
+			listen( socket, SOMAXCONN ) != 0 || !setNonBlocking( socket ) )
+		{
+			closeSocket( socket );
+			return invalid_socket;
+		}
+
+		socklen_t length = sizeof( addr );
+		if ( pport && getsockname( socket, reinterpret_cast<sockaddr*>( &addr ), &length ) == 0 )
+			*pport = ntohs( addr.sin_port );
+
+		return socket;
+	}
+
+	// blocking connect, the socket is switched to non blocking once connected
+	//
+	inline socket_t connectTcp( const char* host, uint16_t port )
+	{
+		if ( !startup( ) )
+			return invalid_socket;
+
+		addrinfo hints { };
+		hints.ai_family = AF_INET;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_protocol = IPPROTO_TCP;
+
+		char service[ 8 ];
+		std::snprintf( service, sizeof( service ), "%u", static_cast<unsigned>( port ) );
+
+		addrinfo* result = nullptr;
+		if ( getaddrinfo( host, service, &hints, &result ) != 0 )
+			return invalid_socket;
+
+		auto socket = invalid_socket;
+		for ( auto info = result; info; info = info->ai_next )
+		{
+			socket = ::socket( info->ai_family, info->ai_socktype, info->ai_protocol );
+			if ( socket == invalid_socket )
+				continue;
+
+			if ( ::connect( socket, info->ai_addr, static_cast<int>( info->ai_addrlen ) ) == 0 && setNonBlocking( socket ) && setNoDelay( socket ) )
+				break;
+
+			closeSocket( socket );
+			socket = invalid_socket;
+		}
+
+		freeaddrinfo( result );
+		return socket;
+	}
+
+	inline socket_t acceptTcp( socket_t listener )
+	{
+		const auto socket = accept( listener, nullptr, nullptr );
+		if ( socket == invalid_socket )
+			return invalid_socket;
+
+		if ( !setNonBlocking( socket ) || !setNoDelay( socket ) )
+		{
+			closeSocket( socket );
+			return invalid_socket;
+		}
+
+		return socket;
+	}
+
+	// a connected pair used to wake a thread sleeping in pollSockets, [ 0 ] is polled and [ 1 ] is written
+	// winsock has no socketpair, a loopback connection does the same
+	//
+	inline bool wakePair( socket_t pair[ 2 ] )
+	{
+#ifdef _WIN32
+		uint16_t port = 0;
+		const auto listener = listenTcp( "127.0.0.1", 0, &port );
+		if ( listener == invalid_socket )
+			return false;
+
+		pair[ 1 ] = connectTcp( "127.0.0.1", port );
+
+		pollfd_t fd { listener, POLLIN, 0 };
+		pair[ 0 ] = pair[ 1 ] != invalid_socket && pollSockets( &fd, 1, 1000 ) == 1 ? acceptTcp( listener ) : invalid_socket;
+
+		closeSocket( listener );
+#else
+		if ( socketpair( AF_UNIX, SOCK_STREAM, 0, pair ) != 0 )
+			return false;
+
+		setNonBlocking( pair[ 0 ] );
+		setNonBlocking( pair[ 1 ] );
+#endif
+		if ( pair[ 0 ] != invalid_socket && pair[ 1 ] != invalid_socket )
+			return true;
+
+		closeSocket( pair[ 0 ] );
+		closeSocket( pair[ 1 ] );
+		return false;
+	}
+
+	inline void wake( socket_t socket )
+	{
+		const char byte = 0;
+		sendSome( socket, &byte, 1 );
+	}
+
+	inline void drain( socket_t socket )
+	{
+		char buffer[ 64 ];
+		while ( receiveSome( socket, buffer, sizeof( buffer ) ) > 0 );
+	}
+
+	// the sockets one thread sleeps on, each registered with a pointer handed back with its events
+	// epoll on Linux, a wake costs the sockets that are ready. elsewhere (and with CRR_NET_POLL) the array kept here
+	// goes to poll / WSAPoll, which scan all of them
+	//
+	class Poller
+	{
+	public:
+		typedef struct
+		{
+			void* data;
+			bool readable;		// or closed, or failed, a read tells which
+			bool writable;
+		} EVENT;
+
+	private:
+#ifdef CRR_NET_EPOLL
+		int epoll = -1;
+		std::vector<epoll_event> events;
+#else
+		std::vector<pollfd_t> fds;
+		std::vector<void*> datas;
+#endif
+		std::vector<EVENT> ready;
+
+	public:
+		Poller( )
+		{
+#ifdef CRR_NET_EPOLL
+			epoll = epoll_create1( EPOLL_CLOEXEC );
+			events.resize( 256 );
+#endif
+		}
+
+		~Poller( )
+		{
+#ifdef CRR_NET_EPOLL
+			if ( epoll != -1 )
+				close( epoll );
+#endif
+		}
+
+		Poller( const Poller& ) = delete;
+		Poller& operator=( const Poller& ) = delete;
+
+		bool isOpen( )
+		{
+#ifdef CRR_NET_EPOLL
+			return epoll != -1;
+#else
+			return true;
+#endif
+		}
+
+		bool add( socket_t socket, void* data, bool writable = false )
+		{
+#ifdef CRR_NET_EPOLL
+			epoll_event event { };
+			event.events = EPOLLIN;
+			if ( writable )
+				event.events |= EPOLLOUT;
+
+			event.data.ptr = data;
+			return epoll_ctl( epoll, EPOLL_CTL_ADD, socket, &event ) == 0;
+#else
+			fds.push_back( { socket, static_cast<short>( POLLIN | ( writable ? POLLOUT : 0 ) ), 0 } );
+			datas.push_back( data );
+			return true;
+#endif
+		}
+
+		// readable is always watched, writable only while there is something to write
+		//
+		bool modify( socket_t socket, void* data, bool writable )
+		{
+#ifdef CRR_NET_EPOLL
+			epoll_event event { };
+			event.events = EPOLLIN;
+			if ( writable )
+				event.events |= EPOLLOUT;
+
+			event.data.ptr = data;
+			return epoll_ctl( epoll, EPOLL_CTL_MOD, socket, &event ) == 0;
+#else
+			for ( auto& fd : fds )
+				if ( fd.fd == socket )
+				{
+					fd.events = static_cast<short>( POLLIN | ( writable ? POLLOUT : 0 ) );
+					return true;
+				}
+
+			return false;
+#endif
+		}
+
+		// before the socket is closed
+		//
+		void remove( socket_t socket )
+		{
+#ifdef CRR_NET_EPOLL
+			epoll_event event { };
+			epoll_ctl( epoll, EPOLL_CTL_DEL, socket, &event );
+#else
+			for ( size_t i = 0; i < fds.size( ); i++ )
+				if ( fds[ i ].fd == socket )
+				{
+					fds[ i ] = fds.back( );
+					datas[ i ] = datas.back( );
+					fds.pop_back( );
+					datas.pop_back( );
+					return;
+				}
+#endif
+		}
+
+		// -1 on error (see lastError( )), otherwise the events are in getEvents( ) until the next wait
+		//
+		int wait( int timeout_ms )
+		{
+			ready.clear( );
+
+#ifdef CRR_NET_EPOLL
+			const auto count = epoll_wait( epoll, events.data( ), static_cast<int>( events.size( ) ), timeout_ms );
+			if ( count < 0 )
+				return -1;
+
+			for ( int i = 0; i < count; i++ )
+			{
+				const auto flags = events[ i ].events;
+				ready.push_back( { events[ i ].data.ptr, ( flags & ( EPOLLIN | EPOLLERR | EPOLLHUP ) ) != 0, ( flags & EPOLLOUT ) != 0 } );
+			}
+
+			// a full batch, there may be more sockets ready than fit in it
+			//
+			if ( count == static_cast<int>( events.size( ) ) )
+				events.resize( events.size( ) * 2 );
+#else
+			const auto count = pollSockets( fds.data( ), fds.size( ), timeout_ms );
+			if ( count < 0 )
+				return -1;
+
+			for ( size_t i = 0; i < fds.size( ) && ready.size( ) < static_cast<size_t>( count ); i++ )
+			{
+				const auto flags = fds[ i ].revents;
+				if ( flags )
+					ready.push_back( { datas[ i ], ( flags & ( POLLIN | POLLERR | POLLHUP ) ) != 0, ( flags & POLLOUT ) != 0 } );
+			}
+#endif
+
+			return static_cast<int>( ready.size( ) );
+		}
+
+		const std::vector<EVENT>& getEvents( )
+		{
+			return ready;
+		}
+	};
+}
\ No newline at end of file
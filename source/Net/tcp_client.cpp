@@ -0,0 +1,268 @@
+#include "tcp_client.hpp"
+#include "socket.hpp"
+
+#include <chrono>
+
+static net::socket_t toSocket( intptr_t socket )
+{
+	return static_cast<net::socket_t>( socket );
+}
+
+TcpConnection::~TcpConnection( )
+{
+	close( );
+}
+
+bool TcpConnection::connect( const char* host, uint16_t port )
+{
+	if ( isConnected( ) )
+		return false;
+
+	const auto connected = net::connectTcp( host, port );
+	if ( connected == net::invalid_socket )
+		return false;
+
+	socket = static_cast<intptr_t>( connected );
+
+	in.clear( );
+	out.clear( );
+	in_offset = 0;
+
+	return true;
+}
+
+void TcpConnection::close( )
+{
+	if ( !isConnected( ) )
+		return;
+
+	net::closeSocket( toSocket( socket ) );
+	socket = -1;
+	joined = false;
+}
+
+bool TcpConnection::joinMatch( uint32_t process_pid, GAME_TYPE type, int timeout_ms )
+{
+	if ( !isConnected( ) || joined )
+		return false;
+
+	// the server starts the stream with a keyframe
+	//
+	replica = { };
+	replica_seq = 0;
+	awaiting_keyframe = false;
+
+	predictor.reset( );
+	view = { };
+	input_ack = 0;
+
+	encodeJoin( out, process_pid, type );
+	if ( !send( ) )
+		return false;
+
+	const auto deadline = std::chrono::steady_clock::now( ) + std::chrono::milliseconds( timeout_ms );
+
+	while ( true )
+	{
+		const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>( deadline - std::chrono::steady_clock::now( ) ).count( );
+		if ( remaining < 0 )
+			return false;
+
+		net::pollfd_t fd { toSocket( socket ), POLLIN, 0 };
+		if ( net::pollSockets( &fd, 1, static_cast<int>( remaining ) ) < 0 )
+			return false;
+
+		// a declined request is answered and closed right away, the answer still has to be read
+		//
+		const bool alive = receive( );
+
+		WIRE_MESSAGE message;
+		WIRE_READER payload;
+		const auto size = parseMessage( in.data( ) + in_offset, in.size( ) - in_offset, message, payload );
+		if ( size < 0 || ( !size && !alive ) )
+			return false;
+
+		if ( !size )
+			continue;
+
+		in_offset += size;
+
+		bool status = false;
+		if ( message != WIRE_JOIN_RESULT || !decodeJoinResult( payload, status, pid ) )
+			return false;
+
+		joined = status;
+		return joined;
+	}
+}
+
+void TcpConnection::leaveMatch( )
+{
+	if ( !joined )
+		return;
+
+	encodeEmpty( out, WIRE_LEAVE );
+	send( );
+
+	joined = false;
+}
+
+bool TcpConnection::sendMove( FACING direction )
+{
+	if ( !joined )
+		return false;
+
+	encodeMove( out, direction, predictor.predict( direction ) );
+	predictor.apply( view );
+
+	return send( );
+}
+
+bool TcpConnection::pump( int timeout_ms )
+{
+	if ( !isConnected( ) )
+		return false;
+
+	if ( timeout_ms )
+	{
+		net::pollfd_t fd { toSocket( socket ), POLLIN, 0 };
+		if ( net::pollSockets( &fd, 1, timeout_ms ) < 0 )
+			return false;
+	}
+
+	if ( !receive( ) )
+	{
+		close( );
+		return false;
+	}
+
+	while ( true )
+	{
+		WIRE_MESSAGE message;
+		WIRE_READER payload;
+		const auto size = parseMessage( in.data( ) + in_offset, in.size( ) - in_offset, message, payload );
+		if ( size < 0 )
+		{
+			close( );
+			return false;
+		}
+
+		if ( !size )
+			break;
+
+		in_offset += size;
+		onMessage( message, payload );
+	}
+
+	// keep the unparsed tail at the front, so the buffer doesn't grow with the stream
+	//
+	in.erase( in.begin( ), in.begin( ) + in_offset );
+	in_offset = 0;
+
+	return isConnected( );
+}
+
+int TcpConnection::waitAny( TcpConnection* const* connections, size_t count, int timeout_ms, std::vector<size_t>& ready )
+{
+	thread_local std::vector<net::pollfd_t> fds;
+
+	fds.resize( count );
+	for ( size_t i = 0; i < count; i++ )
+		fds[ i ] = { toSocket( connections[ i ]->socket ), POLLIN, 0 };
+
+	ready.clear( );
+
+	const auto result = net::pollSockets( fds.data( ), count, timeout_ms );
+	if ( result <= 0 )
+		return result;
+
+	for ( size_t i = 0; i < count; i++ )
+		if ( fds[ i ].revents )
+			ready.push_back( i );
+
+	return result;
+}
+
+// inputs are tiny, a full send buffer means the connection is dead or hopelessly behind
+//
+bool TcpConnection::send( )
+{
+	size_t offset = 0;
+	while ( offset < out.size( ) )
+	{
+		const auto sent = net::sendSome( toSocket( socket ), out.data( ) + offset, out.size( ) - offset );
+		if ( sent <= 0 )
+		{
+			out.clear( );
+			close( );
+			return false;
+		}
+
+		offset += sent;
+	}
+
+	out.clear( );
+	return true;
+}
+
+bool TcpConnection::receive( )
+{
+	char buffer[ 4096 ];
+
+	while ( true )
+	{
+		const auto received = net::receiveSome( toSocket( socket ), buffer, sizeof( buffer ) );
+		if ( received < 0 )
+			return false;
+
+		if ( !received )
+			return true;
+
+		in.insert( in.end( ), buffer, buffer + received );
+		bytes_received += received;
+	}
+}
+
+void TcpConnection::onMessage( WIRE_MESSAGE type, WIRE_READER& payload )
+{
+	// the match we watched is over, the server closes the connection next
+	//
+	if ( type == WIRE_LEAVE && wireDone( payload ) )
+	{
+		joined = false;
+		predictor.reset( );
+		return;
+	}
+
+	if ( type != WIRE_UPDATE || !joined )
+		return;
+
+	if ( !decodeUpdate( payload, header, records ) || !applyFrame( replica, replica_seq, header, records.data( ) ) )
+	{
+		requestKeyframe( );
+		return;
+	}
+
+	if ( header.type == FRAME_KEYFRAME )
+		awaiting_keyframe = false;
+
+	input_ack = header.input_ack;
+	predictor.reconcile( replica, input_ack, header.player_slot );
+
+	view = replica;
+	predictor.apply( view );
+
+	if ( on_update_callback )
+		on_update_callback( view, replica_seq );
+}
+
+void TcpConnection::requestKeyframe( )
+{
+	if ( awaiting_keyframe )
+		return;
+
+	awaiting_keyframe = true;
+
+	encodeEmpty( out, WIRE_SYNC );
+	send( );
+}
\ No newline at end of file
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "wire.hpp"
+#include "prediction.hpp"
+
+// client side of the tcp transport: sends the inputs and keeps a replica of the game from the frame stream
+// the own frog is predicted, so what to draw (getView) already shows the moves the server hasn't answered yet
+// nothing runs on its own, the owner calls pump( ) (a ui thread, or a load generator driving many of them)
+//
+class TcpConnection
+{
+private:
+	intptr_t socket = -1;		// see socket.hpp
+
+	bool joined = false;
+	uint32_t pid = 0;			// what the server calls us, not the local process id
+
+	uint64_t bytes_received = 0;
+
+	std::vector<char> in, out;
+	size_t in_offset = 0;
+
+	// rebuilt from the keyframe and deltas the server sends
+	//
+	DATA replica { };
+	uint32_t replica_seq = 0;
+	bool awaiting_keyframe = false;
+
+	FRAME_HEADER header { };
+	std::vector<char> records;
+
+	// the replica with the own frog where the predictor has it
+	//
+	Predictor predictor;
+	DATA view { };
+	uint32_t input_ack = 0;
+
+	std::function<void( const DATA& data, uint32_t seq )> on_update_callback = nullptr;
+
+public:
+	TcpConnection( )
+	{
+
+	}
+
+	~TcpConnection( );
+
+	bool connect( const char* host, uint16_t port );
+
+	void close( );
+
+	bool isConnected( )
+	{
+		return socket != -1;
+	}
+
+	bool isPlaying( )
+	{
+		return joined;
+	}
+
+	// sends the request and waits up to timeout_ms for the answer
+	//
+	bool joinMatch( uint32_t process_pid, GAME_TYPE type, int timeout_ms );
+
+	void leaveMatch( );
+
+	// the move shows in getView( ) as soon as this returns
+	//
+	bool sendMove( FACING direction );
+
+	// reads whatever arrived (waiting up to timeout_ms for something if nothing did) and applies it to the replica
+	// returns false once the connection is gone
+	//
+	bool pump( int timeout_ms );
+
+	const DATA& getReplica( )
+	{
+		return replica;
+	}
+
+	uint32_t getReplicaSeq( )
+	{
+		return replica_seq;
+	}
+
+	const DATA& getView( )
+	{
+		return view;
+	}
+
+	// last input the replica reflects
+	//
+	uint32_t getInputAck( )
+	{
+		return input_ack;
+	}
+
+	const Predictor& getPredictor( )
+	{
+		return predictor;
+	}
+
+	uint32_t getPid( )
+	{
+		return pid;
+	}
+
+	uint64_t getBytesReceived( )
+	{
+		return bytes_received;
+	}
+
+	// called with the view every time a frame was applied
+	//
+	void setOnUpdateCallback( std::function<void( const DATA& data, uint32_t seq )> callback )
+	{
+		on_update_callback = callback;
+	}
+
+	// waits until at least one of the connections has something to read, ready gets their indexes
+	//
+	static int waitAny( TcpConnection* const* connections, size_t count, int timeout_ms, std::vector<size_t>& ready );
+
+private:
+	bool send( );
+
+	bool receive( );
+
+	void onMessage( WIRE_MESSAGE type, WIRE_READER& payload );
+
+	void requestKeyframe( );
+};
\ No newline at end of file
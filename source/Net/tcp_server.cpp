@@ -0,0 +1,603 @@
+#include "tcp_server.hpp"
+#include "socket.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+
+#include <chrono>
+#include <algorithm>
+
+typedef struct TCP_CONNECTION
+{
+	net::socket_t socket = net::invalid_socket;
+	uint32_t pid = 0;
+	int match = 0;
+
+	bool joined = false;
+	bool spectating = false;	// read-only, its moves and its leaving aren't passed on
+	uint32_t closes = 0;		// of its match when it joined, see TcpServer::closeMatch( )
+	bool closing = false;		// disconnect as soon as what is queued is written
+	bool polling_out = false;	// the poller reports it writable, only while out has something left
+
+	std::list<TCP_CONNECTION*>::iterator self;		// in TcpServer::connections
+
+	std::vector<char> in;
+
+	// bytes not taken by the socket yet, a connection with some left skips the next frames
+	//
+	std::vector<char> out;
+	size_t out_offset = 0;
+	std::chrono::steady_clock::time_point out_since { };	// when what is left of out was queued
+
+	// last state sent to the client, deltas are encoded against it
+	//
+	bool synced = false;
+	uint32_t sent_seq = 0;
+	uint32_t sent_ack = 0;
+	DATA sent { };
+} TCP_CONNECTION;
+
+static net::socket_t toSocket( intptr_t socket )
+{
+	return static_cast<net::socket_t>( socket );
+}
+
+TcpServer::TcpServer( int max_players, int max_matches ) : max_players( max_players )
+{
+	max_matches = std::max( 1, max_matches );
+
+	snapshots.resize( max_matches );
+	for ( auto& snapshot : snapshots )
+		snapshot = std::make_unique<SnapshotBuffer<SNAPSHOT>>( );
+
+	members.resize( max_matches );
+	sent_versions.resize( max_matches );
+	closes = std::make_unique<std::atomic<uint32_t>[ ]>( max_matches );
+}
+
+TcpServer::~TcpServer( )
+{
+	stop( );
+}
+
+bool TcpServer::start( const char* address, uint16_t port )
+{
+	if ( running )
+		return false;
+
+	const auto socket = net::listenTcp( address, port, &this->port );
+	if ( socket == net::invalid_socket )
+	{
+		Logger::write( LOG_ERROR, "tcp: could not listen on ", address, ":", port, " (", net::lastError( ), ")" );
+		return false;
+	}
+
+	net::socket_t pair[ 2 ];
+	if ( !net::wakePair( pair ) )
+	{
+		net::closeSocket( socket );
+		return false;
+	}
+
+	// the wake socket and the listener are told apart from the connections by the pointers they were added with
+	//
+	poller = std::make_unique<net::Poller>( );
+	if ( !poller->isOpen( ) || !poller->add( pair[ 0 ], &wake_pair[ 0 ] ) || !poller->add( socket, &listener ) )
+	{
+		Logger::write( LOG_ERROR, "tcp: could not create the poller (", net::lastError( ), ")" );
+
+		poller.reset( );
+		net::closeSocket( socket );
+		net::closeSocket( pair[ 0 ] );
+		net::closeSocket( pair[ 1 ] );
+		return false;
+	}
+
+	listener = static_cast<intptr_t>( socket );
+	wake_pair[ 0 ] = static_cast<intptr_t>( pair[ 0 ] );
+	wake_pair[ 1 ] = static_cast<intptr_t>( pair[ 1 ] );
+
+	running = true;
+	io_thread = std::thread( ioRoutine, this );
+
+	return true;
+}
+
+void TcpServer::stop( )
+{
+	if ( !running.exchange( false ) )
+		return;
+
+	net::wake( toSocket( wake_pair[ 1 ] ) );
+
+	if ( io_thread.joinable( ) )
+		io_thread.join( );
+
+	for ( auto socket : { &listener, &wake_pair[ 0 ], &wake_pair[ 1 ] } )
+	{
+		net::closeSocket( toSocket( *socket ) );
+		*socket = -1;
+	}
+
+	poller.reset( );
+}
+
+bool TcpServer::registerCallback( CLIENT_CALLBACK_TYPE type, PlayerCallback callback )
+{
+	if ( callbacks_map.find( type ) != callbacks_map.end( ) )
+		return false;
+
+	callbacks_map[ type ] = callback;
+	return true;
+}
+
+bool TcpServer::removeCallback( CLIENT_CALLBACK_TYPE type )
+{
+	if ( callbacks_map.find( type ) == callbacks_map.end( ) )
+		return false;
+
+	callbacks_map.erase( type );
+	return true;
+}
+
+void TcpServer::setMatchRouter( MatchRouter router )
+{
+	match_router = router;
+}
+
+void TcpServer::setWriteTimeout( int timeout_ms )
+{
+	write_timeout_ms = timeout_ms;
+}
+
+bool TcpServer::update( int match, uint32_t tick, std::span<const Entity> entities, std::span<const PLAYER_ACK> acks, GAME_STATE state, int time, int level, int width, int height )
+{
+	if ( match < 0 || match >= snapshots.size( ) )
+		return false;
+
+	auto& buffer = *snapshots[ match ];
+
+	{
+		MetricTimer timer( METRIC_SNAPSHOT );
+
+		auto& snapshot = buffer.begin( );
+		if ( !serializeSnapshot( snapshot.data, entities, state, time, level, width, height ) )
+		{
+			buffer.cancel( );
+			return false;
+		}
+
+		serializeAcks( snapshot, acks );
+		snapshot.seq = tick;
+		buffer.publish( );
+	}
+
+	// wake the io loop, a tick that is still queued will pick up this snapshot as well
+	//
+	if ( running && !tick_pending.exchange( true ) )
+		net::wake( toSocket( wake_pair[ 1 ] ) );
+
+	return true;
+}
+
+void TcpServer::closeMatch( int match )
+{
+	if ( match < 0 || match >= snapshots.size( ) )
+		return;
+
+	closes[ match ].fetch_add( 1, std::memory_order_release );
+
+	if ( running && !tick_pending.exchange( true ) )
+		net::wake( toSocket( wake_pair[ 1 ] ) );
+}
+
+void TcpServer::ioRoutine( TcpServer* _this )
+{
+	auto& poller = *_this->poller;
+
+	while ( _this->running )
+	{
+		if ( poller.wait( -1 ) < 0 )
+		{
+			if ( net::wouldBlock( net::lastError( ) ) )
+				continue;
+
+			Logger::write( LOG_ERROR, "tcp: poll failed (", net::lastError( ), ")" );
+			break;
+		}
+
+		for ( const auto& event : poller.getEvents( ) )
+		{
+			if ( event.data == &_this->wake_pair[ 0 ] )
+			{
+				net::drain( toSocket( _this->wake_pair[ 0 ] ) );
+
+				if ( !_this->running )
+					break;
+
+				_this->broadcast( );
+				continue;
+			}
+
+			if ( event.data == &_this->listener )
+			{
+				_this->accept( );
+				continue;
+			}
+
+			const auto connection = static_cast<TCP_CONNECTION*>( event.data );
+
+			if ( connection->socket != net::invalid_socket && event.readable )
+				_this->onReadable( connection );
+
+			if ( connection->socket != net::invalid_socket && event.writable && !_this->flush( connection ) )
+				_this->disconnect( connection );
+		}
+
+		// freed here, the events (and the members of a match) may still have pointed at them above
+		//
+		for ( const auto connection : _this->closed )
+		{
+			auto& match = _this->members[ connection->match ];
+			const auto member = std::find( match.begin( ), match.end( ), connection );
+			if ( member != match.end( ) )
+				match.erase( member );
+
+			_this->connections.erase( connection->self );
+			delete connection;
+		}
+
+		_this->closed.clear( );
+	}
+
+	for ( const auto connection : _this->connections )
+	{
+		_this->disconnect( connection );
+		delete connection;
+	}
+
+	_this->connections.clear( );
+	_this->closed.clear( );
+
+	for ( auto& match : _this->members )
+		match.clear( );
+}
+
+void TcpServer::accept( )
+{
+	while ( true )
+	{
+		const auto socket = net::acceptTcp( toSocket( listener ) );
+		if ( socket == net::invalid_socket )
+			return;
+
+		// a client that stops reading backs up into out after a few frames instead of a default sized kernel buffer
+		//
+		net::setSendBuffer( socket, send_buffer );
+
+		const auto connection = new TCP_CONNECTION( );
+		connection->socket = socket;
+
+		if ( !poller->add( socket, connection ) )
+		{
+			net::closeSocket( socket );
+			delete connection;
+			continue;
+		}
+
+		connection->self = connections.insert( connections.end( ), connection );
+	}
+}
+
+void TcpServer::onReadable( TCP_CONNECTION* connection )
+{
+	char buffer[ 4096 ];
+
+	while ( connection->socket != net::invalid_socket && !connection->closing )
+	{
+		const auto received = net::receiveSome( connection->socket, buffer, sizeof( buffer ) );
+		if ( received < 0 )
+		{
+			disconnect( connection );
+			return;
+		}
+
+		if ( !received )
+			return;
+
+		connection->in.insert( connection->in.end( ), buffer, buffer + received );
+
+		size_t offset = 0;
+		while ( connection->socket != net::invalid_socket && !connection->closing )
+		{
+			WIRE_MESSAGE type;
+			WIRE_READER payload;
+			const auto size = parseMessage( connection->in.data( ) + offset, connection->in.size( ) - offset, type, payload );
+			if ( !size )
+				break;
+
+			if ( size < 0 || !onMessage( connection, type, payload ) )
+			{
+				disconnect( connection );
+				return;
+			}
+
+			offset += size;
+		}
+
+		connection->in.erase( connection->in.begin( ), connection->in.begin( ) + offset );
+	}
+}
+
+// false drops the connection
+//
+bool TcpServer::onMessage( TCP_CONNECTION* connection, WIRE_MESSAGE type, WIRE_READER& payload )
+{
+	if ( !connection->joined )
+	{
+		uint32_t client_pid;
+		GAME_TYPE game_type;
+		if ( type != WIRE_JOIN || !decodeJoin( payload, client_pid, game_type ) )
+			return false;
+
+		bool status = false;
+		int match = 0;
+
+		if ( match_router )
+		{
+			match = match_router( next_pid, game_type );
+			status = match >= 0 && match < members.size( );
+
+			// seated in a match this transport has no slot for, the seat is given back
+			//
+			if ( !status && match >= 0 && game_type != SPECTATOR )
+				invokeCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_LEAVE, next_pid, UP );
+		}
+		else
+		{
+			int num_clients = 0;
+			for ( const auto client : connections )
+				num_clients += client->joined && !client->spectating;
+
+			status = ( game_type == SINGLEPLAYER && num_clients == 0 ) || ( game_type == MULTIPLAYER && num_clients < max_players ) || game_type == SPECTATOR;
+		}
+
+		// joined right away, a failed answer leaves the match again through disconnect( )
+		// the first frame this client gets is a keyframe
+		//
+		if ( status )
+		{
+			connection->pid = next_pid++;
+			connection->match = match;
+			connection->joined = true;
+			connection->spectating = game_type == SPECTATOR;
+			connection->closes = closes[ match ].load( std::memory_order_acquire );
+			connection->synced = false;
+
+			members[ match ].push_back( connection );
+		}
+
+		encodeJoinResult( connection->out, status, connection->pid );
+		if ( !flush( connection ) )
+			return false;
+
+		if ( !status )
+		{
+			connection->closing = true;
+			return connection->out_offset < connection->out.size( );
+		}
+
+		if ( !connection->spectating )
+			invokeCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_JOIN, connection->pid, UP );
+
+		return true;
+	}
+
+	switch ( type )
+	{
+	case WIRE_MOVE:
+	{
+		FACING direction;
+		uint32_t seq;
+		if ( !decodeMove( payload, direction, seq ) )
+			return false;
+
+		if ( !connection->spectating )
+			invokeCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_MOVE, connection->pid, direction, seq );
+
+		return true;
+	}
+	case WIRE_SYNC:
+		connection->synced = false;
+		return true;
+	case WIRE_LEAVE:
+	default:
+		return false;
+	}
+}
+
+void TcpServer::broadcast( )
+{
+	tick_pending = false;
+
+	for ( int match = 0; match < members.size( ); match++ )
+		if ( !members[ match ].empty( ) )
+			broadcast( match );
+}
+
+// writes this tick's frame to every client of the match that took the previous one
+// a slow client simply gets a larger delta on the next tick
+//
+void TcpServer::broadcast( int match )
+{
+	auto& buffer = *snapshots[ match ];
+
+	endSpectators( match );
+
+	// a client that joined after the last frame is still waiting for its keyframe
+	//
+	auto version = buffer.getVersion( );
+	bool waiting = false;
+	for ( const auto connection : members[ match ] )
+		waiting |= !connection->synced;
+
+	if ( version == sent_versions[ match ] && !waiting )
+		return;
+
+	if ( !buffer.read( current, &version ) )
+		return;
+
+	sent_versions[ match ] = version;
+
+	// the close is counted before the next match of the slot publishes anything, a frame of that one
+	// can't reach a spectator of the old one once this saw the count
+	//
+	endSpectators( match );
+
+	const auto tick = current.seq;
+
+	for ( const auto connection : members[ match ] )
+	{
+		if ( connection->socket == net::invalid_socket || connection->closing )
+			continue;
+
+		// still sending the previous frame, this tick is skipped for it
+		// a client that didn't take it within the write timeout stopped reading, it is dropped instead of falling further behind
+		//
+		if ( connection->out_offset < connection->out.size( ) )
+		{
+			Metrics::add( METRIC_TCP_DROPPED );
+
+			if ( write_timeout_ms > 0 && std::chrono::steady_clock::now( ) - connection->out_since > std::chrono::milliseconds( write_timeout_ms ) )
+			{
+				Logger::write( LOG_WARNING, "tcp: client ", connection->pid, " stopped reading, disconnected" );
+				Metrics::add( METRIC_TCP_EVICTED );
+				disconnect( connection );
+			}
+
+			continue;
+		}
+
+		// keyframe on join (or when the client lost track), afterwards only what changed since the last frame
+		// an input the engine took without moving anything still has to be acked
+		//
+		bool changed = true;
+		if ( !connection->synced )
+			encodeKeyframe( current.data, tick, header, records );
+		else if ( tick == connection->sent_seq )
+			continue;
+		else
+			changed = encodeDelta( connection->sent, connection->sent_seq, current.data, tick, header, records );
+
+		fillFrameInput( header, current, connection->pid );
+		if ( !changed && header.input_ack == connection->sent_ack )
+			continue;
+
+		connection->out.clear( );
+		connection->out_offset = 0;
+		connection->out_since = std::chrono::steady_clock::now( );
+		encodeUpdate( connection->out, header, records.data( ) );
+
+		Metrics::add( METRIC_TCP_WRITES );
+
+		if ( !flush( connection ) )
+		{
+			disconnect( connection );
+			continue;
+		}
+
+		connection->sent = current.data;
+		connection->sent_seq = tick;
+		connection->sent_ack = header.input_ack;
+		connection->synced = true;
+	}
+}
+
+// spectators of a match that closed get a leave and are dropped once it is written
+//
+void TcpServer::endSpectators( int match )
+{
+	const auto count = closes[ match ].load( std::memory_order_acquire );
+
+	for ( const auto connection : members[ match ] )
+	{
+		if ( !connection->spectating || !connection->joined || connection->closes == count || connection->socket == net::invalid_socket )
+			continue;
+
+		connection->joined = false;
+		connection->closing = true;
+
+		// a frame still on its way goes out first, the leave is queued behind it
+		//
+		if ( connection->out_offset == connection->out.size( ) )
+		{
+			connection->out.clear( );
+			connection->out_offset = 0;
+			connection->out_since = std::chrono::steady_clock::now( );
+		}
+
+		encodeEmpty( connection->out, WIRE_LEAVE );
+		if ( !flush( connection ) )
+			disconnect( connection );
+	}
+}
+
+// writes as much as the socket takes, the rest goes out when the poller reports it writable
+// it only watches for that while something is left, a socket with room would wake the loop all the time
+//
+bool TcpServer::flush( TCP_CONNECTION* connection )
+{
+	while ( connection->out_offset < connection->out.size( ) )
+	{
+		const auto sent = net::sendSome( connection->socket, connection->out.data( ) + connection->out_offset, connection->out.size( ) - connection->out_offset );
+		if ( sent < 0 )
+			return false;
+
+		if ( !sent )
+		{
+			if ( !connection->polling_out )
+				connection->polling_out = poller->modify( connection->socket, connection, true );
+
+			return true;
+		}
+
+		Metrics::add( METRIC_TCP_BYTES, static_cast<uint64_t>( sent ) );
+		connection->out_offset += sent;
+	}
+
+	connection->out.clear( );
+	connection->out_offset = 0;
+
+	if ( connection->polling_out )
+		connection->polling_out = !poller->modify( connection->socket, connection, false );
+
+	return !connection->closing;
+}
+
+// closes the socket, the connection is freed by the io loop
+//
+void TcpServer::disconnect( TCP_CONNECTION* connection )
+{
+	if ( connection->socket == net::invalid_socket )
+		return;
+
+	if ( connection->joined )
+	{
+		connection->joined = false;
+
+		if ( !connection->spectating )
+			invokeCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_LEAVE, connection->pid, UP );
+	}
+
+	poller->remove( connection->socket );
+	net::closeSocket( connection->socket );
+	connection->socket = net::invalid_socket;
+
+	closed.push_back( connection );
+}
+
+void TcpServer::invokeCallback( CLIENT_CALLBACK_TYPE type, uint32_t pid, FACING direction, uint32_t seq )
+{
+	const auto callback = callbacks_map.find( type );
+	if ( callback != callbacks_map.end( ) && callback->second )
+		callback->second( pid, direction, seq );
+}
\ No newline at end of file
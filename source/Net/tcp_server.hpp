@@ -0,0 +1,146 @@
+#pragma once
+
+#include <map>
+#include <list>
+#include <atomic>
+#include <memory>
+#include <span>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+#include "wire.hpp"
+#include "snapshot.hpp"
+#include "transport.hpp"
+
+struct TCP_CONNECTION;
+
+namespace net
+{
+	class Poller;
+}
+
+// remote players over tcp, same callbacks and frame stream (keyframe, then deltas) as the local pipe
+// every socket is served by a single thread sleeping in epoll (poll where there is none), woken by update( ) once per tick
+// with a match router set, every player is placed in a match and only gets the frames of that one
+//
+class TcpServer
+{
+private:
+	// remote players get ids of their own, so they never collide with the pid of a local client
+	//
+	inline static constexpr uint32_t remote_pid_base = 0x40000000;
+
+	// kernel send buffer of a client, a keyframe and some deltas, so falling behind shows up as skipped frames
+	//
+	inline static constexpr int send_buffer = 32 * 1024;
+
+	int max_players;		// without a router, all players share match 0
+	int write_timeout_ms = 2000;
+
+	std::thread io_thread;
+	std::atomic<bool> running = false;
+
+	// sockets, kept as intptr_t so this header doesn't drag the socket headers in (see socket.hpp)
+	//
+	intptr_t listener = -1;
+	intptr_t wake_pair[ 2 ] = { -1, -1 };
+	uint16_t port = 0;
+
+	// one per match, written by the thread that ticked it, read by the io thread without either of them waiting on the other
+	//
+	std::vector<std::unique_ptr<SnapshotBuffer<SNAPSHOT>>> snapshots;
+
+	// bumped by closeMatch( ), a spectator that joined under another count watches a match that is gone
+	//
+	std::unique_ptr<std::atomic<uint32_t>[ ]> closes;
+
+	std::atomic<bool> tick_pending = false;
+
+	// only touched by the io thread
+	//
+	SNAPSHOT current { };
+	FRAME_HEADER header { };
+	std::vector<char> records;
+	std::unique_ptr<net::Poller> poller;
+	std::list<TCP_CONNECTION*> connections;
+	std::vector<TCP_CONNECTION*> closed;		// disconnected, freed at the end of the wake that closed them
+	uint32_t next_pid = remote_pid_base;
+
+	// joined connections of every match, and the last snapshot version sent to them
+	//
+	std::vector<std::vector<TCP_CONNECTION*>> members;
+	std::vector<uint64_t> sent_versions;
+
+	std::map<CLIENT_CALLBACK_TYPE, PlayerCallback> callbacks_map;
+	MatchRouter match_router;
+
+public:
+	TcpServer( int max_players = 2, int max_matches = 1 );
+
+	~TcpServer( );
+
+	// port 0 picks a free one, see getPort( )
+	//
+	bool start( const char* address, uint16_t port );
+
+	void stop( );
+
+	bool isRunning( )
+	{
+		return running;
+	}
+
+	uint16_t getPort( )
+	{
+		return port;
+	}
+
+	bool registerCallback( CLIENT_CALLBACK_TYPE type, PlayerCallback callback );
+
+	bool removeCallback( CLIENT_CALLBACK_TYPE type );
+
+	// set before start( ), the router decides who may join (max_players no longer applies)
+	//
+	void setMatchRouter( MatchRouter router );
+
+	// set before start( ), a client still sending a frame after this long is disconnected on the next tick
+	// 0 keeps it however far behind it is
+	//
+	void setWriteTimeout( int timeout_ms );
+
+	// thread safe across matches, the frames of one match have to come from one thread at a time
+	//
+	bool update( int match, uint32_t tick, std::span<const Entity> entities, std::span<const PLAYER_ACK> acks, GAME_STATE state, int time, int level, int width, int height );
+
+	bool update( uint32_t tick, std::span<const Entity> entities, std::span<const PLAYER_ACK> acks, GAME_STATE state, int time, int level, int width, int height )
+	{
+		return update( 0, tick, entities, acks, state, time, level, width, height );
+	}
+
+	// the match is over, its spectators are told so and dropped before the slot runs another one
+	// call it from the thread that ticks the matches, before the next update( ) of that slot
+	//
+	void closeMatch( int match );
+
+private:
+	static void ioRoutine( TcpServer* _this );
+
+	void accept( );
+
+	void onReadable( TCP_CONNECTION* connection );
+
+	bool onMessage( TCP_CONNECTION* connection, WIRE_MESSAGE type, WIRE_READER& payload );
+
+	void broadcast( );
+
+	void broadcast( int match );
+
+	void endSpectators( int match );
+
+	bool flush( TCP_CONNECTION* connection );
+
+	void disconnect( TCP_CONNECTION* connection );
+
+	void invokeCallback( CLIENT_CALLBACK_TYPE type, uint32_t pid, FACING direction, uint32_t seq = 0 );
+};
\ No newline at end of file
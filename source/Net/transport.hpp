@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+
+#include "protocol.hpp"
+#include "entity/types.hpp"
+
+// what every player transport (the local pipe, tcp) reports to the server
+//
+typedef enum
+{
+	ON_PLAYER_JOIN,
+	ON_PLAYER_MOVE,
+	ON_PLAYER_LEAVE
+} CLIENT_CALLBACK_TYPE;
+
+// seq numbers the inputs of a player (0 for join / leave), the engine hands it back in the frames
+//
+using PlayerCallback = std::function<void( uint32_t pid, FACING direction, uint32_t seq )>;
+
+// picks the match a joining player goes to, -1 declines the join
+//
+using MatchRouter = std::function<int( uint32_t pid, GAME_TYPE type )>;
\ No newline at end of file
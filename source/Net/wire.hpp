@@ -0,0 +1,294 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include "protocol.hpp"
+#include "transport.hpp"
+
+// byte stream format of the tcp transport, independent of the host endianness and struct layout
+// every message is a u32 length (of what follows it) and a u8 type, then the payload, all little endian
+//
+// entities are packed to u8 type, u8 direction, i16 x, i16 y and delta records prefix them with a u16 slot,
+// 160 entities are ~1KB on the wire against the 2.6KB of raw ENTITY structs
+//
+#define WIRE_LENGTH_SIZE        4
+#define WIRE_ENTITY_SIZE        6
+#define WIRE_DELTA_SIZE         ( 2 + WIRE_ENTITY_SIZE )
+#define WIRE_HEADER_SIZE        33
+
+// a delta of every cell of the largest board, anything longer is garbage and the connection gets dropped
+//
+#define WIRE_MAX_MESSAGE        ( 1 + WIRE_HEADER_SIZE + MAX_BOARD_CELLS * WIRE_DELTA_SIZE )
+
+enum WIRE_MESSAGE : uint8_t
+{
+	WIRE_JOIN = 1,		// client -> server: u32 pid, u8 game type
+	WIRE_MOVE,			// client -> server: u8 direction, u32 input seq
+	WIRE_SYNC,			// client -> server: the replica is lost, next frame must be a keyframe
+	WIRE_LEAVE,			// client -> server, and server -> spectator once the match it watched is over
+	WIRE_JOIN_RESULT,	// server -> client: u8 status, u32 id the server knows the player by
+	WIRE_UPDATE			// server -> client: frame header, then its records
+};
+
+typedef struct
+{
+	const char* data;
+	size_t size;
+	size_t offset;
+	bool ok;			// cleared by any read past the end, checked once at the end of a decode
+} WIRE_READER;
+
+inline void wirePut8( std::vector<char>& out, uint8_t value )
+{
+	out.push_back( static_cast<char>( value ) );
+}
+
+inline void wirePut16( std::vector<char>& out, uint16_t value )
+{
+	wirePut8( out, static_cast<uint8_t>( value ) );
+	wirePut8( out, static_cast<uint8_t>( value >> 8 ) );
+}
+
+inline void wirePut32( std::vector<char>& out, uint32_t value )
+{
+	wirePut16( out, static_cast<uint16_t>( value ) );
+	wirePut16( out, static_cast<uint16_t>( value >> 16 ) );
+}
+
+inline uint8_t wireGet8( WIRE_READER& reader )
+{
+	if ( reader.offset + 1 > reader.size )
+	{
+		reader.ok = false;
+		return 0;
+	}
+
+	return static_cast<uint8_t>( reader.data[ reader.offset++ ] );
+}
+
+inline uint16_t wireGet16( WIRE_READER& reader )
+{
+	const uint16_t low = wireGet8( reader );
+	return static_cast<uint16_t>( low | wireGet8( reader ) << 8 );
+}
+
+inline uint32_t wireGet32( WIRE_READER& reader )
+{
+	const uint32_t low = wireGet16( reader );
+	return low | static_cast<uint32_t>( wireGet16( reader ) ) << 16;
+}
+
+// returns the offset of the message, endMessage patches its length once the payload is written
+//
+inline size_t beginMessage( std::vector<char>& out, WIRE_MESSAGE type )
+{
+	const auto offset = out.size( );
+	wirePut32( out, 0 );
+	wirePut8( out, type );
+
+	return offset;
+}
+
+inline void endMessage( std::vector<char>& out, size_t offset )
+{
+	const auto length = static_cast<uint32_t>( out.size( ) - offset - WIRE_LENGTH_SIZE );
+	for ( int i = 0; i < WIRE_LENGTH_SIZE; i++ )
+		out[ offset + i ] = static_cast<char>( length >> ( i * 8 ) );
+}
+
+// looks for a complete message at the start of data
+// returns its size (payload points inside data), 0 if more bytes are needed and -1 if the stream is corrupt
+//
+inline long parseMessage( const char* data, size_t size, WIRE_MESSAGE& type, WIRE_READER& payload )
+{
+	if ( size < WIRE_LENGTH_SIZE )
+		return 0;
+
+	WIRE_READER reader { data, size, 0, true };
+	const auto length = wireGet32( reader );
+	if ( !length || length > WIRE_MAX_MESSAGE )
+		return -1;
+
+	if ( size < WIRE_LENGTH_SIZE + length )
+		return 0;
+
+	type = static_cast<WIRE_MESSAGE>( wireGet8( reader ) );
+	payload = { data + WIRE_LENGTH_SIZE + 1, length - 1, 0, true };
+
+	return WIRE_LENGTH_SIZE + length;
+}
+
+// a decode only succeeds if the payload was exactly consumed
+//
+inline bool wireDone( const WIRE_READER& reader )
+{
+	return reader.ok && reader.offset == reader.size;
+}
+
+inline void encodeJoin( std::vector<char>& out, uint32_t pid, GAME_TYPE type )
+{
+	const auto offset = beginMessage( out, WIRE_JOIN );
+	wirePut32( out, pid );
+	wirePut8( out, static_cast<uint8_t>( type ) );
+	endMessage( out, offset );
+}
+
+inline bool decodeJoin( WIRE_READER& reader, uint32_t& pid, GAME_TYPE& type )
+{
+	pid = wireGet32( reader );
+	const auto game_type = wireGet8( reader );
+	type = static_cast<GAME_TYPE>( game_type );
+
+	return wireDone( reader ) && game_type <= SPECTATOR;
+}
+
+inline void encodeMove( std::vector<char>& out, FACING direction, uint32_t seq )
+{
+	const auto offset = beginMessage( out, WIRE_MOVE );
+	wirePut8( out, static_cast<uint8_t>( direction ) );
+	wirePut32( out, seq );
+	endMessage( out, offset );
+}
+
+inline bool decodeMove( WIRE_READER& reader, FACING& direction, uint32_t& seq )
+{
+	const auto value = wireGet8( reader );
+	direction = static_cast<FACING>( value );
+	seq = wireGet32( reader );
+
+	return wireDone( reader ) && value <= RIGHT;
+}
+
+// messages without a payload (WIRE_SYNC, WIRE_LEAVE)
+//
+inline void encodeEmpty( std::vector<char>& out, WIRE_MESSAGE type )
+{
+	endMessage( out, beginMessage( out, type ) );
+}
+
+inline void encodeJoinResult( std::vector<char>& out, bool status, uint32_t pid )
+{
+	const auto offset = beginMessage( out, WIRE_JOIN_RESULT );
+	wirePut8( out, status );
+	wirePut32( out, pid );
+	endMessage( out, offset );
+}
+
+inline bool decodeJoinResult( WIRE_READER& reader, bool& status, uint32_t& pid )
+{
+	status = wireGet8( reader ) != 0;
+	pid = wireGet32( reader );
+	return wireDone( reader );
+}
+
+inline void wirePutEntity( std::vector<char>& out, const ENTITY& entity )
+{
+	wirePut8( out, static_cast<uint8_t>( entity.type ) );
+	wirePut8( out, static_cast<uint8_t>( entity.direction ) );
+	wirePut16( out, static_cast<uint16_t>( entity.pos_x ) );
+	wirePut16( out, static_cast<uint16_t>( entity.pos_y ) );
+}
+
+inline bool wireGetEntity( WIRE_READER& reader, ENTITY& entity )
+{
+	const auto type = wireGet8( reader );
+	const auto direction = wireGet8( reader );
+
+	entity.type = static_cast<ENTITY_TYPE>( type );
+	entity.direction = static_cast<FACING>( direction );
+	entity.pos_x = static_cast<int16_t>( wireGet16( reader ) );
+	entity.pos_y = static_cast<int16_t>( wireGet16( reader ) );
+
+	return type < ENTITY_TYPE_MAX && direction <= RIGHT;
+}
+
+// header and records as encodeKeyframe / encodeDelta produced them
+//
+inline void encodeUpdate( std::vector<char>& out, const FRAME_HEADER& header, const char* records )
+{
+	const auto offset = beginMessage( out, WIRE_UPDATE );
+
+	wirePut8( out, static_cast<uint8_t>( header.version ) );
+	wirePut8( out, static_cast<uint8_t>( header.type ) );
+	wirePut32( out, header.seq );
+	wirePut32( out, header.base_seq );
+	wirePut8( out, static_cast<uint8_t>( header.state ) );
+	wirePut32( out, static_cast<uint32_t>( header.time ) );
+	wirePut32( out, static_cast<uint32_t>( header.level ) );
+	wirePut16( out, static_cast<uint16_t>( header.width ) );
+	wirePut16( out, static_cast<uint16_t>( header.height ) );
+	wirePut16( out, static_cast<uint16_t>( header.num_entities ) );
+	wirePut16( out, static_cast<uint16_t>( header.num_records ) );
+	wirePut32( out, header.input_ack );
+	wirePut16( out, static_cast<uint16_t>( header.player_slot ) );
+
+	for ( int i = 0; i < header.num_records; i++ )
+	{
+		if ( header.type == FRAME_KEYFRAME )
+		{
+			ENTITY entity;
+			memcpy( &entity, records + i * sizeof( ENTITY ), sizeof( ENTITY ) );
+			wirePutEntity( out, entity );
+			continue;
+		}
+
+		ENTITY_DELTA delta;
+		memcpy( &delta, records + i * sizeof( ENTITY_DELTA ), sizeof( ENTITY_DELTA ) );
+		wirePut16( out, static_cast<uint16_t>( delta.slot ) );
+		wirePutEntity( out, delta.entity );
+	}
+
+	endMessage( out, offset );
+}
+
+// unpacks the records into the in memory layout applyFrame expects
+// records is reused between calls, so a steady stream doesn't allocate
+//
+inline bool decodeUpdate( WIRE_READER& reader, FRAME_HEADER& header, std::vector<char>& records )
+{
+	header.version = wireGet8( reader );
+	const auto type = wireGet8( reader );
+	header.type = static_cast<FRAME_TYPE>( type );
+	header.seq = wireGet32( reader );
+	header.base_seq = wireGet32( reader );
+	const auto state = wireGet8( reader );
+	header.state = static_cast<GAME_STATE>( state );
+	header.time = static_cast<int32_t>( wireGet32( reader ) );
+	header.level = static_cast<int32_t>( wireGet32( reader ) );
+	header.width = wireGet16( reader );
+	header.height = wireGet16( reader );
+	header.num_entities = wireGet16( reader );
+	header.num_records = wireGet16( reader );
+	header.input_ack = wireGet32( reader );
+	header.player_slot = static_cast<int16_t>( wireGet16( reader ) );
+
+	if ( !reader.ok || type > FRAME_DELTA || state >= GAME_STATE_MAX || header.num_records > MAX_BOARD_CELLS )
+		return false;
+
+	const auto record_size = header.type == FRAME_KEYFRAME ? sizeof( ENTITY ) : sizeof( ENTITY_DELTA );
+	records.resize( header.num_records * record_size );
+
+	for ( int i = 0; i < header.num_records; i++ )
+	{
+		if ( header.type == FRAME_KEYFRAME )
+		{
+			ENTITY entity;
+			if ( !wireGetEntity( reader, entity ) )
+				return false;
+
+			memcpy( records.data( ) + i * sizeof( ENTITY ), &entity, sizeof( ENTITY ) );
+			continue;
+		}
+
+		ENTITY_DELTA delta;
+		delta.slot = wireGet16( reader );
+		if ( !wireGetEntity( reader, delta.entity ) )
+			return false;
+
+		memcpy( records.data( ) + i * sizeof( ENTITY_DELTA ), &delta, sizeof( ENTITY_DELTA ) );
+	}
+
+	return wireDone( reader );
+}
\ No newline at end of file
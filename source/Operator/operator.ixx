@@ -4,6 +4,7 @@ module;
 //
 #if __INTELLISENSE__
 #include <string>
+#include <vector>
 #include <Windows.h>
 #endif
 
@@ -11,6 +12,7 @@ export module op;
 
 #ifndef __INTELLISENSE__
 import <string>;
+import <vector>;
 import <Windows.h>;
 #endif
 
@@ -43,7 +45,8 @@ public:
 			} );
 
 		DATA data;
-		if ( !pserver->getData( &data ) )
+		std::vector<ENTITY> entities;
+		if ( !pserver->getData( &data, entities ) )
 		{
 			console::error( TEXT( "getData failed" ) );
 
@@ -141,11 +144,9 @@ private:
 		if ( pui == nullptr )
 			pui = new UI( ptr_data->width, 20, ptr_data->width, ptr_data->height );
 
-		TCHAR buffer[ 10 ][ 20 ];
-
-		for ( int i = 0; i < ptr_data->height; i++ )
-			for ( int j = 0; j < ptr_data->width; j++ )
-				buffer[ i ][ j ] = TEXT( '_' );
+		// one line of the board per string, as large as the board is
+		//
+		std::vector<console::tstring> lines( ptr_data->height, console::tstring( ptr_data->width, TEXT( '_' ) ) );
 
 		for ( int i = 0; i < ptr_data->num_entities; i++ )
 		{
@@ -161,29 +162,19 @@ private:
 			switch ( entity.type )
 			{
 			case ENTITY_TYPE::ENTITY_TYPE_CAR:
-				buffer[ entity.pos_y ][ entity.pos_x ] = TEXT( 'C' );
+				lines[ entity.pos_y ][ entity.pos_x ] = TEXT( 'C' );
 				break;
 			case ENTITY_TYPE::ENTITY_TYPE_OBSTACLE:
-				buffer[ entity.pos_y ][ entity.pos_x ] = TEXT( 'O' );
+				lines[ entity.pos_y ][ entity.pos_x ] = TEXT( 'O' );
 				break;
 			case ENTITY_TYPE::ENTITY_TYPE_FROG:
-				buffer[ entity.pos_y ][ entity.pos_x ] = TEXT( 'F' );
+				lines[ entity.pos_y ][ entity.pos_x ] = TEXT( 'F' );
 				break;
 			default:
 				break;
 			}
 		}
 
-		std::vector<console::tstring> lines;
-		for ( int i = 0; i < ptr_data->height; i++ )
-		{
-			console::tstring line = TEXT( "" );
-			for ( int j = 0; j < ptr_data->width; j++ )
-				line.push_back( buffer[ i ][ j ] );
-
-			lines.push_back( line );
-		}
-
 		pui->printGame( lines );
 	}
 
@@ -3,6 +3,7 @@ module;
 // workaround to intellisense that might be not as smart as we thought
 //
 #if __INTELLISENSE__
+#include <vector>
 #include <Windows.h>
 #include <functional>
 #endif
@@ -10,14 +11,13 @@ module;
 export module server;
 
 #ifndef __INTELLISENSE__
+import <vector>;
 import <Windows.h>;
 import <functional>;
 #endif
 
 import console;
 
-#define MAX_ENTITIES    160  // 10 - 2 = 8, 8 * 20 = 160
-
 export enum COMMAND_TYPE
 {
 	INFO,
@@ -80,7 +80,7 @@ enum FACING
 	RIGHT
 };
 
-typedef struct
+export typedef struct
 {
 	ENTITY_TYPE type;
 	FACING direction;
@@ -98,13 +98,16 @@ enum GAME_STATE
 	GAME_STATE_MAX
 };
 
+// a frame as the Dll hands it over, entities points to num_entities of them
+// in an update the entities belong to the Dll and are only valid during the callback
+//
 export typedef struct
 {
 	GAME_STATE state;
 	int time, level;
 	int width, height;
 	int num_entities;
-	ENTITY entities[ MAX_ENTITIES ];
+	ENTITY* entities;
 } DATA;
 
 enum EVENT_TYPE
@@ -226,9 +229,27 @@ public:
 		return sendcommand_fn ? sendcommand_fn( command_info, 0 ) : false;
 	}
 
-	bool getData( DATA* ptr_data )
+	// the latest frame, entities grows to whatever the board has and ptr_data points into it
+	//
+	bool getData( DATA* ptr_data, std::vector<ENTITY>& entities )
 	{
-		return ptr_data && getdata_fn ? getdata_fn( ptr_data ) : false;
+		if ( !ptr_data || !getdata_fn )
+			return false;
+
+		while ( true )
+		{
+			ptr_data->num_entities = static_cast<int>( entities.size( ) );
+			ptr_data->entities = entities.data( );
+			if ( getdata_fn( ptr_data ) )
+				return true;
+
+			// the Dll leaves the number of entities it needs, anything else is a failure
+			//
+			if ( ptr_data->num_entities <= static_cast<int>( entities.size( ) ) )
+				return false;
+
+			entities.resize( ptr_data->num_entities );
+		}
 	}
 
 	bool setOnGameUpdate( OnGameUpdateFn callback )
@@ -1,13 +1,21 @@
 module;
 
+#include "metrics.hpp"
+#include "protocol.hpp"
+#include "snapshot.hpp"
+#include "transport.hpp"
 #include "entity/mentity.hpp"
 
 // workaround to intellisense that might be not as smart as we thought
 //
 #if __INTELLISENSE__
 #include <map>
+#include <list>
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <Windows.h>
+#include <algorithm>
 #include <functional>
 #endif
 
@@ -15,29 +23,25 @@ export module client;
 
 #ifndef __INTELLISENSE__
 import <map>;
+import <list>;
+import <atomic>;
+import <memory>;
 import <vector>;
 import <Windows.h>;
+import <algorithm>;
 import <functional>;
 #endif
 
 import op;
 import console;
-import settings;
-
-#define MAX_ENTITIES    160  // 10 - 2 = 8, 8 * 20 = 160
-
-export typedef enum
-{
-	SINGLEPLAYER,
-	MULTIPLAYER
-} GAME_TYPE;
 
 export typedef enum
 {
 	MOVE,
 	JOIN,
 	LEAVE,
-	UPDATE
+	UPDATE,
+	SYNC
 } GAME_INFO_TYPE;
 
 export typedef struct
@@ -50,6 +54,7 @@ export typedef struct
 		struct
 		{
 			FACING direction;
+			uint32_t seq;		// handed back in the frames as input_ack
 		} move;
 
 		struct
@@ -65,64 +70,170 @@ export typedef struct
 
 	union
 	{
-		DATA data;
+		FRAME_HEADER frame;		// UPDATE, followed by frame.num_records records
 		bool status;
 	};
 } GAME_PIPE_OUT;
 
-class Client;
+typedef enum
+{
+	IO_ACCEPT,
+	IO_READ,
+	IO_WRITE
+} IO_TYPE;
+
+struct CONNECTION;
 
+// overlapped has to stay the first member, completions are mapped back to their context through it
+//
 typedef struct
 {
-	Client* _this;
-	HANDLE h_pipe;
-	DWORD pid;
-} CLIENT_INFO;
+	OVERLAPPED overlapped;
+	IO_TYPE type;
+	CONNECTION* connection;
+} IO_CONTEXT;
 
-export typedef enum
+typedef struct CONNECTION
 {
-	ON_PLAYER_JOIN,
-	ON_PLAYER_MOVE,
-	ON_PLAYER_LEAVE
-} CLIENT_CALLBACK_TYPE;
-
-export typedef struct
+	HANDLE h_pipe = nullptr;
+	DWORD pid = 0;
+	int match = 0;
+
+	bool joined = false;
+	bool spectating = false;	// read-only, fed the frames its match encodes once for all spectators
+	bool closing = false;		// disconnect as soon as the pending write is done
+	bool ending = false;		// its match closed, a leave goes out once the write in flight is done
+	uint32_t closes = 0;		// of its match when it joined, see closeMatch( )
+	int pending = 0;			// operations the completion port still owes a completion for
+
+	IO_CONTEXT accept_io { }, read_io { }, write_io { };
+
+	GAME_PIPE_IN in { };
+	DWORD in_bytes = 0;
+
+	bool writing = false;
+	ULONGLONG write_since = 0;		// when the pending write was issued
+	std::vector<char> out;
+	std::shared_ptr<std::vector<char>> frame;		// written instead of out, held until the write completes
+
+	// last state sent to the client, deltas are encoded against it
+	//
+	bool synced = false;
+	uint32_t sent_seq = 0;
+	uint32_t sent_ack = 0;
+	DATA sent { };
+
+	CLIENT_METRICS metrics { };
+} CONNECTION;
+
+// the spectators of a match and the last frame they were sent
+// its keyframe and its delta are encoded at most once per tick, every spectator write shares one of the two
+//
+typedef struct AUDIENCE
 {
-	DWORD pid;
-	HANDLE h_thread;
-	HANDLE h_pipe;
-} CLIENT;
+	std::vector<CONNECTION*> viewers;
+
+	bool started = false;
+	DATA data { };
+	uint32_t seq = 0;
 
+	uint32_t base_seq = 0;										// the frame the delta applies on top of
+	std::shared_ptr<std::vector<char>> keyframe, delta;			// of seq, empty until a spectator needs them
+
+	uint32_t closes = 0;		// of its match as of the frames above
+} AUDIENCE;
+
+// every client connection is served by a single thread waiting on an I/O completion port
+// reads complete as requests arrive, and the frames are written once per tick when update( ) wakes the loop
+// with a match router set, every player is placed in a match and only gets the frames of that one
+//
 export class Client
 {
 private:
-	inline static constexpr auto num_instances = 2;
+	inline static constexpr auto max_players = 2;		// without a router, all players share match 0
 
 	inline static constexpr auto game_pipe = TEXT( "\\\\.\\pipe\\CRR_PIPE_GAME" );
 
 	inline static constexpr auto close_event = TEXT( "Local\\CRR_SERVER_CLOSE_EVENT" );
 
+	inline static constexpr ULONG_PTR key_io = 0;
+	inline static constexpr ULONG_PTR key_tick = 1;
+	inline static constexpr ULONG_PTR key_exit = 2;
+
 	HANDLE h_thread = nullptr;
 	HANDLE h_event = nullptr;
+	HANDLE h_iocp = nullptr;
 
-	DATA data { };
+	// one per match, written by the thread that ticked it, read by the io thread without either of them waiting on the other
+	//
+	std::vector<std::unique_ptr<SnapshotBuffer<SNAPSHOT>>> snapshots;
 
-	std::vector<CLIENT> client_threads;
+	// bumped by closeMatch( ), a spectator that joined under another count watches a match that is gone
+	//
+	std::unique_ptr<std::atomic<uint32_t>[ ]> closes;
 
-	std::map<CLIENT_CALLBACK_TYPE, std::function<void(DWORD pid, FACING direction)>> callbacks_map;
+	std::atomic<bool> tick_pending = false;
+
+	// what every joined client was sent, republished by the io thread after each tick it wrote
+	//
+	SnapshotBuffer<std::vector<CLIENT_METRICS>> client_metrics;
+
+	// only touched by the io thread
+	//
+	SNAPSHOT current { };
+	std::vector<char> records;
+	std::list<CONNECTION*> connections;
+	CONNECTION* listening = nullptr;
+
+	// joined connections of every match, and the last snapshot version sent to them
+	//
+	std::vector<std::vector<CONNECTION*>> members;
+	std::vector<uint64_t> sent_versions;
+
+	// any number of them per match, not counted as players
+	//
+	std::vector<AUDIENCE> audiences;
+	std::vector<std::shared_ptr<std::vector<char>>> frames;		// reused once no write holds them anymore
+
+	std::map<CLIENT_CALLBACK_TYPE, PlayerCallback> callbacks_map;
+	MatchRouter match_router;
+
+	int write_timeout_ms = 2000;
 
 public:
-	Client( )
+	Client( int max_matches = 1 )
 	{
 		console::log( TEXT( "Client Constructor" ) );
 
+		max_matches = max_matches > 1 ? max_matches : 1;
+
+		snapshots.resize( max_matches );
+		for ( auto& snapshot : snapshots )
+			snapshot = std::make_unique<SnapshotBuffer<SNAPSHOT>>( );
+
+		members.resize( max_matches );
+		sent_versions.resize( max_matches );
+		audiences.resize( max_matches );
+		closes = std::make_unique<std::atomic<uint32_t>[ ]>( max_matches );
+
 		h_event = CreateEvent( nullptr, true, false, close_event );
 		if ( !h_event )
 			return;
 
-		h_thread = CreateThread( nullptr, NULL, reinterpret_cast<LPTHREAD_START_ROUTINE>( listenerRoutine ), this, NULL, nullptr );
+		h_iocp = CreateIoCompletionPort( INVALID_HANDLE_VALUE, nullptr, NULL, 1 );
+		if ( !h_iocp )
+		{
+			CloseHandle( h_event );
+			h_event = nullptr;
+			return;
+		}
+
+		h_thread = CreateThread( nullptr, NULL, reinterpret_cast<LPTHREAD_START_ROUTINE>( ioRoutine ), this, NULL, nullptr );
 		if ( !h_thread )
 		{
+			CloseHandle( h_iocp );
+			h_iocp = nullptr;
+
 			CloseHandle( h_event );
 			h_event = nullptr;
 			return;
@@ -136,19 +247,19 @@ public:
 
 		if ( h_thread )
 		{
-			if ( getStatus( h_thread ) == -1 && WaitForSingleObjectEx( h_thread, 200, false ) == WAIT_TIMEOUT )
+			PostQueuedCompletionStatus( h_iocp, 0, key_exit, nullptr );
+
+			if ( getStatus( h_thread ) == -1 && WaitForSingleObjectEx( h_thread, 500, false ) == WAIT_TIMEOUT )
 					TerminateThread( h_thread, 0 );
 
 			CloseHandle( h_thread );
 			h_thread = nullptr;
 		}
 
-		for ( const auto client : client_threads )
+		if ( h_iocp )
 		{
-			if ( getStatus( client.h_thread ) == -1 )
-				WaitForSingleObjectEx( client.h_thread, INFINITE, false );
-
-			CloseHandle( client.h_thread );
+			CloseHandle( h_iocp );
+			h_iocp = nullptr;
 		}
 
 		if ( h_event )
@@ -157,8 +268,6 @@ public:
 			h_event = nullptr;
 		}
 
-		client_threads.clear( );
-
 		console::log( TEXT( "Client Destructor" ) );
 	}
 
@@ -167,7 +276,7 @@ public:
 		return h_event && getStatus( h_thread ) == -1;
 	}
 
-	bool registerCallback( CLIENT_CALLBACK_TYPE type, std::function<void( DWORD pid, FACING direction )> callback )
+	bool registerCallback( CLIENT_CALLBACK_TYPE type, PlayerCallback callback )
 	{
 		if ( callbacks_map.find( type ) != callbacks_map.end( ) )
 			return false;
@@ -185,250 +294,791 @@ public:
 		return true;
 	}
 
-	bool update( const std::vector<Entity*>& entities, GAME_STATE state, int time, int level, int width, int height )
+	// set before the first client connects, the router decides who may join (max_players no longer applies)
+	//
+	void setMatchRouter( MatchRouter router )
 	{
-		data.time = time;
-		data.state = state;
-		data.level = level;
-		data.width = width;
-		data.height = height;
-		data.num_entities = 0;
-		for ( auto& entity : entities )
-		{
-			auto entity_data = &data.entities[ data.num_entities++ ];
+		match_router = router;
+	}
+
+	// set before the first client connects, a client still reading a frame after this long is disconnected on the next tick
+	// 0 keeps it however far behind it is
+	//
+	void setWriteTimeout( int timeout_ms )
+	{
+		write_timeout_ms = timeout_ms;
+	}
+
+	bool update( uint32_t tick, std::span<const Entity> entities, std::span<const PLAYER_ACK> acks, GAME_STATE state, int time, int level, int width, int height )
+	{
+		return update( 0, tick, entities, acks, state, time, level, width, height );
+	}
 
-			auto pos = entity->getPosition( );
-			entity_data->pos_x = pos.first;
-			entity_data->pos_y = pos.second;
+	// thread safe across matches, the frames of one match have to come from one thread at a time
+	//
+	bool update( int match, uint32_t tick, std::span<const Entity> entities, std::span<const PLAYER_ACK> acks, GAME_STATE state, int time, int level, int width, int height )
+	{
+		if ( match < 0 || match >= snapshots.size( ) )
+			return false;
 
-			auto mentity = dynamic_cast<MovingEntity*>( entity );
-			entity_data->direction = mentity ? mentity->getFacingDirection( ) : UP;
+		auto& buffer = *snapshots[ match ];
 
-			const auto type = entity->getType( );
-			if ( type >= ENTITY_TYPE::ENTITY_TYPE_OBSTACLE && type < ENTITY_TYPE::ENTITY_TYPE_MAX )
-				entity_data->type = type;
-			else
+		{
+			MetricTimer timer( METRIC_SNAPSHOT );
+
+			auto& snapshot = buffer.begin( );
+			if ( !serializeSnapshot( snapshot.data, entities, state, time, level, width, height ) )
 			{
-				console::error( "update failed: Invalid entity" );
+				buffer.cancel( );
+				console::error( "update failed: Invalid snapshot" );
 				return false;
 			}
+
+			serializeAcks( snapshot, acks );
+			snapshot.seq = tick;
+			buffer.publish( );
 		}
 
+		// wake the io loop, a tick that is still queued will pick up this snapshot as well
+		//
+		if ( h_iocp && !tick_pending.exchange( true ) )
+			PostQueuedCompletionStatus( h_iocp, 0, key_tick, nullptr );
+
 		return true;
 	}
 
+	// the match is over, its spectators are told so and dropped before the slot runs another one
+	// call it from the thread that ticks the matches, before the next update( ) of that slot
+	//
+	void closeMatch( int match )
+	{
+		if ( match < 0 || match >= snapshots.size( ) )
+			return;
+
+		closes[ match ].fetch_add( 1, std::memory_order_release );
+
+		if ( h_iocp && !tick_pending.exchange( true ) )
+			PostQueuedCompletionStatus( h_iocp, 0, key_tick, nullptr );
+	}
+
+	// safe from any thread, the clients as of the last tick written to them
+	//
+	std::vector<CLIENT_METRICS> getClientMetrics( )
+	{
+		std::vector<CLIENT_METRICS> metrics;
+		client_metrics.read( metrics );
+
+		return metrics;
+	}
+
 private:
-	static DWORD WINAPI listenerRoutine( Client* _this )
+	static DWORD WINAPI ioRoutine( Client* _this )
 	{
 		if ( !_this )
 			return 1;
 
-		DWORD bytes = NULL;
-		DWORD ret_cause = NULL;
-		while ( ( ret_cause = WaitForSingleObjectEx( _this->h_event, settings::tick_ms, false ) ) == WAIT_TIMEOUT )
+		_this->listen( );
+
+		while ( true )
 		{
-			if ( _this->client_threads.size( ) == num_instances )
-				continue;
+			DWORD bytes = NULL;
+			ULONG_PTR key = NULL;
+			OVERLAPPED* poverlapped = nullptr;
+			const bool success = GetQueuedCompletionStatus( _this->h_iocp, &bytes, &key, &poverlapped, INFINITE );
 
-			const auto h_pipe = CreateNamedPipe( game_pipe, PIPE_ACCESS_DUPLEX, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
-				PIPE_UNLIMITED_INSTANCES, sizeof( GAME_PIPE_OUT ), sizeof( GAME_PIPE_IN ), NULL, nullptr );
-			if ( h_pipe == INVALID_HANDLE_VALUE )
-			{
-				if ( GetLastError( ) != ERROR_PIPE_BUSY )
-					console::log( TEXT( "CreateNamedPipe failed: " ), GetLastError( ) );
+			if ( key == key_exit )
+				break;
 
+			if ( key == key_tick )
+			{
+				_this->broadcast( );
 				continue;
 			}
 
-			if ( !ConnectNamedPipe( h_pipe, nullptr ) )
+			if ( !poverlapped )
 			{
-				console::log( TEXT( "ConnectNamedPipe failed: " ), GetLastError( ) );
+				console::log( TEXT( "GetQueuedCompletionStatus failed: " ), GetLastError( ) );
 				continue;
 			}
 
-			GAME_PIPE_IN in;
-			if ( !ReadFile( h_pipe, &in, sizeof( in ), nullptr, nullptr ) )
+			_this->onCompletion( reinterpret_cast<IO_CONTEXT*>( poverlapped ), success, bytes );
+		}
+
+		_this->shutdown( );
+
+		return 0;
+	}
+
+	// keeps one pipe instance waiting for the next client
+	//
+	bool listen( )
+	{
+		if ( listening )
+			return true;
+
+		// the out buffer is only a hint, a keyframe of a large board is written in several pieces
+		//
+		const auto h_pipe = CreateNamedPipe( game_pipe, PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT,
+			PIPE_UNLIMITED_INSTANCES, 0x10000, sizeof( GAME_PIPE_IN ), NULL, nullptr );
+		if ( h_pipe == INVALID_HANDLE_VALUE )
+		{
+			console::log( TEXT( "CreateNamedPipe failed: " ), GetLastError( ) );
+			return false;
+		}
+
+		if ( !CreateIoCompletionPort( h_pipe, h_iocp, key_io, 0 ) )
+		{
+			console::log( TEXT( "CreateIoCompletionPort failed: " ), GetLastError( ) );
+
+			CloseHandle( h_pipe );
+			return false;
+		}
+
+		const auto connection = new CONNECTION( );
+		connection->h_pipe = h_pipe;
+		connections.push_back( connection );
+
+		listening = connection;
+
+		auto& io = connection->accept_io;
+		io.type = IO_ACCEPT;
+		io.connection = connection;
+		if ( !ConnectNamedPipe( h_pipe, &io.overlapped ) )
+		{
+			const auto error = GetLastError( );
+			if ( error == ERROR_IO_PENDING )
 			{
-				console::log( TEXT( "ReadFile failed: " ), GetLastError( ) );
+				connection->pending++;
+				return true;
+			}
 
-				DisconnectNamedPipe( h_pipe );
-				continue;
+			// the client connected before we started waiting, no completion is queued for it
+			//
+			if ( error == ERROR_PIPE_CONNECTED )
+			{
+				onAccept( connection, true );
+				release( connection );
+				return true;
 			}
 
+			console::log( TEXT( "ConnectNamedPipe failed: " ), error );
+
+			disconnect( connection );
+			release( connection );
+			return false;
+		}
+
+		connection->pending++;
+		return true;
+	}
+
+	void onCompletion( IO_CONTEXT* pio, bool success, DWORD bytes )
+	{
+		const auto connection = pio->connection;
+
+		// the pipe may have been closed while the operation was in flight
+		//
+		if ( connection->h_pipe )
+		{
+			switch ( pio->type )
+			{
+			case IO_ACCEPT:
+				onAccept( connection, success );
+				break;
+			case IO_READ:
+				onRead( connection, success, bytes );
+				break;
+			case IO_WRITE:
+				onWrite( connection, success, bytes );
+				break;
+			}
+		}
+
+		connection->pending--;
+		release( connection );
+	}
+
+	void onAccept( CONNECTION* connection, bool success )
+	{
+		if ( listening == connection )
+			listening = nullptr;
+
+		if ( !success )
+		{
+			console::log( TEXT( "ConnectNamedPipe failed: " ), GetLastError( ) );
+			disconnect( connection );
+		}
+		else if ( !read( connection ) )
+		{
+			console::log( TEXT( "ReadFile failed: " ), GetLastError( ) );
+			disconnect( connection );
+		}
+
+		listen( );
+	}
+
+	void onRead( CONNECTION* connection, bool success, DWORD bytes )
+	{
+		// a failed or empty read means the client went away
+		//
+		if ( !success || !bytes )
+		{
+			disconnect( connection );
+			return;
+		}
+
+		connection->in_bytes += bytes;
+		if ( connection->in_bytes == sizeof( GAME_PIPE_IN ) )
+		{
+			connection->in_bytes = 0;
+			onRequest( connection );
+		}
+
+		if ( connection->h_pipe && !connection->closing && !read( connection ) )
+		{
+			console::log( TEXT( "ReadFile failed: " ), GetLastError( ) );
+			disconnect( connection );
+		}
+	}
+
+	void onWrite( CONNECTION* connection, bool success, DWORD bytes )
+	{
+		const auto size = connection->frame ? connection->frame->size( ) : connection->out.size( );
+
+		connection->writing = false;
+		connection->frame.reset( );
+
+		if ( !success || bytes != size )
+		{
+			if ( GetLastError( ) != ERROR_NO_DATA && GetLastError( ) != ERROR_BROKEN_PIPE )
+				console::log( TEXT( "WriteFile failed: " ), GetLastError( ) );
+
+			disconnect( connection );
+			return;
+		}
+
+		connection->metrics.writes++;
+		connection->metrics.bytes += bytes;
+
+		Metrics::add( METRIC_PIPE_WRITES );
+		Metrics::add( METRIC_PIPE_BYTES, bytes );
+
+		if ( connection->ending )
+			end( connection );
+		else if ( connection->closing )
+			disconnect( connection );
+	}
+
+	void onRequest( CONNECTION* connection )
+	{
+		const auto& in = connection->in;
+
+		if ( !connection->joined )
+		{
 			if ( in.type != JOIN )
 			{
 				console::log( TEXT( "Invalid Client" ) );
-
-				DisconnectNamedPipe( h_pipe );
-				continue;
+				disconnect( connection );
+				return;
 			}
 
-			bool registered = false;
-			for ( const auto client : _this->client_threads )
+			int num_clients = 0;
+			for ( const auto client : connections )
 			{
-				if ( client.pid != in.pid )
+				if ( !client->joined )
 					continue;
 
-				registered = true;
-				break;
-			}
-
-			if ( registered )
-			{
-				console::log( TEXT( "Client already registered" ) );
+				if ( client->pid == in.pid )
+				{
+					console::log( TEXT( "Client already registered" ) );
+					disconnect( connection );
+					return;
+				}
 
-				DisconnectNamedPipe( h_pipe );
-				continue;
+				num_clients += !client->spectating;
 			}
 
-			const auto num_clients = _this->client_threads.size( );
-
 			GAME_PIPE_OUT out { };
 			out.type = JOIN;
-			out.status = ( in.join.type == SINGLEPLAYER && num_clients == 0 ) || ( in.join.type == MULTIPLAYER && num_clients < 2 );
-			
-			if ( !WriteFile( h_pipe, &out, sizeof( out ), nullptr, nullptr ) )
+
+			int match = 0;
+			if ( match_router )
 			{
-				console::log( TEXT( "WriteFile failed: " ), GetLastError( ) );
+				match = match_router( in.pid, in.join.type );
+				out.status = match >= 0 && match < members.size( );
 
-				DisconnectNamedPipe( h_pipe );
-				continue;
+				// seated in a match this transport has no slot for, the seat is given back
+				//
+				if ( !out.status && match >= 0 && in.join.type != SPECTATOR )
+					invokeCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_LEAVE, in.pid, UP );
 			}
+			else
+				out.status = ( in.join.type == SINGLEPLAYER && num_clients == 0 ) || ( in.join.type == MULTIPLAYER && num_clients < max_players ) ||
+					in.join.type == SPECTATOR;
 
 			if ( !out.status )
 			{
 				console::log( TEXT( "Request from: " ), in.pid, TEXT( " declined." ) );
-
-				DisconnectNamedPipe( h_pipe );
-				continue;
+				connection->closing = true;
+			}
+			else
+			{
+				// joined right away, a failed answer leaves the match again through disconnect( )
+				// the first frame this client gets is a keyframe
+				//
+				connection->pid = in.pid;
+				connection->match = match;
+				connection->joined = true;
+				connection->spectating = in.join.type == SPECTATOR;
+				connection->closes = closes[ match ].load( std::memory_order_acquire );
+				connection->synced = false;
+				connection->metrics.pid = in.pid;
+				connection->metrics.match = match;
+				connection->metrics.spectator = connection->spectating;
+
+				if ( connection->spectating )
+					audiences[ match ].viewers.push_back( connection );
+				else
+					members[ match ].push_back( connection );
 			}
 
-			const auto pinfo = reinterpret_cast<CLIENT_INFO*>( VirtualAlloc( nullptr, sizeof( CLIENT_INFO ), 
-				MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE ) );
-			if ( !pinfo )
+			connection->out.resize( sizeof( out ) );
+			memcpy( connection->out.data( ), &out, sizeof( out ) );
+			if ( !write( connection ) )
 			{
-				console::log( TEXT( "VirtualAlloc failed: " ), GetLastError( ) );
+				console::log( TEXT( "WriteFile failed: " ), GetLastError( ) );
+				disconnect( connection );
+				return;
+			}
+
+			if ( !out.status || connection->spectating )
+				return;
+
+			invokeCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_JOIN, connection->pid, UP );
+			return;
+		}
+
+		switch ( in.type )
+		{
+		case MOVE:
+			if ( !connection->spectating )
+				invokeCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_MOVE, connection->pid, in.move.direction, in.move.seq );
+			break;
+		case SYNC:
+			connection->synced = false;
+			break;
+		case LEAVE:
+			disconnect( connection );
+			break;
+		case JOIN:
+			console::log( TEXT( "Invalid JOIN request from: " ), in.pid );
+			break;
+		default:
+			console::log( TEXT( "Invalid request from: " ), in.pid );
+			break;
+		}
+	}
+
+	void broadcast( )
+	{
+		tick_pending = false;
+
+		listen( );
+
+		for ( int match = 0; match < members.size( ); match++ )
+		{
+			endSpectators( match );
+
+			if ( !members[ match ].empty( ) || !audiences[ match ].viewers.empty( ) )
+				broadcast( match );
+		}
+
+		auto& metrics = client_metrics.begin( );
+		metrics.clear( );
+		for ( const auto& list : members )
+			for ( const auto connection : list )
+				metrics.push_back( connection->metrics );
+
+		for ( const auto& audience : audiences )
+			for ( const auto connection : audience.viewers )
+				metrics.push_back( connection->metrics );
+
+		client_metrics.publish( );
+	}
+
+	// writes this tick's frame to every client of the match that isn't still busy with the previous one
+	// a slow client simply gets a larger delta on the next tick
+	//
+	void broadcast( int match )
+	{
+		auto& buffer = *snapshots[ match ];
+		auto& list = members[ match ];
+
+		// a client that joined after the last frame is still waiting for its keyframe
+		//
+		auto version = buffer.getVersion( );
+		bool waiting = false;
+		for ( const auto connection : list )
+			waiting |= !connection->synced;
+
+		for ( const auto connection : audiences[ match ].viewers )
+			waiting |= !connection->synced;
+
+		if ( version == sent_versions[ match ] && !waiting )
+			return;
+
+		if ( !buffer.read( current, &version ) )
+			return;
+
+		sent_versions[ match ] = version;
+
+		// the close is counted before the next match of the slot publishes anything, a frame of that one
+		// can't reach a spectator of the old one once this saw the count
+		//
+		endSpectators( match );
 
-				DisconnectNamedPipe( h_pipe );
+		const auto tick = current.seq;
+
+		// backwards, release( ) takes a connection it frees out of the list
+		//
+		for ( auto i = list.size( ); i-- > 0; )
+		{
+			const auto connection = list[ i ];
+			if ( !connection->h_pipe || !connection->joined || connection->closing )
+				continue;
+
+			// still writing the previous frame, this tick is skipped for it
+			//
+			if ( connection->writing )
+			{
+				skip( connection );
 				continue;
 			}
 
-			pinfo->pid = in.pid;
-			pinfo->_this = _this;
-			pinfo->h_pipe = h_pipe;
+			// keyframe on join (or when the client lost track), afterwards only what changed since the last frame
+			// an input the engine took without moving anything still has to be acked
+			//
+			GAME_PIPE_OUT out { };
+			out.type = UPDATE;
 
-			const auto h_thread = CreateThread( nullptr, NULL, reinterpret_cast<LPTHREAD_START_ROUTINE>( gameRoutine ), pinfo, NULL, nullptr );
-			if ( !h_thread )
-			{
-				console::log( TEXT( "CreateThread failed: " ), GetLastError( ) );
+			bool changed = true;
+			if ( !connection->synced )
+				encodeKeyframe( current.data, tick, out.frame, records );
+			else if ( tick == connection->sent_seq )
+				continue;
+			else
+				changed = encodeDelta( connection->sent, connection->sent_seq, current.data, tick, out.frame, records );
 
-				VirtualFree( pinfo, NULL, MEM_RELEASE );
-				DisconnectNamedPipe( h_pipe );
+			fillFrameInput( out.frame, current, connection->pid );
+			if ( !changed && out.frame.input_ack == connection->sent_ack )
+				continue;
+
+			connection->out.resize( sizeof( out ) + records.size( ) );
+			memcpy( connection->out.data( ), &out, sizeof( out ) );
+			if ( !records.empty( ) )
+				memcpy( connection->out.data( ) + sizeof( out ), records.data( ), records.size( ) );
+
+			if ( !write( connection ) )
+			{
+				console::log( TEXT( "WriteFile failed: " ), GetLastError( ) );
+				disconnect( connection );
+				release( connection );
 				continue;
 			}
 
-			CLIENT client;
-			client.pid = in.pid;
-			client.h_pipe = h_pipe;
-			client.h_thread = h_thread;
-			_this->client_threads.push_back( client );
-			
-			if ( _this->callbacks_map.find( CLIENT_CALLBACK_TYPE::ON_PLAYER_JOIN ) != _this->callbacks_map.end( ) )
-				_this->callbacks_map[ CLIENT_CALLBACK_TYPE::ON_PLAYER_JOIN ]( pinfo->pid, UP );
+			connection->sent = current.data;
+			connection->sent_seq = tick;
+			connection->sent_ack = out.frame.input_ack;
+			connection->synced = true;
 		}
 
-		return ret_cause != WAIT_OBJECT_0;
+		if ( !audiences[ match ].viewers.empty( ) )
+			spectate( match, tick );
 	}
 
-	static DWORD WINAPI gameRoutine( CLIENT_INFO* pinfo )
+	// a spectator that took the last frame gets the delta to this one, any other one the keyframe, and one still
+	// writing an older frame skips this one (it never holds the match back, it just sees fewer frames)
+	// the cost per spectator is its WriteFile, the frame is shared
+	//
+	void spectate( int match, uint32_t tick )
 	{
-		if ( !pinfo )
-		{
-			console::log( TEXT( "Invalid Game Thread" ) );
+		auto& audience = audiences[ match ];
 
-			auto& client_threads = pinfo->_this->client_threads;
-			client_threads.erase( std::remove_if( client_threads.begin( ), client_threads.end( ), [ ] ( CLIENT client )
-				{
-					return GetCurrentThreadId( ) == GetThreadId( client.h_thread );
-				} ), client_threads.end( ) );
+		GAME_PIPE_OUT out { };
+		out.type = UPDATE;
 
-			DisconnectNamedPipe( pinfo->h_pipe );
-			return 1;
+		// a tick that changed nothing leaves the spectators on the frame they have
+		//
+		if ( !audience.started )
+		{
+			audience.data = current.data;
+			audience.seq = tick;
+			audience.started = true;
 		}
+		else if ( tick != audience.seq && encodeDelta( audience.data, audience.seq, current.data, tick, out.frame, records ) )
+		{
+			audience.delta = makeFrame( out, records );
+			audience.base_seq = audience.seq;
 
-		DWORD bytes = NULL;
-		DWORD ret_cause = NULL;
-		while ( ( ret_cause = WaitForSingleObjectEx( pinfo->_this->h_event, settings::tick_ms, false ) ) == WAIT_TIMEOUT )
+			audience.data = current.data;
+			audience.seq = tick;
+			audience.keyframe.reset( );
+		}
+
+		auto& list = audience.viewers;
+		for ( auto i = list.size( ); i-- > 0; )
 		{
-			GAME_PIPE_OUT out;
-			out.type = UPDATE;
-			memcpy( &out.data, &pinfo->_this->data, sizeof( out.data ) );
-			if ( !WriteFile( pinfo->h_pipe, &out, sizeof( out ), nullptr, nullptr ) )
-			{
-				if ( GetLastError( ) == ERROR_NO_DATA )
-					break;
+			const auto connection = list[ i ];
+			if ( !connection->h_pipe || !connection->joined || connection->closing )
+				continue;
 
-				console::log( TEXT( "WriteFile failed: " ), GetLastError( ) );
+			if ( connection->synced && connection->sent_seq == audience.seq )
 				continue;
-			}
 
-			GAME_PIPE_IN in;
-			DWORD available = NULL;
-			if ( !PeekNamedPipe( pinfo->h_pipe, nullptr, NULL, nullptr, &available, nullptr ) )
+			if ( connection->writing )
 			{
-				if ( GetLastError( ) == ERROR_BROKEN_PIPE )
-					break;
-
-				console::log( TEXT( "PeekNamedPipe error: " ), GetLastError( ) );
+				skip( connection );
 				continue;
 			}
 
-			if ( available < sizeof( in ) )
-				continue;
-
-			if ( !ReadFile( pinfo->h_pipe, &in, sizeof( in ), nullptr, nullptr ) )
+			if ( connection->synced && audience.delta && connection->sent_seq == audience.base_seq )
+				connection->frame = audience.delta;
+			else
 			{
-				if ( GetLastError( ) == ERROR_BROKEN_PIPE )
-					break;
+				if ( !audience.keyframe )
+				{
+					encodeKeyframe( audience.data, audience.seq, out.frame, records );
+					audience.keyframe = makeFrame( out, records );
+				}
 
-				console::log( TEXT( "ReadFile error: " ), GetLastError( ) );
-				continue;
+				connection->frame = audience.keyframe;
 			}
 
-			if ( in.type == JOIN )
+			if ( !write( connection ) )
 			{
-				console::log( TEXT( "Invalid JOIN request from: " ), in.pid );
+				console::log( TEXT( "WriteFile failed: " ), GetLastError( ) );
+				disconnect( connection );
+				release( connection );
 				continue;
 			}
 
-			if ( in.type == LEAVE )
+			connection->sent_seq = audience.seq;
+			connection->synced = true;
+		}
+	}
+
+	// the frames of the audience start over with the next match of the slot, the spectators of the old one are sent a leave
+	//
+	void endSpectators( int match )
+	{
+		auto& audience = audiences[ match ];
+
+		const auto count = closes[ match ].load( std::memory_order_acquire );
+		if ( audience.closes == count )
+			return;
+
+		audience.closes = count;
+		audience.started = false;
+		audience.keyframe.reset( );
+		audience.delta.reset( );
+
+		auto& list = audience.viewers;
+		for ( auto i = list.size( ); i-- > 0; )
+		{
+			const auto connection = list[ i ];
+			if ( !connection->h_pipe || !connection->joined || connection->closing || connection->closes == count )
+				continue;
+
+			connection->joined = false;
+			connection->ending = true;
+
+			if ( !connection->writing )
 			{
-				ret_cause = WAIT_OBJECT_0;
-				break;
+				end( connection );
+				release( connection );
 			}
+		}
+	}
 
-			if ( in.type == MOVE )
+	void end( CONNECTION* connection )
+	{
+		connection->ending = false;
+		connection->closing = true;
+
+		GAME_PIPE_OUT out { };
+		out.type = LEAVE;
+
+		connection->out.resize( sizeof( out ) );
+		memcpy( connection->out.data( ), &out, sizeof( out ) );
+		if ( !write( connection ) )
+		{
+			console::log( TEXT( "WriteFile failed: " ), GetLastError( ) );
+			disconnect( connection );
+		}
+	}
+
+	// a client that didn't take its last frame within the write timeout stopped reading, it is dropped instead of
+	// falling further behind (closing the pipe aborts the write, release( ) frees it once that completion is back)
+	//
+	void skip( CONNECTION* connection )
+	{
+		connection->metrics.dropped++;
+		Metrics::add( METRIC_PIPE_DROPPED );
+
+		if ( write_timeout_ms <= 0 || GetTickCount64( ) - connection->write_since <= static_cast<ULONGLONG>( write_timeout_ms ) )
+			return;
+
+		console::error( TEXT( "Client " ), connection->pid, TEXT( " stopped reading, disconnected" ) );
+		Metrics::add( METRIC_PIPE_EVICTED );
+
+		disconnect( connection );
+		release( connection );
+	}
+
+	// a frame no write holds anymore is filled again, a steady audience doesn't allocate
+	//
+	std::shared_ptr<std::vector<char>> makeFrame( const GAME_PIPE_OUT& out, const std::vector<char>& records )
+	{
+		std::shared_ptr<std::vector<char>> frame;
+		for ( const auto& candidate : frames )
+			if ( candidate.use_count( ) == 1 )
 			{
-				if ( pinfo->_this->callbacks_map.find( CLIENT_CALLBACK_TYPE::ON_PLAYER_MOVE ) != pinfo->_this->callbacks_map.end( ) )
-					pinfo->_this->callbacks_map[ CLIENT_CALLBACK_TYPE::ON_PLAYER_MOVE ]( pinfo->pid, in.move.direction );
+				frame = candidate;
+				break;
 			}
-			else
-				console::log( TEXT( "Invalid request from: " ), in.pid );
+
+		if ( !frame )
+		{
+			frame = std::make_shared<std::vector<char>>( );
+			frames.push_back( frame );
 		}
 
-		if ( pinfo->_this->callbacks_map.find( CLIENT_CALLBACK_TYPE::ON_PLAYER_LEAVE ) != pinfo->_this->callbacks_map.end( ) )
-			pinfo->_this->callbacks_map[ CLIENT_CALLBACK_TYPE::ON_PLAYER_LEAVE ]( pinfo->pid, UP );
+		frame->resize( sizeof( out ) + records.size( ) );
+		memcpy( frame->data( ), &out, sizeof( out ) );
+		if ( !records.empty( ) )
+			memcpy( frame->data( ) + sizeof( out ), records.data( ), records.size( ) );
 
-		auto& client_threads = pinfo->_this->client_threads;
-		client_threads.erase( std::remove_if( client_threads.begin( ), client_threads.end( ), [ ] ( CLIENT client )
-			{
-				return GetCurrentThreadId( ) == GetThreadId( client.h_thread );
-			} ), client_threads.end( ) );
+		return frame;
+	}
+
+	bool read( CONNECTION* connection )
+	{
+		auto& io = connection->read_io;
+		memset( &io.overlapped, 0, sizeof( io.overlapped ) );
+		io.type = IO_READ;
+		io.connection = connection;
+
+		const auto buffer = reinterpret_cast<char*>( &connection->in ) + connection->in_bytes;
+		if ( !ReadFile( connection->h_pipe, buffer, sizeof( GAME_PIPE_IN ) - connection->in_bytes, nullptr, &io.overlapped ) && GetLastError( ) != ERROR_IO_PENDING )
+			return false;
+
+		// the completion is queued even if the read finished right away
+		//
+		connection->pending++;
+		return true;
+	}
+
+	bool write( CONNECTION* connection )
+	{
+		auto& io = connection->write_io;
+		memset( &io.overlapped, 0, sizeof( io.overlapped ) );
+		io.type = IO_WRITE;
+		io.connection = connection;
+
+		const auto& data = connection->frame ? *connection->frame : connection->out;
+		if ( !WriteFile( connection->h_pipe, data.data( ), static_cast<DWORD>( data.size( ) ), nullptr, &io.overlapped ) && GetLastError( ) != ERROR_IO_PENDING )
+		{
+			connection->frame.reset( );
+			return false;
+		}
+
+		connection->writing = true;
+		connection->write_since = GetTickCount64( );
+		connection->pending++;
+		return true;
+	}
+
+	// closes the pipe, the connection is freed by release( ) once its pending operations came back
+	//
+	void disconnect( CONNECTION* connection )
+	{
+		if ( !connection->h_pipe )
+			return;
+
+		if ( listening == connection )
+			listening = nullptr;
+
+		if ( connection->joined )
+		{
+			connection->joined = false;
+
+			if ( !connection->spectating )
+				invokeCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_LEAVE, connection->pid, UP );
+		}
+
+		DisconnectNamedPipe( connection->h_pipe );
+		CloseHandle( connection->h_pipe );
+		connection->h_pipe = nullptr;
+	}
 
-		DisconnectNamedPipe( pinfo->h_pipe );
-		VirtualFree( pinfo, NULL, MEM_RELEASE );
+	void release( CONNECTION* connection )
+	{
+		if ( connection->h_pipe || connection->pending > 0 )
+			return;
 
-		return ret_cause != WAIT_OBJECT_0;
+		auto& match = connection->spectating ? audiences[ connection->match ].viewers : members[ connection->match ];
+		const auto member = std::find( match.begin( ), match.end( ), connection );
+		if ( member != match.end( ) )
+			match.erase( member );
+
+		connections.remove( connection );
+		delete connection;
+	}
+
+	void shutdown( )
+	{
+		for ( const auto connection : connections )
+			disconnect( connection );
+
+		// closing the pipes aborted whatever was in flight, wait for those completions before freeing the contexts
+		//
+		while ( true )
+		{
+			bool pending = false;
+			for ( const auto connection : connections )
+				pending |= connection->pending > 0;
+
+			if ( !pending )
+				break;
+
+			DWORD bytes = NULL;
+			ULONG_PTR key = NULL;
+			OVERLAPPED* poverlapped = nullptr;
+			if ( !GetQueuedCompletionStatus( h_iocp, &bytes, &key, &poverlapped, 200 ) && !poverlapped )
+				break;
+
+			if ( key == key_io && poverlapped )
+				reinterpret_cast<IO_CONTEXT*>( poverlapped )->connection->pending--;
+		}
+
+		for ( const auto connection : connections )
+			delete connection;
+
+		connections.clear( );
+		listening = nullptr;
+
+		for ( auto& match : members )
+			match.clear( );
+
+		for ( auto& audience : audiences )
+			audience.viewers.clear( );
+	}
+
+	void invokeCallback( CLIENT_CALLBACK_TYPE type, DWORD pid, FACING direction, uint32_t seq = 0 )
+	{
+		const auto callback = callbacks_map.find( type );
+		if ( callback != callbacks_map.end( ) && callback->second )
+			callback->second( pid, direction, seq );
 	}
 
 	DWORD getStatus( HANDLE h_thread )
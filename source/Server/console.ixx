@@ -10,6 +10,8 @@
 #include <Windows.h>
 #endif
 
+#include "logger.hpp"
+
 export module console;
 
 #ifndef __INTELLISENSE__
@@ -54,6 +56,31 @@ namespace console
 
 	export using tstring = std::string;
 #endif
+
+	// log lines come from the logger's drain thread, one at a time, warnings and errors go to stderr
+	//
+	static const auto logging = [ ] ( )
+	{
+		Logger::setSink( [ ] ( LOG_LEVEL level, const char* line )
+			{
+				auto& stream = level >= LOG_WARNING ? tcerr : tclog;
+
+#ifdef UNICODE
+				// on the stack, the last lines are drained at exit when statics may already be gone
+				// a line is never longer than the logger's, one wide char per byte at most
+				//
+				wchar_t wide[ 512 ];
+				if ( !MultiByteToWideChar( CP_UTF8, 0, line, -1, wide, static_cast<int>( std::size( wide ) ) ) )
+					wide[ 0 ] = L'\0';
+
+				stream << TEXT( "[ " ) << identifier << TEXT( " ] " ) << wide << std::endl;
+#else
+				stream << "[ " << identifier << " ] " << line << std::endl;
+#endif
+			} );
+
+		return true;
+	}( );
 }
 
 export
@@ -74,19 +101,19 @@ namespace console
 		( tcin >> ... >> args );
 	}
 
+	// error and log don't wait on the console, they are queued for the logger's drain thread
+	//
 	template<typename... T>
 	inline void error( T... args )
 	{
-		( tcerr << ... << args ) << std::endl;
+		Logger::write( LOG_ERROR, args... );
 	}
 
 	template<typename... T>
 	inline void log( T... args )
 	{
 #ifdef _DEBUG
-		tclog << TEXT( "[ " ) << identifier << TEXT( " ] " );
-		( tclog << ... << args );
-		tclog << std::endl;
+		Logger::write( LOG_DEBUG, args... );
 #endif
 	}
 
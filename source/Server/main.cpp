@@ -34,7 +34,10 @@ int main( int argc, char* argv[ ] )
 	console::print( TEXT( "Int Car Speed: " ), settings::init_car_speed, TEXT( "\nNum Roads: " ), settings::num_roads, "\n" );
 
 	while (server != nullptr && server->isRunning())
+	{
 		Sleep( settings::tick_ms );
+		server->dumpStats( );
+	}
 
 	return 0;
 }
\ No newline at end of file
@@ -7,7 +7,7 @@ module;
 #include <functional>
 #endif
 
-#include "map.hpp"
+#include "protocol.hpp"
 
 export module op;
 
@@ -18,8 +18,6 @@ import <functional>;
 
 import console;
 
-#define MAX_ENTITIES    160  // 10 - 2 = 8, 8 * 20 = 160
-
 export enum COMMAND_TYPE
 {
 	INFO,
@@ -66,33 +64,6 @@ export typedef struct
 	};
 } COMMAND;
 
-export typedef struct
-{
-	ENTITY_TYPE type;
-	FACING direction;
-	int pos_x, pos_y;
-} ENTITY;
-
-export enum GAME_STATE
-{
-	GAME_STATE_READY,
-	GAME_STATE_RUNNING,
-	GAME_STATE_PLAYER1_WINS,
-	GAME_STATE_PLAYER2_WINS,
-	GAME_STATE_DRAW,
-	GAME_STATE_LOSS,
-	GAME_STATE_MAX
-};
-
-typedef struct
-{
-	GAME_STATE state;
-	int time, level;
-	int width, height;
-	int num_entities;
-	ENTITY entities[ MAX_ENTITIES ];
-} DATA;
-
 enum EVENT_TYPE
 {
 	EVENT_GAME_UPDATE,
@@ -103,8 +74,19 @@ enum EVENT_TYPE
 
 using EventCallback = std::function<void( void* ptr_data )>;
 
-using WriteDataFn = bool( * )( DATA data );
-using GetDataFn = bool( * )( DATA* ptr_data );
+// a frame as the Dll takes it, the entities are copied from where entities points into the shared memory
+//
+typedef struct
+{
+	GAME_STATE state;
+	int time, level;
+	int width, height;
+	int num_entities;
+	const ENTITY* entities;
+} OPERATOR_DATA;
+
+using WriteDataFn = bool( * )( OPERATOR_DATA data );
+using GetDataFn = bool( * )( OPERATOR_DATA* ptr_data );
 using UnregisterFn = void( * )( EVENT_TYPE type );
 using SendCommandFn = bool( * )( COMMAND_INFO command_info, int target_pid );
 using RegisterFn = bool( * )( EVENT_TYPE type, EventCallback callback );
@@ -126,6 +108,10 @@ private:
 	SendCommandFn sendcommand_fn = nullptr;
 	SendCommandFeedbackFn sendcommandfeedback_fn = nullptr;
 
+	// the last frame, reused so a steady board doesn't allocate
+	//
+	DATA data { };
+
 public:
 	Operator( )
 	{
@@ -205,37 +191,19 @@ public:
 		}
 	}
 
-	bool updateData( const std::vector<Entity*>& entities, GAME_STATE state, int time, int level, int width, int height )
+	// called by one thread at a time
+	//
+	bool updateData( std::span<const Entity> entities, GAME_STATE state, int time, int level, int width, int height )
 	{
-		DATA data;
-		data.time = time;
-		data.state = state;
-		data.level = level;
-		data.width = width;
-		data.height = height;
-		data.num_entities = 0;
-		for ( auto& entity : entities )
+		if ( !serializeSnapshot( data, entities, state, time, level, width, height ) )
 		{
-			auto entity_data = &data.entities[ data.num_entities++ ];
-
-			auto pos = entity->getPosition( );
-			entity_data->pos_x = pos.first;
-			entity_data->pos_y = pos.second;
-
-			auto mentity = dynamic_cast<MovingEntity*>( entity );
-			entity_data->direction = mentity ? mentity->getFacingDirection( ) : UP;
-
-			const auto type = entity->getType( );
-			if ( type >= ENTITY_TYPE::ENTITY_TYPE_OBSTACLE && type < ENTITY_TYPE::ENTITY_TYPE_MAX )
-				entity_data->type = type;
-			else
-			{
-				console::error( "updateData failed: Invalid entity" );
-				return false;
-			}
-			
+			console::error( "updateData failed: Invalid snapshot" );
+			return false;
 		}
-		return writedata_fn && writedata_fn( data ) ? true : false;
+
+		const OPERATOR_DATA frame { data.state, data.time, data.level, data.width, data.height, data.num_entities, data.entities.data( ) };
+
+		return writedata_fn && writedata_fn( frame ) ? true : false;
 	}
 
 	bool setOnCommandResolve( OnCommandResolveFn callback )
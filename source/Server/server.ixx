@@ -3,13 +3,25 @@ module;
 // workaround to intellisense that might be not as smart as we thought
 //
 #if __INTELLISENSE__
+#include <cstdio>
+#include <string>
 #include <Windows.h>
 #include <functional>
 #endif
 
+#include "match.hpp"
+#include "engine.hpp"
+#include "logger.hpp"
+#include "metrics.hpp"
+#include "protocol.hpp"
+#include "scheduler.hpp"
+#include "tcp_server.hpp"
+
 export module server;
 
 #ifndef __INTELLISENSE__
+import <cstdio>;
+import <string>;
 import <Windows.h>;
 import <functional>;
 #endif
@@ -17,16 +29,17 @@ import <functional>;
 import ui;
 import op;
 import client;
-import engine;
 import console;
 import settings;
 
 export class Server
 {
 private:
+	inline static constexpr int players_per_match = 2;
+	inline static constexpr int watched_match = 0;		// the one shown to the operators, their commands act on it
+
 	bool running = true;
 	bool is_frozen = false;
-	bool suspended = false;
 
 	HANDLE h_thread = nullptr;
 	HANDLE h_thread_console = nullptr;
@@ -35,70 +48,35 @@ private:
 
 	UI* pui = nullptr;
 	Client* pclient = nullptr;
+	TcpServer* ptcp = nullptr;
 	Operator* poperator = nullptr;
-	GameEngine* pengine = nullptr;
+	MatchManager* pmatches = nullptr;
+	TickScheduler* pscheduler = nullptr;
+
+	ULONGLONG last_stats_dump = 0;
 
 public:
 	Server( )
 	{
 		console::log( TEXT( "Server Constructor" ) );
 
-		if ( !checkUniqueInstance( ) )
-			std::exit( 1 );
-
-		settings::load( );
-
-		pclient = new Client( );
-		
-		// register client callbacks
-		//
-		pclient->registerCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_JOIN, [ & ] ( DWORD pid, FACING direction )
-			{
-				pengine->addPlayer( pid );
-			} );
-		pclient->registerCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_MOVE, [ & ] ( DWORD pid, FACING direction )
-			{
-				pengine->movePlayer( pid, direction );
-			} );
-		pclient->registerCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_LEAVE, [ & ] ( DWORD pid, FACING direction )
-			{
-				pengine->removePlayer( pid );
-			} );
-
-		pui = new UI( );
-
-		poperator = new Operator( );
-		poperator->setOnCommandResolve( [ this ] ( void* ptr_data )
-			{
-				this->onCommandResolve( static_cast<COMMAND*>( ptr_data ) );
-			} );
-
-		pengine = new GameEngine( );
-
-		h_thread = CreateThread( nullptr, NULL, reinterpret_cast<LPTHREAD_START_ROUTINE>( mainRoutine ), this, NULL, nullptr );
-		if ( !h_thread )
-			std::exit( 1 );
-		
-		h_thread_console = CreateThread( nullptr, NULL, reinterpret_cast<LPTHREAD_START_ROUTINE>( adminConsole ), this, NULL, nullptr );
-		if ( !h_thread_console )
-			std::exit( 1 );
-
-		h_event = CreateEvent( nullptr, true, false, nullptr );
-		if ( !h_event )
-			std::exit( 1 );
+		create( );
 	}
 
-	Server( int num_roads, double init_car_speed ) : Server( )
+	// the values given replace the stored ones, and are stored in turn when the server closes
+	//
+	Server( int num_roads, double init_car_speed )
 	{
 		console::log( TEXT( "Server Constructor with Params" ) );
 
-		settings::num_roads = num_roads;
-		settings::init_car_speed = init_car_speed;
+		create( num_roads, init_car_speed );
 	}
 
 	~Server( )
 	{
 		running = false;
+		if ( pscheduler )
+			pscheduler->stop( );
 
 		if ( h_thread )
 		{
@@ -119,18 +97,24 @@ public:
 		if ( h_event )
 			CloseHandle( h_event );
 
+		if ( ptcp )
+			delete ptcp;
+
 		if ( pclient )
 			delete pclient;
 
 		if ( pui )
 			delete pui;
 
-		if ( pengine )
-			delete pengine;
+		if ( pmatches )
+			delete pmatches;
 
 		if ( poperator )
 			delete poperator;
 
+		if ( pscheduler )
+			delete pscheduler;
+
 		settings::save( );
 
 		closeInstance( );
@@ -143,6 +127,33 @@ public:
 		return running && pclient->isConnected( );
 	}
 
+	// rewrites stats.json every stats_interval seconds for the dashboards, through a temporary file so they never
+	// read half of one
+	//
+	void dumpStats( )
+	{
+		if ( settings::stats_interval <= 0 )
+			return;
+
+		const auto now = GetTickCount64( );
+		if ( last_stats_dump && now - last_stats_dump < static_cast<ULONGLONG>( settings::stats_interval ) * 1000 )
+			return;
+
+		last_stats_dump = now;
+
+		const auto json = getStatsJson( );
+
+		FILE* file = nullptr;
+		if ( fopen_s( &file, "stats.json.tmp", "wb" ) || !file )
+			return;
+
+		const bool written = fwrite( json.data( ), 1, json.size( ), file ) == json.size( );
+		fclose( file );
+
+		if ( written )
+			MoveFileExA( "stats.json.tmp", "stats.json", MOVEFILE_REPLACE_EXISTING );
+	}
+
 private:
 	bool checkUniqueInstance( )
 	{
@@ -167,27 +178,155 @@ private:
 		instance_semaphore = nullptr;
 	}
 
-	bool processTick( )
+	// the transports call these from their own threads, joining picks the match and the inputs are taken on its next tick
+	//
+	template <typename T>
+	void registerCallbacks( T* ptransport )
 	{
-		return pengine->processTick( );
+		ptransport->setMatchRouter( [ this ] ( uint32_t pid, GAME_TYPE type )
+			{
+				return pmatches->join( pid, type );
+			} );
+		ptransport->registerCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_MOVE, [ this ] ( uint32_t pid, FACING direction, uint32_t seq )
+			{
+				pmatches->move( pid, direction, seq );
+			} );
+		ptransport->registerCallback( CLIENT_CALLBACK_TYPE::ON_PLAYER_LEAVE, [ this ] ( uint32_t pid, FACING direction, uint32_t seq )
+			{
+				pmatches->leave( pid );
+			} );
 	}
 
-	static DWORD WINAPI mainRoutine( Server* _this )
+	// the command line overrides are applied before the matches copy the settings, 0 keeps the stored value
+	//
+	void create( int num_roads = 0, double init_car_speed = 0 )
 	{
-		while ( _this->running )
+		if ( !checkUniqueInstance( ) )
+			std::exit( 1 );
+
+		settings::load( );
+
+		if ( num_roads > 0 )
+			settings::num_roads = num_roads;
+
+		if ( init_car_speed > 0 )
+			settings::init_car_speed = init_car_speed;
+
+		// paced by the loaded tick, not the default one
+		//
+		pscheduler = new TickScheduler( settings::tick_ms );
+
+		createMatches( );
+
+		pclient = new Client( pmatches->getMaxMatches( ) );
+		pclient->setWriteTimeout( settings::write_timeout );
+		registerCallbacks( pclient );
+
+		// remote players, through the same callbacks as the local pipe
+		//
+		if ( settings::tcp_port )
 		{
-			if ( _this->suspended )
-				continue;
+			ptcp = new TcpServer( players_per_match, pmatches->getMaxMatches( ) );
+			ptcp->setWriteTimeout( settings::write_timeout );
+			registerCallbacks( ptcp );
+
+			if ( !ptcp->start( "0.0.0.0", static_cast<uint16_t>( settings::tcp_port ) ) )
+			{
+				console::error( TEXT( "Could not listen on tcp port " ), settings::tcp_port );
+
+				delete ptcp;
+				ptcp = nullptr;
+			}
+		}
+
+		// the spectators of a match that ended are told so, they'd watch the next one of the slot otherwise
+		//
+		pmatches->setOnClose( [ this ] ( int match )
+			{
+				pclient->closeMatch( match );
+
+				if ( ptcp )
+					ptcp->closeMatch( match );
+			} );
+
+		pui = new UI( );
+
+		poperator = new Operator( );
+		poperator->setOnCommandResolve( [ this ] ( void* ptr_data )
+			{
+				this->onCommandResolve( static_cast<COMMAND*>( ptr_data ) );
+			} );
+
+		h_thread = CreateThread( nullptr, NULL, reinterpret_cast<LPTHREAD_START_ROUTINE>( mainRoutine ), this, NULL, nullptr );
+		if ( !h_thread )
+			std::exit( 1 );
+		
+		h_thread_console = CreateThread( nullptr, NULL, reinterpret_cast<LPTHREAD_START_ROUTINE>( adminConsole ), this, NULL, nullptr );
+		if ( !h_thread_console )
+			std::exit( 1 );
+
+		h_event = CreateEvent( nullptr, true, false, nullptr );
+		if ( !h_event )
+			std::exit( 1 );
+	}
+
+	void createMatches( )
+	{
+		try
+		{
+			pmatches = new MatchManager( settings::get( ), settings::max_matches, players_per_match, settings::match_threads );
+		}
+		catch ( const std::exception& e )
+		{
+			console::error( "Error creating game engine: ", e.what( ) );
+			std::exit( 1 );
+		}
 
-			const auto size = _this->pengine->getMapSize( );
-			if ( _this->processTick( ) && !_this->poperator->updateData( _this->pengine->getEntityList( ), GAME_STATE_READY, 0, 0, size.first, size.second ) )
-				_this->pui->printToPrompt( TEXT( "updateData failed" ) );
+		pmatches->setOnTick( [ this ] ( int match, GameEngine& engine, bool processed )
+			{
+				onMatchTick( match, engine, processed );
+			} );
 
-			_this->pclient->update( _this->pengine->getEntityList( ), GAME_STATE_READY, 0, 0, size.first, size.second );
+		// a desync or a slow tick seen in a match can be run again with crr_replay
+		//
+		if ( settings::record_replays )
+		{
+			CreateDirectory( TEXT( "replays" ), nullptr );
+			pmatches->setReplayDirectory( "replays" );
+		}
+	}
+
+	// called from the pool for every match that stepped, the operators watch one of them
+	//
+	void onMatchTick( int match, GameEngine& engine, bool processed )
+	{
+		const auto size = engine.getMapSize( );
+		const auto entities = engine.getEntityList( );
+
+		if ( match == watched_match && processed )
+		{
+			MetricTimer timer( METRIC_OPERATOR_UPDATE );
 
-			Sleep( settings::tick_ms );
+			if ( !poperator->updateData( entities, GAME_STATE_READY, 0, 0, size.first, size.second ) )
+				pui->printToPrompt( TEXT( "updateData failed" ) );
 		}
 
+		const auto tick = static_cast<uint32_t>( engine.getTick( ) );
+		const auto acks = engine.getPlayerAcks( );
+
+		pclient->update( match, tick, entities, acks, GAME_STATE_READY, 0, 0, size.first, size.second );
+
+		if ( ptcp )
+			ptcp->update( match, tick, entities, acks, GAME_STATE_READY, 0, 0, size.first, size.second );
+	}
+
+	static DWORD WINAPI mainRoutine( Server* _this )
+	{
+		_this->pscheduler->run( [ _this ] ( )
+			{
+				_this->pmatches->processTick( );
+			} );
+
 		COMMAND_INFO info;
 		info.action = EXIT;
 		_this->poperator->sendCommand( info, -1 );
@@ -198,37 +337,110 @@ private:
 	void exit( )
 	{
 		running = false;
+		pscheduler->stop( );
 	}
 
 	void suspend( )
 	{
-		if ( suspended )
+		if ( pscheduler->isSuspended( ) )
 		{
 			pui->printToPrompt( TEXT( "Server is not running." ) );
 			return;
 		}
 
 		pui->printToPrompt( TEXT( "Suspending..." ) );
-		suspended = true;
+		pscheduler->suspend( );
 	}
 
 	void resume( )
 	{
-		if ( !suspended )
+		if ( !pscheduler->isSuspended( ) )
 		{
 			pui->printToPrompt( TEXT( "Server is not suspended." ) );
 			return;
 		}
 
 		pui->printToPrompt( TEXT( "Resuming..." ) );
-		suspended = false;
+		pscheduler->resume( );
 	}
 
 	void restart( )
 	{
 		pui->printToPrompt( TEXT( "Restarting game..." ) );
-		delete pengine;
-		pengine = new GameEngine( );
+		pmatches->execute( [ ] ( GameEngine& engine ) { engine.restart( ); } );
+	}
+
+	void printMatches( )
+	{
+		const auto stats = pmatches->getStats( );
+		console::log( TEXT( "Matches: " ), stats.matches, TEXT( "/" ), pmatches->getMaxMatches( ), TEXT( ", players: " ), stats.players, TEXT( ", threads: " ), stats.threads );
+	}
+
+	void printStats( )
+	{
+		const auto ticks = pscheduler->getStats( );
+		const auto matches = pmatches->getStats( );
+
+		console::print( TEXT( "Ticks: " ), ticks.ticks, TEXT( ", overruns: " ), ticks.overruns, TEXT( ", catch up: " ), ticks.catch_up_steps,
+			TEXT( ", dropped: " ), ticks.dropped_steps, TEXT( ", avg " ), ticks.avg_tick_ms, TEXT( " ms, max " ), ticks.max_tick_ms, TEXT( " ms\n" ) );
+		console::print( TEXT( "Matches: " ), matches.matches, TEXT( "/" ), pmatches->getMaxMatches( ), TEXT( ", players: " ), matches.players,
+			TEXT( ", threads: " ), matches.threads, TEXT( "\n" ) );
+
+		console::print( Metrics::format( Metrics::instance( ).read( ) ).c_str( ) );
+
+		const auto log = Logger::getStats( );
+		console::print( TEXT( "Log: " ), log.written, TEXT( " written, " ), log.dropped, TEXT( " dropped, " ), log.suppressed, TEXT( " held back\n" ) );
+
+		for ( const auto& client : pclient->getClientMetrics( ) )
+			console::print( client.spectator ? TEXT( "Spectator " ) : TEXT( "Client " ), client.pid, TEXT( " (match " ), client.match, TEXT( "): " ),
+				client.writes, TEXT( " writes, " ), client.bytes, TEXT( " bytes, " ), client.dropped, TEXT( " dropped\n" ) );
+	}
+
+	// one line, the same thing dumpStats( ) writes
+	//
+	void printStatsJson( )
+	{
+		console::print( getStatsJson( ).c_str( ), TEXT( "\n" ) );
+	}
+
+	std::string getStatsJson( )
+	{
+		const auto ticks = pscheduler->getStats( );
+		const auto matches = pmatches->getStats( );
+
+		char field[ 256 ];
+		snprintf( field, sizeof( field ), "{\"scheduler\":{\"ticks\":%llu,\"overruns\":%llu,\"catch_up_steps\":%llu,\"dropped_steps\":%llu,"
+			"\"avg_tick_ms\":%.3f,\"max_tick_ms\":%.3f},", ticks.ticks, ticks.overruns, ticks.catch_up_steps, ticks.dropped_steps,
+			ticks.avg_tick_ms, ticks.max_tick_ms );
+
+		std::string json = field;
+
+		snprintf( field, sizeof( field ), "\"matches\":{\"running\":%d,\"max\":%d,\"players\":%d,\"threads\":%d},", matches.matches,
+			pmatches->getMaxMatches( ), matches.players, matches.threads );
+
+		json += field;
+
+		const auto log = Logger::getStats( );
+		snprintf( field, sizeof( field ), "\"log\":{\"written\":%llu,\"dropped\":%llu,\"suppressed\":%llu},", log.written, log.dropped, log.suppressed );
+
+		json += field;
+		json += "\"metrics\":";
+		json += Metrics::toJson( Metrics::instance( ).read( ) );
+		json += ",\"clients\":[";
+
+		bool first = true;
+		for ( const auto& client : pclient->getClientMetrics( ) )
+		{
+			snprintf( field, sizeof( field ), "%s{\"pid\":%u,\"match\":%d,\"spectator\":%s,\"writes\":%llu,\"bytes\":%llu,\"dropped\":%llu}",
+				first ? "" : ",", client.pid, client.match, client.spectator ? "true" : "false", client.writes, client.bytes, client.dropped );
+
+			json += field;
+			first = false;
+		}
+
+		json += "]}";
+
+		return json;
 	}
 
 	static DWORD WINAPI adminConsole( Server* _this )
@@ -239,6 +451,9 @@ private:
 			{ TEXT( "suspend" ), [ &_this ] ( ) { _this->suspend( ); } },
 			{ TEXT( "resume" ), [ &_this ] ( ) { _this->resume( ); } },
 			{ TEXT( "restart" ), [ &_this ] ( ) { _this->restart( ); } },
+			{ TEXT( "matches" ), [ &_this ] ( ) { _this->printMatches( ); } },
+			{ TEXT( "stats" ), [ &_this ] ( ) { _this->printStats( ); } },
+			{ TEXT( "stats json" ), [ &_this ] ( ) { _this->printStatsJson( ); } },
 		};
 
 		while ( _this->running )
@@ -269,7 +484,7 @@ private:
 		{
 		case COMMAND_ACTION::FREEZE:
 			is_frozen = !is_frozen;
-			pengine->setFrozen( is_frozen );
+			setFrozen( is_frozen );
 			if ( is_frozen )
 			{
 				ResetEvent( h_event );
@@ -278,7 +493,7 @@ private:
 				if ( result == WAIT_TIMEOUT )
 				{
 					is_frozen = false;
-					pengine->setFrozen( is_frozen );
+					setFrozen( is_frozen );
 					SetEvent( h_event );
 					console::log( TEXT( "Unfreeze" ) );
 				}
@@ -286,10 +501,27 @@ private:
 
 			break;
 		case COMMAND_ACTION::ROCK:
-			result.status = pengine->placeRock( ptr_command->info.pos.x, ptr_command->info.pos.y );
+			// a cell off the roads is declined here, the engine would ignore it anyway
+			//
+			if ( ptr_command->info.pos.x < 0 || ptr_command->info.pos.x >= pmatches->getSettings( ).num_columns ||
+				ptr_command->info.pos.y < 1 || ptr_command->info.pos.y > pmatches->getSettings( ).num_roads )
+			{
+				result.status = false;
+				poperator->sendFeedback( result, ptr_command->sender_pid );
+				return;
+			}
+
+			pmatches->execute( [ x = ptr_command->info.pos.x, y = ptr_command->info.pos.y ] ( GameEngine& engine ) { engine.placeRock( x, y ); }, watched_match );
 			break;
 		case COMMAND_ACTION::INVERSE:
-			pengine->invert( ptr_command->info.road_index );
+			if ( ptr_command->info.road_index < 0 || ptr_command->info.road_index >= pmatches->getSettings( ).num_roads )
+			{
+				result.status = false;
+				poperator->sendFeedback( result, ptr_command->sender_pid );
+				return;
+			}
+
+			pmatches->execute( [ index = ptr_command->info.road_index ] ( GameEngine& engine ) { engine.invert( index ); }, watched_match );
 			break;
 		default:
 			result.status = false;
@@ -301,6 +533,13 @@ private:
 		poperator->sendFeedback( result, ptr_command->sender_pid );
 	}
 
+	// operator commands only reach the match the operators see, between two of its steps
+	//
+	void setFrozen( bool frozen )
+	{
+		pmatches->execute( [ frozen ] ( GameEngine& engine ) { engine.setFrozen( frozen ); }, watched_match );
+	}
+
 	DWORD getStatus( HANDLE h_thread )
 	{
 		DWORD status = NULL;
@@ -6,6 +6,8 @@ module;
 #include <Windows.h>
 #endif
 
+#include "settings.hpp"
+
 export module settings;
 
 #ifndef __INTELLISENSE__
@@ -17,13 +19,35 @@ import console;
 export namespace settings
 {
 	inline int num_roads = 5;
+	inline int num_columns = 20;
 	inline double init_car_speed = 1.0f;
 	inline int init_car_number = 2;
 	inline int tick_ms = 15;
 	inline int max_afk_timer = 10000;
+	inline int tcp_port = 27015;		// remote players, 0 = local pipe only
+	inline int max_matches = 256;		// games the server runs side by side
+	inline int match_threads = 0;		// threads ticking them, 0 = one per core
+	inline int record_replays = 0;		// 1 = every match is recorded to replays\ for crr_replay
+	inline int stats_interval = 0;		// seconds between two writes of stats.json, 0 = never
+	inline int write_timeout = 2000;	// ms a client may take to read a frame before it is disconnected, 0 = never
+	inline int parallel_roads = 16;		// roads a board needs before its tick is split across the pool, 0 = never
 
 	void load( );
 
+	GameSettings get( )
+	{
+		GameSettings game_settings;
+		game_settings.num_roads = settings::num_roads;
+		game_settings.num_columns = settings::num_columns;
+		game_settings.init_car_speed = settings::init_car_speed;
+		game_settings.init_car_number = settings::init_car_number;
+		game_settings.tick_ms = settings::tick_ms;
+		game_settings.max_afk_timer = settings::max_afk_timer;
+		game_settings.parallel_roads = settings::parallel_roads;
+
+		return game_settings;
+	}
+
 	void save( );
 }
 
@@ -58,8 +82,32 @@ namespace settings
 		DWORD size = sizeof( settings::num_roads );
 		RegQueryValueEx( settings::settings_key, TEXT("num_roads"), nullptr, &type, reinterpret_cast<LPBYTE>( &settings::num_roads ), &size );
 		
+		size = sizeof( settings::num_columns );
+		RegQueryValueEx( settings::settings_key, TEXT("num_columns"), nullptr, &type, reinterpret_cast<LPBYTE>( &settings::num_columns ), &size );
+
 		size = sizeof( settings::init_car_speed );
 		RegQueryValueEx( settings::settings_key, TEXT("init_car_speed"), nullptr, &type, reinterpret_cast<LPBYTE>( &settings::init_car_speed ), &size );
+
+		size = sizeof( settings::tcp_port );
+		RegQueryValueEx( settings::settings_key, TEXT("tcp_port"), nullptr, &type, reinterpret_cast<LPBYTE>( &settings::tcp_port ), &size );
+
+		size = sizeof( settings::max_matches );
+		RegQueryValueEx( settings::settings_key, TEXT("max_matches"), nullptr, &type, reinterpret_cast<LPBYTE>( &settings::max_matches ), &size );
+
+		size = sizeof( settings::match_threads );
+		RegQueryValueEx( settings::settings_key, TEXT("match_threads"), nullptr, &type, reinterpret_cast<LPBYTE>( &settings::match_threads ), &size );
+
+		size = sizeof( settings::record_replays );
+		RegQueryValueEx( settings::settings_key, TEXT("record_replays"), nullptr, &type, reinterpret_cast<LPBYTE>( &settings::record_replays ), &size );
+
+		size = sizeof( settings::stats_interval );
+		RegQueryValueEx( settings::settings_key, TEXT("stats_interval"), nullptr, &type, reinterpret_cast<LPBYTE>( &settings::stats_interval ), &size );
+
+		size = sizeof( settings::write_timeout );
+		RegQueryValueEx( settings::settings_key, TEXT("write_timeout"), nullptr, &type, reinterpret_cast<LPBYTE>( &settings::write_timeout ), &size );
+
+		size = sizeof( settings::parallel_roads );
+		RegQueryValueEx( settings::settings_key, TEXT("parallel_roads"), nullptr, &type, reinterpret_cast<LPBYTE>( &settings::parallel_roads ), &size );
 	}
 
 	void save( )
@@ -68,7 +116,15 @@ namespace settings
 			return;
 
 		RegSetValueEx( settings::settings_key, TEXT( "num_roads" ), 0, REG_BINARY, reinterpret_cast<LPBYTE>( &settings::num_roads ), sizeof( settings::num_roads ) );
+		RegSetValueEx( settings::settings_key, TEXT( "num_columns" ), 0, REG_BINARY, reinterpret_cast<LPBYTE>( &settings::num_columns ), sizeof( settings::num_columns ) );
 		RegSetValueEx( settings::settings_key, TEXT( "init_car_speed" ), 0, REG_BINARY, reinterpret_cast<LPBYTE>( &settings::init_car_speed ), sizeof( settings::init_car_speed ) );
+		RegSetValueEx( settings::settings_key, TEXT( "tcp_port" ), 0, REG_BINARY, reinterpret_cast<LPBYTE>( &settings::tcp_port ), sizeof( settings::tcp_port ) );
+		RegSetValueEx( settings::settings_key, TEXT( "max_matches" ), 0, REG_BINARY, reinterpret_cast<LPBYTE>( &settings::max_matches ), sizeof( settings::max_matches ) );
+		RegSetValueEx( settings::settings_key, TEXT( "match_threads" ), 0, REG_BINARY, reinterpret_cast<LPBYTE>( &settings::match_threads ), sizeof( settings::match_threads ) );
+		RegSetValueEx( settings::settings_key, TEXT( "record_replays" ), 0, REG_BINARY, reinterpret_cast<LPBYTE>( &settings::record_replays ), sizeof( settings::record_replays ) );
+		RegSetValueEx( settings::settings_key, TEXT( "stats_interval" ), 0, REG_BINARY, reinterpret_cast<LPBYTE>( &settings::stats_interval ), sizeof( settings::stats_interval ) );
+		RegSetValueEx( settings::settings_key, TEXT( "write_timeout" ), 0, REG_BINARY, reinterpret_cast<LPBYTE>( &settings::write_timeout ), sizeof( settings::write_timeout ) );
+		RegSetValueEx( settings::settings_key, TEXT( "parallel_roads" ), 0, REG_BINARY, reinterpret_cast<LPBYTE>( &settings::parallel_roads ), sizeof( settings::parallel_roads ) );
 	
 		RegCloseKey( settings::settings_key );
 		settings::settings_key = nullptr;
@@ -0,0 +1,117 @@
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "engine.hpp"
+#include "workers.hpp"
+#include "protocol.hpp"
+#include "snapshot.hpp"
+
+// every heap allocation made by the process goes through here
+//
+static std::atomic<uint64_t> allocations { 0 };
+
+void* operator new( std::size_t size )
+{
+	allocations.fetch_add( 1, std::memory_order_relaxed );
+
+	if ( auto ptr = std::malloc( size ? size : 1 ) )
+		return ptr;
+
+	throw std::bad_alloc( );
+}
+
+void operator delete( void* ptr ) noexcept
+{
+	std::free( ptr );
+}
+
+void operator delete( void* ptr, std::size_t ) noexcept
+{
+	std::free( ptr );
+}
+
+static constexpr int num_players = 2;
+static constexpr int warmup = 500;
+static constexpr int ticks = 1000;
+
+static bool publishSnapshot( SnapshotBuffer<SNAPSHOT>& snapshots, GameEngine& engine, uint32_t seq )
+{
+	const auto size = engine.getMapSize( );
+
+	auto& snapshot = snapshots.begin( );
+	if ( !serializeSnapshot( snapshot.data, engine.getEntityList( ), GAME_STATE_READY, 0, 0, size.first, size.second ) )
+	{
+		snapshots.cancel( );
+		return false;
+	}
+
+	serializeAcks( snapshot, engine.getPlayerAcks( ) );
+	snapshot.seq = seq;
+	snapshots.publish( );
+
+	return true;
+}
+
+// once a game is warm, a tick (inputs, step, snapshot) must not touch the heap, the same way the server drives it
+//
+static uint64_t steadyAllocations( const GameSettings& settings, WorkerPool* ppool )
+{
+	static constexpr FACING pattern[ ] = { UP, UP, LEFT, UP, RIGHT, UP, DOWN, UP };
+
+	GameEngine engine( settings, Random( 1234 ) );
+	engine.setWorkerPool( ppool );
+
+	for ( int pid = 1; pid <= num_players; pid++ )
+		engine.queueInput( PLAYER_INPUT_JOIN, pid );
+
+	static SnapshotBuffer<SNAPSHOT> snapshots;
+
+	uint64_t before = 0;
+	for ( int i = 0; i < warmup + ticks; i++ )
+	{
+		if ( i == warmup )
+			before = allocations.load( std::memory_order_relaxed );
+
+		for ( int pid = 1; pid <= num_players; pid++ )
+			engine.queueInput( PLAYER_INPUT_MOVE, pid, pattern[ ( i + pid ) % std::size( pattern ) ], static_cast<uint32_t>( i + 1 ) );
+
+		engine.processTick( );
+
+		if ( !publishSnapshot( snapshots, engine, static_cast<uint32_t>( i + 1 ) ) )
+		{
+			std::printf( "snapshot %d failed\n", i );
+			return 1;
+		}
+	}
+
+	return allocations.load( std::memory_order_relaxed ) - before;
+}
+
+int main( )
+{
+	GameSettings settings;
+
+	const auto serial = steadyAllocations( settings, nullptr );
+	if ( serial )
+	{
+		std::printf( "%llu allocations in %d steady state ticks\n", static_cast<unsigned long long>( serial ), ticks );
+		return 1;
+	}
+
+	// a big board steps its roads on the pool
+	//
+	settings.num_roads = 32;
+	settings.parallel_roads = 1;
+
+	WorkerPool pool( 2 );
+	const auto parallel = steadyAllocations( settings, &pool );
+	if ( parallel )
+	{
+		std::printf( "%llu allocations in %d steady state ticks on the pool\n", static_cast<unsigned long long>( parallel ), ticks );
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include <cstdio>
+
+#include "engine.hpp"
+
+// a join that got into the queue and a leave of the same player that found it full and went to the overflow
+// have to be applied in that order, the other way round leaves a frog behind for a player that is gone
+//
+int main( )
+{
+	GameSettings settings;
+	GameEngine engine( settings, Random( 1234 ) );
+
+	if ( !engine.queueInput( PLAYER_INPUT_JOIN, 1 ) )
+		return 1;
+
+	int filler = 2;
+	while ( engine.queueInput( PLAYER_INPUT_MOVE, filler, UP, 1 ) )
+		filler++;
+
+	engine.queueInput( PLAYER_INPUT_LEAVE, 1 );
+	engine.processTick( );
+
+	const auto acks = engine.getPlayerAcks( );
+	if ( !acks.empty( ) )
+	{
+		std::printf( "%zu frog(s) left after a join and a leave across the overflow\n", acks.size( ) );
+		return 1;
+	}
+
+	// a join that finds the queue full isn't lost either
+	//
+	while ( engine.queueInput( PLAYER_INPUT_MOVE, filler, UP, 1 ) )
+		filler++;
+
+	engine.queueInput( PLAYER_INPUT_JOIN, 1 );
+	engine.processTick( );
+
+	if ( engine.getPlayerAcks( ).size( ) != 1 )
+	{
+		std::printf( "a join that went to the overflow was not applied\n" );
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
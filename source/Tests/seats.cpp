@@ -0,0 +1,36 @@
+#include <cstdio>
+
+#include "match.hpp"
+
+// a match never seats more players than its first line has cells, every one of them has to get a frog
+//
+int main( )
+{
+	GameSettings settings;
+	settings.num_columns = 2;
+	settings.init_car_number = 1;
+
+	MatchManager manager( settings, 1, 3, 1, Random( 1234 ) );
+
+	if ( manager.join( 1, MULTIPLAYER ) != 0 || manager.join( 2, MULTIPLAYER ) != 0 )
+	{
+		std::printf( "the first two players were not seated\n" );
+		return 1;
+	}
+
+	if ( manager.join( 3, MULTIPLAYER ) != -1 )
+	{
+		std::printf( "a third player was seated on a start line of two cells\n" );
+		return 1;
+	}
+
+	manager.processTick( );
+
+	if ( manager.getStats( ).players != 2 )
+	{
+		std::printf( "%d players after the tick, expected 2\n", manager.getStats( ).players );
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file